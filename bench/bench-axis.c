@@ -0,0 +1,46 @@
+/* blot: cost of building an axis, against using the one from the last frame */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "blot.h"
+#include "blot_axis.h"
+
+#define SCREEN_LENGTH 1000
+#define ITERATIONS 10000
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+/* a vertical axis of SCREEN_LENGTH rows, like a tall Y axis; when rebuild is
+ * set the limits move a little every frame, so nothing can be reused */
+static void bench(const char *name, bool rebuild)
+{
+	g_autoptr(GError) error = NULL;
+	blot_axis *axs = NULL;
+
+	double t0 = blot_double_time();
+
+	for (int i=0; i<ITERATIONS; i++) {
+		double data_max = rebuild ? 100 + (i & 1) : 100;
+
+		axs = blot_axis_renew(axs, NULL, true, true, 8, SCREEN_LENGTH,
+				      -100, data_max, NULL, &error);
+		FATAL_ERROR(error);
+	}
+
+	double elapsed = blot_double_time() - t0;
+	blot_axis_delete(axs);
+
+	printf("%-8s %9.3f us/frame\n", name, 1e6 * elapsed / ITERATIONS);
+}
+
+int main(void)
+{
+	bench("rebuilt", true);
+	bench("cached", false);
+
+	return 0;
+}
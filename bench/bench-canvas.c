@@ -0,0 +1,152 @@
+/* blot: row-major and blocked canvas layouts, for each way that plots touch pixels */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "blot.h"
+#include "blot_composite.h"
+
+/* a large screen, with canvases well past the size of the L1 cache */
+#define SCREEN_COLS 1000
+#define SCREEN_ROWS 250
+#define OP_COUNT 20000
+#define REPEAT 10
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static unsigned rand_x[OP_COUNT];
+static unsigned rand_y[OP_COUNT];
+static unsigned rand_h[OP_COUNT];
+
+typedef void (*pattern_fn)(blot_canvas *can);
+
+/* lines that span most of the height, like an undecimated line plot */
+static void tall_lines(blot_canvas *can)
+{
+	for (int i=0; i<OP_COUNT; i++)
+		blot_canvas_draw_line(can, rand_x[i], rand_y[i], rand_x[i] + 3, rand_h[i]);
+}
+
+/* one column wide, straight down */
+static void vertical_lines(blot_canvas *can)
+{
+	for (int i=0; i<OP_COUNT; i++)
+		blot_canvas_draw_line(can, rand_x[i], rand_y[i], rand_x[i], rand_h[i]);
+}
+
+/* narrow bars standing on the bottom of the canvas */
+static void bars(blot_canvas *can)
+{
+	for (int i=0; i<OP_COUNT; i++)
+		blot_canvas_fill_rect(can, rand_x[i], 0, rand_x[i] + 5, rand_h[i]);
+}
+
+/* points all over the canvas */
+static void scatter(blot_canvas *can)
+{
+	for (int r=0; r<8; r++)
+		for (int i=0; i<OP_COUNT; i++)
+			blot_canvas_draw_point(can, rand_x[i] ^ r, rand_y[i] ^ (r * 3));
+}
+
+/* lines along the rows, which the row-major layout is good at */
+static void wide_lines(blot_canvas *can)
+{
+	for (int i=0; i<OP_COUNT; i++)
+		blot_canvas_draw_line(can, rand_x[i] / 4, rand_y[i], rand_x[i], rand_y[i] + 1);
+}
+
+static double time_pattern(pattern_fn fn, blot_render_flags flags)
+{
+	g_autoptr(GError) error = NULL;
+
+	blot_canvas *can = blot_canvas_new(SCREEN_COLS, SCREEN_ROWS, flags, 1, &error);
+	FATAL_ERROR(error);
+
+	double t0 = blot_double_time();
+	for (int r=0; r<REPEAT; r++) {
+		blot_canvas_clear(can);
+		fn(can);
+	}
+	double elapsed = blot_double_time() - t0;
+
+	blot_canvas_delete(can);
+	return elapsed;
+}
+
+/* reading the canvas back a row of cells at a time, as the screen does */
+static double time_rows(blot_render_flags flags)
+{
+	g_autoptr(GError) error = NULL;
+	blot_composite_row row;
+
+	blot_canvas *can = blot_canvas_new(SCREEN_COLS, SCREEN_ROWS, flags, 1, &error);
+	FATAL_ERROR(error);
+	blot_composite_row_init(&row, SCREEN_COLS, &error);
+	FATAL_ERROR(error);
+
+	tall_lines(can);
+
+	unsigned rows = can->dim.rows / (flags & BLOT_RENDER_BRAILLE ? BRAILLE_GLYPH_ROWS : 1);
+
+	double t0 = blot_double_time();
+	for (int r=0; r<REPEAT * 10; r++) {
+		for (unsigned c_y=0; c_y<rows; c_y++) {
+			blot_composite_row_merge(&row, 1, &can, c_y, &error);
+			FATAL_ERROR(error);
+		}
+	}
+	double elapsed = blot_double_time() - t0;
+
+	blot_composite_row_cleanup(&row);
+	blot_canvas_delete(can);
+	return elapsed;
+}
+
+static void bench(const char *name, pattern_fn fn, blot_render_flags flags)
+{
+	double t_rows = fn ? time_pattern(fn, flags) : time_rows(flags);
+	double t_blocks = fn ? time_pattern(fn, flags | BLOT_RENDER_BLOCKS)
+		: time_rows(flags | BLOT_RENDER_BLOCKS);
+
+	printf("%-24s row-major=%8.1f us  blocks=%8.1f us  speedup=%.2fx\n",
+	       name, 1e6 * t_rows / REPEAT, 1e6 * t_blocks / REPEAT, t_rows / t_blocks);
+}
+
+int main(void)
+{
+	srand(1);
+	for (int i=0; i<OP_COUNT; i++) {
+		/* in braille pixels, which the 1-bit canvases clip to their size */
+		rand_x[i] = rand() % (SCREEN_COLS * BRAILLE_GLYPH_COLS);
+		rand_y[i] = rand() % (SCREEN_ROWS * BRAILLE_GLYPH_ROWS);
+		rand_h[i] = rand() % (SCREEN_ROWS * BRAILLE_GLYPH_ROWS);
+	}
+
+	static const struct {
+		const char *name;
+		pattern_fn fn;
+	} patterns[] = {
+		{ "tall lines",     tall_lines },
+		{ "vertical lines", vertical_lines },
+		{ "bars",           bars },
+		{ "scatter",        scatter },
+		{ "wide lines",     wide_lines },
+		{ "composite rows", NULL },
+	};
+
+	for (unsigned b=0; b<2; b++) {
+		blot_render_flags flags = b ? BLOT_RENDER_BRAILLE : BLOT_RENDER_NONE;
+
+		for (unsigned p=0; p<G_N_ELEMENTS(patterns); p++) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s, %s", patterns[p].name, b ? "braille" : "1-bit");
+			bench(name, patterns[p].fn, flags);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+/* blot: cost of filling the rectangles of a bar chart */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "blot.h"
+
+#define BAR_COUNT 1000
+#define REPEAT 10
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static unsigned bar_height[BAR_COUNT];
+
+/* this is how rectangles used to be filled, one pixel at a time */
+static void pixel_fill_rect(blot_canvas *can, unsigned x0, unsigned y0, unsigned x1, unsigned y1)
+{
+	if (x0 > x1)
+		swap_t(unsigned, x0, x1);
+
+	if (y0 > y1)
+		swap_t(unsigned, y0, y1);
+
+	for (unsigned y=y0; y<=y1; y++) {
+		for (unsigned x=x0; x<=x1; x++) {
+			blot_canvas_draw_point(can, x, y);
+		}
+	}
+}
+
+typedef void (*fill_rect_fn)(blot_canvas *can, unsigned x0, unsigned y0, unsigned x1, unsigned y1);
+
+static double time_bars(fill_rect_fn fn, blot_render_flags flags, unsigned cols, unsigned rows)
+{
+	g_autoptr(GError) error = NULL;
+	double total = 0;
+
+	for (int r=0; r<REPEAT; r++) {
+		blot_canvas *can = blot_canvas_new(cols, rows, flags, 1, &error);
+		FATAL_ERROR(error);
+
+		/* bars are half as wide as the space each one gets, like bar plots */
+		double step = (double)can->dim.cols / BAR_COUNT;
+
+		double t0 = blot_double_time();
+		for (int i=0; i<BAR_COUNT; i++)
+			fn(can, i * step, 0, i * step + step / 2, bar_height[i] % can->dim.rows);
+		total += blot_double_time() - t0;
+
+		blot_canvas_delete(can);
+	}
+
+	return total;
+}
+
+static void bench(const char *name, blot_render_flags flags, unsigned cols, unsigned rows)
+{
+	double t_pixel = time_bars(pixel_fill_rect, flags, cols, rows);
+	double t_span = time_bars(blot_canvas_fill_rect, flags, cols, rows);
+
+	double us = 1e6 / REPEAT;
+	printf("%-32s pixels=%8.1f us/chart  spans=%8.1f us/chart  speedup=%.1fx\n",
+	       name, t_pixel * us, t_span * us, t_pixel / t_span);
+}
+
+int main(void)
+{
+	srand(1);
+	for (int i=0; i<BAR_COUNT; i++)
+		bar_height[i] = rand();
+
+	bench("1000x1000 braille, 1000 bars", BLOT_RENDER_BRAILLE, 1000, 1000);
+	bench("1000x1000 ascii, 1000 bars",   BLOT_RENDER_NONE,    1000, 1000);
+	bench("200x50 braille, 1000 bars",    BLOT_RENDER_BRAILLE, 200,  50);
+
+	return 0;
+}
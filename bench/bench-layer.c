@@ -0,0 +1,105 @@
+/* blot: per-point cost of the generic and the typed layer kernels */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "blot.h"
+
+#define DATA_COUNT 1000000
+#define REPEAT 10
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static gint64 data_i64[DATA_COUNT];
+static float  data_flt[DATA_COUNT];
+static double data_dbl[DATA_COUNT];
+static gint16 data_i16[DATA_COUNT];
+
+/* this is how every data type used to be rendered, one
+ * blot_layer_get_x_y() call per point, with a type switch */
+static void generic_scatter(blot_layer *lay, const blot_xy_limits *lim,
+			    blot_canvas *can)
+{
+	double x_range = lim->x_max - lim->x_min + 1;
+	double y_range = lim->y_max - lim->y_min + 1;
+
+	for (int di=0; di<lay->count; di++) {
+		double rx, ry;
+
+		if (!blot_layer_get_x_y(lay, di, &rx, &ry, NULL))
+			return;
+
+		double dx = (double)(rx - lim->x_min) * can->dim.cols / x_range;
+		double dy = (double)(ry - lim->y_min) * can->dim.rows / y_range;
+
+		blot_canvas_draw_point(can, round(dx), round(dy));
+	}
+}
+
+static void bench(const char *name, blot_data_type data_type,
+		  const void *xs, const void *ys, blot_xy_limits lim)
+{
+	g_autoptr(GError) error = NULL;
+	blot_dimensions dim = { 200, 50 };
+	blot_render_flags flags = BLOT_RENDER_BRAILLE;
+
+	blot_layer *lay = blot_layer_new(BLOT_SCATTER, data_type, DATA_COUNT,
+					 xs, ys, 1, name, &error);
+	FATAL_ERROR(error);
+
+	double t_generic = 0, t_typed = 0;
+
+	for (int r=0; r<REPEAT; r++) {
+		blot_canvas *can = blot_canvas_new(dim.cols, dim.rows, flags, 1, &error);
+		FATAL_ERROR(error);
+
+		double t0 = blot_double_time();
+		generic_scatter(lay, &lim, can);
+		double t1 = blot_double_time();
+
+		blot_canvas_delete(can);
+
+		can = blot_layer_render(lay, &lim, &dim, flags, &error);
+		FATAL_ERROR(error);
+		double t2 = blot_double_time();
+
+		blot_canvas_delete(can);
+
+		t_generic += t1 - t0;
+		t_typed += t2 - t1;
+	}
+
+	double ns = 1e9 / ((double)REPEAT * DATA_COUNT);
+	printf("%-24s generic=%6.2f ns/pt  typed=%6.2f ns/pt  speedup=%.2fx\n",
+	       name, t_generic * ns, t_typed * ns, t_generic / t_typed);
+
+	blot_layer_delete(lay);
+}
+
+int main(void)
+{
+	srand(1);
+	for (int i=0; i<DATA_COUNT; i++) {
+		data_i64[i] = i;
+		data_dbl[i] = (rand() % 80000) - 40000;
+		data_flt[i] = data_dbl[i];
+		data_i16[i] = data_dbl[i] / 2;
+	}
+
+	blot_xy_limits all = { 0, DATA_COUNT, -40000, 40000 };
+	bench("scatter int64/float",  BLOT_DATA_(INT64,FLOAT),   data_i64, data_flt, all);
+	bench("scatter int64/int16",  BLOT_DATA_(INT64,INT16),   data_i64, data_i16, all);
+	bench("scatter double/double", BLOT_DATA_DOUBLE,         data_dbl, data_dbl, all);
+	bench("scatter index/float",  BLOT_DATA_(INT64,FLOAT),   NULL,     data_flt, all);
+
+	/* zoomed in, so that only about 1% of the points are visible */
+	blot_xy_limits zoom = { 450000, 550000, -4000, 4000 };
+	bench("zoomed int64/float",   BLOT_DATA_(INT64,FLOAT),   data_i64, data_flt, zoom);
+	bench("zoomed index/float",   BLOT_DATA_(INT64,FLOAT),   NULL,     data_flt, zoom);
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/* blot: cost of drawing dense random-walk lines onto a canvas */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "blot.h"
+
+#define LINE_COUNT 1000000
+#define REPEAT 10
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static double walk_x[LINE_COUNT+1];
+static double walk_y[LINE_COUNT+1];
+
+/* this is how lines used to be drawn, stepping with doubles, and
+ * going through blot_canvas_draw_point() for every pixel */
+static void dda_draw_line(blot_canvas *can, double x0, double y0, double x1, double y1)
+{
+	double dx = x1 - x0;
+	double dy = y1 - y0;
+
+	double ax = abs_t(double,dx);
+	double ay = abs_t(double,dy);
+
+	if (ax<=1 && ay<=1) {
+		blot_canvas_draw_point(can, x0, y0);
+		return;
+	}
+
+	if (ax > ay) {
+		double m = dy/dx;
+		double x, y;
+		if (x0 < x1) {
+			for (x=x0, y=y0; x<=x1; x++, y+=m)
+				blot_canvas_draw_point(can, x, y);
+		} else {
+			for (x=x0, y=y0; x>=x1; x--, y-=m)
+				blot_canvas_draw_point(can, x, y);
+		}
+	} else {
+		double m = dx/dy;
+		double x, y;
+		if (y0 < y1) {
+			for (x=x0, y=y0; y<=y1; y++, x+=m)
+				blot_canvas_draw_point(can, x, y);
+		} else {
+			for (x=x0, y=y0; y>=y1; y--, x-=m)
+				blot_canvas_draw_point(can, x, y);
+		}
+	}
+}
+
+typedef void (*draw_line_fn)(blot_canvas *can, double x0, double y0, double x1, double y1);
+
+static double time_lines(draw_line_fn fn, blot_render_flags flags, double scale)
+{
+	g_autoptr(GError) error = NULL;
+	double total = 0;
+
+	for (int r=0; r<REPEAT; r++) {
+		blot_canvas *can = blot_canvas_new(200, 50, flags, 1, &error);
+		FATAL_ERROR(error);
+
+		double t0 = blot_double_time();
+		for (int i=0; i<LINE_COUNT; i++)
+			fn(can, walk_x[i] * scale, walk_y[i] * scale,
+			   walk_x[i+1] * scale, walk_y[i+1] * scale);
+		total += blot_double_time() - t0;
+
+		blot_canvas_delete(can);
+	}
+
+	return total;
+}
+
+static void bench(const char *name, blot_render_flags flags, double scale)
+{
+	double t_dda = time_lines(dda_draw_line, flags, scale);
+	double t_new = time_lines(blot_canvas_draw_line, flags, scale);
+
+	double ns = 1e9 / ((double)REPEAT * LINE_COUNT);
+	printf("%-28s dda=%6.2f ns/line  bresenham=%6.2f ns/line  speedup=%.2fx\n",
+	       name, t_dda * ns, t_new * ns, t_dda / t_new);
+}
+
+int main(void)
+{
+	/* a random walk squeezed into 400 columns, so that many consecutive
+	 * points share a column, like an undecimated line plot */
+	srand(1);
+	double y = 100;
+	for (int i=0; i<=LINE_COUNT; i++) {
+		walk_x[i] = (double)i * 400 / LINE_COUNT;
+		walk_y[i] = round(y);
+		y += (rand() % 21) - 10;
+		y = CLAMP(y, 0, 199);
+	}
+
+	bench("walk, ascii",               BLOT_RENDER_NONE,    1);
+	bench("walk, braille",             BLOT_RENDER_BRAILLE, 1);
+
+	/* zoomed in 4x, so most of the walk is off canvas */
+	bench("walk zoomed in, braille",   BLOT_RENDER_BRAILLE, 4);
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/* blot: throughput of rendering many small figures on several threads */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "blot.h"
+
+#define DATA_COUNT 100
+#define LAYER_COUNT 3
+#define DURATION 1.0
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static double data_xs[DATA_COUNT];
+static double data_ys[LAYER_COUNT][DATA_COUNT];
+
+static volatile bool stop;
+
+/* each thread renders its own small figure, over and over, like a service
+ * would when it handles requests for many different plots */
+static gpointer render_loop(gpointer data)
+{
+	g_autoptr(GError) error = NULL;
+	guint64 *renders = data;
+
+	blot_figure *fig = blot_figure_new(&error);
+	FATAL_ERROR(error);
+
+	blot_figure_set_screen_size(fig, 60, 20, &error);
+	FATAL_ERROR(error);
+
+	for (int li=0; li<LAYER_COUNT; li++) {
+		blot_figure_line(fig, BLOT_DATA_DOUBLE, DATA_COUNT, data_xs, data_ys[li],
+				 9 + li, "data", &error);
+		FATAL_ERROR(error);
+	}
+
+	blot_render_flags flags = BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW
+		| BLOT_RENDER_UTF8;
+
+	while (!stop) {
+		blot_screen *scr = blot_figure_render(fig, flags, &error);
+		FATAL_ERROR(error);
+		blot_screen_delete(scr);
+		(*renders) ++;
+	}
+
+	blot_figure_delete(fig);
+	return NULL;
+}
+
+static void bench(unsigned threads)
+{
+	GThread *thr[threads];
+	guint64 renders[threads];
+
+	stop = false;
+	for (unsigned ti=0; ti<threads; ti++) {
+		renders[ti] = 0;
+		thr[ti] = g_thread_new("render", render_loop, &renders[ti]);
+	}
+
+	double t0 = blot_double_time();
+	g_usleep(DURATION * G_USEC_PER_SEC);
+	stop = true;
+
+	guint64 total = 0;
+	for (unsigned ti=0; ti<threads; ti++) {
+		g_thread_join(thr[ti]);
+		total += renders[ti];
+	}
+	double elapsed = blot_double_time() - t0;
+
+	printf("%2u threads  %9.0f renders/s  %7.2f us/render/thread\n",
+	       threads, total / elapsed, 1e6 * elapsed * threads / total);
+}
+
+int main(void)
+{
+	for (int i=0; i<DATA_COUNT; i++) {
+		data_xs[i] = i;
+		for (int li=0; li<LAYER_COUNT; li++)
+			data_ys[li][i] = sin(i / 10.0 + li);
+	}
+
+	bench(1);
+	bench(4);
+	bench(16);
+
+	return 0;
+}
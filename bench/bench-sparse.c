@@ -0,0 +1,86 @@
+/* blot: dense, sparse and indexed layer canvases, for many short layers on a large screen */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "blot.h"
+
+#define SCREEN_COLS 1000
+#define SCREEN_ROWS 250
+#define LAYER_COUNT 24
+#define DATA_COUNT 20
+#define ITERATIONS 200
+
+#define FATAL_ERROR(error) ({ \
+	if (unlikely (error)) \
+		g_error("%s:%u: %s", __func__, __LINE__, (error)->message); \
+})
+
+static double data_xs[LAYER_COUNT][DATA_COUNT];
+static double data_ys[LAYER_COUNT][DATA_COUNT];
+
+/* every layer is a short wiggle in its own part of the screen, so each of
+ * them only touches a few tiles */
+static void bench(const char *name, blot_render_flags flags)
+{
+	g_autoptr(GError) error = NULL;
+	blot_mem_stats stats;
+
+	blot_figure *fig = blot_figure_new(&error);
+	FATAL_ERROR(error);
+
+	blot_figure_set_screen_size(fig, SCREEN_COLS, SCREEN_ROWS, &error);
+	FATAL_ERROR(error);
+
+	for (int li=0; li<LAYER_COUNT; li++) {
+		blot_figure_line(fig, BLOT_DATA_DOUBLE, DATA_COUNT, data_xs[li], data_ys[li],
+				 9 + li % 6, "data", &error);
+		FATAL_ERROR(error);
+	}
+
+	/* a one-shot render allocates everything it needs */
+	blot_screen *scr = blot_figure_render(fig, flags, &error);
+	FATAL_ERROR(error);
+	blot_screen_delete(scr);
+	blot_figure_get_render_mem_stats(fig, &stats, &error);
+	FATAL_ERROR(error);
+
+	/* and a context keeps it, so only drawing and clearing are left */
+	blot_render_ctx *ctx = blot_render_ctx_new(&error);
+	FATAL_ERROR(error);
+
+	double t0 = blot_double_time();
+
+	for (int i=0; i<ITERATIONS; i++) {
+		blot_figure_render_into(fig, ctx, flags, &error);
+		FATAL_ERROR(error);
+	}
+
+	double elapsed = blot_double_time() - t0;
+
+	printf("%-8s %9.1f us/frame  %9zd peak bytes\n", name,
+	       1e6 * elapsed / ITERATIONS, stats.peak_bytes);
+
+	blot_render_ctx_delete(ctx);
+	blot_figure_delete(fig);
+}
+
+int main(void)
+{
+	for (int li=0; li<LAYER_COUNT; li++) {
+		double x0 = (li % 6) * 100, y0 = (li / 6) * 10;
+		for (int i=0; i<DATA_COUNT; i++) {
+			data_xs[li][i] = x0 + i;
+			data_ys[li][i] = y0 + sin(i / 3.0);
+		}
+	}
+
+	blot_render_flags flags = BLOT_RENDER_BRAILLE | BLOT_RENDER_NO_COLOR | BLOT_RENDER_UTF8;
+
+	bench("dense", flags);
+	bench("sparse", flags | BLOT_RENDER_SPARSE);
+	bench("indexed", flags | BLOT_RENDER_INDEXED);
+
+	return 0;
+}
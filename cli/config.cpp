@@ -32,6 +32,7 @@ Config::Config(int argc, char *argv[])
 			spdlog::set_level(spdlog::level::trace);
 		}).doc("Enable debug output"),
 		clipp::option("--timing").set(m_show_timing).doc("Show timing statitiscs"),
+		clipp::option("--diff").set(m_diff_output).doc("Only redraw what changed since the last frame"),
 		(clipp::option("-i", "--interval") & clipp::value("sec")
 			.call([&](const char *txt) { m_display_interval = txt; }))
 			.doc("Display interval in seconds")
@@ -95,6 +95,7 @@ protected:
 	bool m_display_interval{1};
 	bool m_using_input_interval{};
 	bool m_show_timing{};
+	bool m_diff_output{};
 
 public:
 	explicit Config(int argc, char *argv[]);
@@ -118,6 +119,7 @@ public:
 	bool using_input_interval() const { return m_using_input_interval; }
 	double display_interval() const { return m_display_interval; }
 	bool show_timing() const { return m_show_timing; }
+	bool diff_output() const { return m_diff_output; }
 };
 
 
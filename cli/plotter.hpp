@@ -6,59 +6,23 @@
 #include "blot.hpp"
 #include "spdlog/spdlog.h"
 
+#include <memory>
+
 template <typename X, typename Y>
 class Plotter final {
 protected:
-	template <typename T>
-	class Storage {
-	protected:
-		std::vector<T> m_data;
-		size_t m_offset{};
-
-		void relocation_check() {
-			bool full = m_data.size() == m_data.capacity();
-			if (full && m_offset && m_offset > (m_data.capacity()/2)) {
-				// full but most is empty, so we should relocate the data
-				m_data.erase(m_data.begin(), m_data.begin() + m_offset);
-				m_offset = 0;
-			}
-		}
-
-	public:
-		void push_back(const T &v) {
-			relocation_check();
-			m_data.push_back(v);
-		}
-
-		void erase_front(size_t count = 1) {
-			if (count > size())
-				BLOT_THROW(ERANGE, "count=%zu exceeds size=%zu", count, size());
-			m_offset += count;
-		}
-
-		T* data() noexcept { return m_data.data() + m_offset; }
-		const T* data() const noexcept { return m_data.data() + m_offset; }
-		size_t size() const { return m_data.size() - m_offset; }
-
-		std::span<T> span() {
-			return std::span<const T>(data(), size());
-		}
-		std::span<const T> span() const {
-			return std::span<const T>(data(), size());
-		}
-
-	};
-
-	struct Data {
-		Storage<X> m_xs;
-		Storage<Y> m_ys;
-	};
-	std::vector<Data> m_data;
+	// one ring layer per input, they keep the last data_limit() points
+	Blot::Figure m_fig;
 	size_t m_count{};
 
 	const Config &m_config;
 	size_t m_max_layers{};
 	size_t m_data_history{};
+	// frames alternate between two contexts when diffing, so that the
+	// previous screen is still around to compare against
+	Blot::RenderContext m_ctx[2];
+	size_t m_frames{};
+	std::unique_ptr<Blot::Screen> m_prev_screen;
 
 	struct {
 		size_t count{};
@@ -74,22 +38,39 @@ public:
 	explicit Plotter(const Config &config)
 	: m_config(config), m_max_layers(m_config.inputs())
 	{
-		m_data.resize(m_max_layers);
+		m_fig.set_axis_color(8);
+
+		#if 0
+		Blot::Dimensions term;
+		m_fig.set_screen_size(term.cols, term.rows/2);
+		#endif
+
+		for (size_t i=0; i<m_max_layers; i++) {
+			const auto &input = m_config.input(i);
+
+			m_fig.ring<X,Y>(input.plot_type(), input.data_limit(),
+				input.plot_color(), input.details());
+		}
 	}
 
 	void add(size_t layer, X x, Y y) {
-		m_data[layer].m_xs.push_back(x);
-		m_data[layer].m_ys.push_back(y);
+		m_fig.append(layer, x, y);
 		m_count ++;
-
-		if (m_data[layer].m_xs.size() > m_config.input(layer).data_limit()) {
-			m_data[layer].m_xs.erase_front();
-			m_data[layer].m_ys.erase_front();
-		}
 	}
 
 	bool have_data() const { return m_count > 0; }
 
+	// once a ring holds data_limit() points, every point added drops the
+	// oldest one, so the X window slides and the canvases can scroll
+	bool history_full() const {
+		for (size_t i=0; i<m_fig.layer_count; i++) {
+			const blot_layer *lay = m_fig.layers[i];
+			if (lay->count == lay->capacity)
+				return true;
+		}
+		return false;
+	}
+
 	void plot() {
 
 		setlocale(LC_CTYPE, "");
@@ -98,29 +79,15 @@ public:
 
 		double t_start = timing ? blot_double_time() : 0;
 
-		Blot::Figure fig;
-		fig.set_axis_color(8);
-
-		#if 0
-		Blot::Dimensions term;
-		fig.set_screen_size(term.cols, term.rows/2);
-		#endif
-
+		// the figure and its layers persist across frames
 		double t_init = timing ? blot_double_time() : 0;
-
-		for (size_t i=0; i<m_data.size(); i++) {
-			const auto &data = m_data[i];
-			const auto &input = m_config.input(i);
-
-			fig.plot(input.plot_type(), data.m_xs.span(), data.m_ys.span(),
-				input.plot_color(), input.details());
-		}
-
 		double t_add = timing ? blot_double_time() : 0;
 
 		blot_render_flags flags
 			= BLOT_RENDER_LEGEND_BELOW
-			| BLOT_RENDER_CLEAR;
+			| BLOT_RENDER_CLEAR
+			| BLOT_RENDER_UTF8
+			| BLOT_RENDER_REUSE;
 
 		switch (m_config.output_type()) {
 			case Config::ASCII:
@@ -136,18 +103,33 @@ public:
 		if (timing)
 			flags = flags | BLOT_RENDER_LEGEND_DETAILS;
 
-		Blot::Screen scr = fig.render(flags);
+		if (m_max_layers > 1)
+			flags = flags | BLOT_RENDER_PARALLEL;
+
+		if (history_full())
+			flags = flags | BLOT_RENDER_SCROLL;
+
+		auto &ctx = m_ctx[m_config.diff_output() ? m_frames % 2 : 0];
+		m_frames ++;
+
+		Blot::Screen scr = m_fig.render_into(ctx, flags);
 
 		double t_render = timing ? blot_double_time() : 0;
 
 		gsize txt_size = 0;
-		const wchar_t *txt = scr.get_text(txt_size);
+		const char *txt = m_config.diff_output()
+			? scr.diff(m_prev_screen.get(), txt_size)
+			: scr.get_utf8(txt_size);
 
 		spdlog::debug("rendered size = %zu", txt_size);
 
-		printf("%ls", txt);
+		fwrite(txt, 1, txt_size, stdout);
 		fflush(stdout);
 
+		// the next frame is drawn as changes to this one
+		if (m_config.diff_output())
+			m_prev_screen = std::make_unique<Blot::Screen>(std::move(scr));
+
 		double t_print = timing ? blot_double_time() : 0;
 
 		if (timing) {
@@ -158,13 +140,17 @@ public:
 			m_stats.print  += t_print  - t_render;
 			m_stats.total  += t_print  - t_start;
 
-			fmt::print("time: count={} init={:.6f} add={:.6f} render={:.6f} print={:.6f} [{:.6f}]",
+			fmt::print("time: count={} init={:.6f} add={:.6f} render={:.6f} print={:.6f} [{:.6f}] hits={} appends={} scrolls={} misses={}",
 				m_stats.count,
 				m_stats.init / m_stats.count,
 				m_stats.add / m_stats.count,
 				m_stats.render / m_stats.count,
 				m_stats.print / m_stats.count,
-				m_stats.total / m_stats.count);
+				m_stats.total / m_stats.count,
+				m_ctx[0].reuse_hits + m_ctx[1].reuse_hits,
+				m_ctx[0].reuse_appends + m_ctx[1].reuse_appends,
+				m_ctx[0].reuse_scrolls + m_ctx[1].reuse_scrolls,
+				m_ctx[0].reuse_misses + m_ctx[1].reuse_misses);
 			std::flush(std::cout);
 		}
 	}
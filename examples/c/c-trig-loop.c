@@ -38,6 +38,10 @@ int main(void)
 	double t_render_total=0, t_display_total=0;
 	long iterations = 0;
 
+	/* buffers reused by every frame */
+	blot_render_ctx *ctx = blot_render_ctx_new(&error);
+	FATAL_ERROR(error);
+
 again:
 
 	/* build a dummy dataset */
@@ -113,7 +117,7 @@ again:
 	flags |= BLOT_RENDER_NO_X_AXIS;
 	flags |= BLOT_RENDER_NO_Y_AXIS;
 
-	blot_screen *scr = blot_figure_render(fig, flags, &error);
+	blot_screen *scr = blot_figure_render_into(fig, ctx, flags, &error);
 	FATAL_ERROR(error);
 
 	/* print it to screen */
@@ -126,8 +130,6 @@ again:
 
 	printf("%ls\n", txt);
 
-	blot_screen_delete(scr);
-
 	blot_figure_delete(fig);
 
 	double t_end = blot_double_time();
@@ -147,5 +149,7 @@ again:
 	if (!signaled)
 		goto again;
 
+	blot_render_ctx_delete(ctx);
+
 	return 0;
 }
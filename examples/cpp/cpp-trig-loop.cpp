@@ -32,6 +32,9 @@ int main(void)
 	double t_render_total=0, t_display_total=0;
 	long iterations = 0;
 
+	/* buffers reused by every frame */
+	Blot::RenderContext ctx;
+
 again:
 
 	/* build a dummy dataset */
@@ -88,7 +91,7 @@ again:
 		| BLOT_RENDER_NO_X_AXIS
 		| BLOT_RENDER_NO_Y_AXIS;
 
-	Blot::Screen scr = fig.render(flags);
+	Blot::Screen scr = fig.render_into(ctx, flags);
 
 	/* print it to screen */
 
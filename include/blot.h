@@ -1,8 +1,10 @@
 /* blot top level header */
 /* vim: set noet sw=8 ts=8 tw=120: */
 #pragma once
+#include "blot_alloc.h"
 #include "blot_canvas.h"
 #include "blot_color.h"
+#include "blot_context.h"
 #include "blot_error.h"
 #include "blot_figure.h"
 #include "blot_layer.h"
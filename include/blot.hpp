@@ -115,11 +115,43 @@ public:
 
 // ------------------------------------------------------------------------
 
+/* see blot_context.h, a context must outlive the figures that use it */
+struct Context final : public blot_context {
+public:
+	explicit Context(bool color = true) {
+		GError *error = nullptr;
+
+		if (!blot_context_init(this, &error)) [[unlikely]] {
+			throw Exception(error);
+		}
+		this->color = color;
+	}
+
+	void set_color(bool color) {
+		GError *error = nullptr;
+		if (!blot_context_set_color(this, color, &error))
+			throw Exception(error);
+	}
+
+	void set_term_size(unsigned cols, unsigned rows) {
+		GError *error = nullptr;
+		if (!blot_context_set_term_size(this, blot_dimensions{cols, rows}, &error))
+			throw Exception(error);
+	}
+};
+
+// ------------------------------------------------------------------------
+
 struct Screen final {
 	blot_screen *m_screen;
+	bool m_owned;
 public:
-	explicit Screen(blot_screen *screen) : m_screen(screen) { }
-	~Screen() { blot_screen_delete(m_screen); }
+	/* screens that belong to a RenderContext are not owned */
+	explicit Screen(blot_screen *screen, bool owned = true) : m_screen(screen), m_owned(owned) { }
+	Screen(Screen &&other) : m_screen(std::exchange(other.m_screen, nullptr)), m_owned(other.m_owned) { }
+	Screen(const Screen &) = delete;
+	Screen& operator=(const Screen &) = delete;
+	~Screen() { if (m_owned) blot_screen_delete(m_screen); }
 
 	const wchar_t *get_text(size_t &size) {
 		GError *error = nullptr;
@@ -130,6 +162,45 @@ public:
 		size = tmp_size;
 		return txt;
 	}
+
+	const char *get_utf8(size_t &size) {
+		GError *error = nullptr;
+		gsize tmp_size;
+		auto txt = blot_screen_get_utf8(m_screen, &tmp_size, &error);
+		if (!txt)
+			throw Exception(error);
+		size = tmp_size;
+		return txt;
+	}
+
+	const char *diff(Screen *prev, size_t &size) {
+		GError *error = nullptr;
+		gsize tmp_size;
+		auto txt = blot_screen_diff(m_screen, prev ? prev->m_screen : nullptr,
+					    &tmp_size, &error);
+		if (!txt)
+			throw Exception(error);
+		size = tmp_size;
+		return txt;
+	}
+};
+
+// ------------------------------------------------------------------------
+
+struct RenderContext final : public blot_render_ctx {
+public:
+	explicit RenderContext() {
+		GError *error = nullptr;
+
+		if (!blot_render_ctx_init(this, &error)) [[unlikely]] {
+			throw Exception(error);
+		}
+	}
+	RenderContext(const RenderContext &) = delete;
+	RenderContext& operator=(const RenderContext &) = delete;
+	~RenderContext() {
+		blot_render_ctx_cleanup(this);
+	}
 };
 
 // ------------------------------------------------------------------------
@@ -149,6 +220,12 @@ public:
 
 	/* configure */
 
+	void set_context(const Context &bctx) {
+		GError *error = nullptr;
+		if (!blot_figure_set_context(this, &bctx, &error))
+			throw Exception(error);
+	}
+
 	void set_axis_color(blot_color color) {
 		GError *error = nullptr;
 		if (!blot_figure_set_axis_color(this, color, &error))
@@ -173,6 +250,12 @@ public:
 			throw Exception(error);
 	}
 
+	void set_y_autoscale_in_x(bool enable) {
+		GError *error = nullptr;
+		if (!blot_figure_set_y_autoscale_in_x(this, enable, &error))
+			throw Exception(error);
+	}
+
 	void set_x_axis_labels(const std::vector<const char *> &labels) {
 		GError *error = nullptr;
 		BLOT_EXPECT(!labels.empty());
@@ -245,6 +328,38 @@ public:
 		plot<T,T>(BLOT_BAR, {}, data_ys, data_color, data_label);
 	}
 
+	/* ring layers own their data, and keep the last capacity points appended */
+
+	template <typename T, typename U>
+	void ring(blot_plot_type plot_type, size_t capacity, blot_color data_color, const char *data_label) {
+		GError *error = nullptr;
+		blot_data_type data_type = BLOT_DATA_TYPE(Blot::data_type<T>(), Blot::data_type<U>());
+
+		if (!blot_figure_plot_ring(this, plot_type, data_type, capacity, data_color, data_label, &error))
+			throw Exception(error);
+	}
+
+	template <typename T, typename U>
+	void append(size_t layer, const std::span<const T> &data_xs, const std::span<const U> &data_ys) {
+		GError *error = nullptr;
+		BLOT_EXPECT_EQ(data_xs.size(), data_ys.size());
+
+		blot_layer *lay = blot_figure_get_layer(this, layer, &error);
+		if (!lay)
+			throw Exception(error);
+
+		blot_data_type data_type = BLOT_DATA_TYPE(Blot::data_type<T>(), Blot::data_type<U>());
+		BLOT_EXPECT_EQ(lay->data_type, data_type);
+
+		if (!blot_layer_append(lay, data_ys.size(), data_xs.data(), data_ys.data(), &error))
+			throw Exception(error);
+	}
+
+	template <typename T, typename U>
+	void append(size_t layer, T x, U y) {
+		append(layer, std::span<const T>(&x, 1), std::span<const U>(&y, 1));
+	}
+
 	/* render */
 
 	Screen render(blot_render_flags flags) {
@@ -255,6 +370,20 @@ public:
 		return Screen(screen);
 	}
 
+	/* the screen returned is valid until the next render into ctx */
+	Screen render_into(RenderContext &ctx, blot_render_flags flags) {
+		GError *error = nullptr;
+		blot_screen * screen = blot_figure_render_into(this, &ctx, flags, &error);
+		if (!screen)
+			throw Exception(error);
+		return Screen(screen, false);
+	}
+
+	/* what the last render allocated */
+	const blot_mem_stats & render_mem_stats() const {
+		return render_mem;
+	}
+
 };
 
 };
@@ -0,0 +1,76 @@
+/* blot: memory allocation hooks and accounting */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "blot_compiler.h"
+#include "blot_utils.h"
+
+/* every allocation made by libblot goes through these; memory returned by
+ * malloc/realloc must be aligned to at least 16 bytes */
+typedef struct blot_allocator {
+	gpointer (*malloc)(gsize size, gpointer user_data);
+	gpointer (*realloc)(gpointer mem, gsize size, gpointer user_data);
+	void     (*free)(gpointer mem, gpointer user_data);
+	gpointer user_data;
+} blot_allocator;
+
+/* counts of what was allocated, either by the whole library or by a
+ * single render; in use is what was allocated and not yet freed, and can be
+ * negative for a render that frees more than it allocates */
+typedef struct blot_mem_stats {
+	gsize allocations;              // calls to malloc and realloc
+	gsize bytes_allocated;          // bytes requested from malloc and realloc
+	gssize bytes_in_use;            // bytes allocated and not freed since
+	gssize peak_bytes;              // highest bytes_in_use
+} blot_mem_stats;
+
+BLOT_EXTERN_C_START
+
+/* route all allocations to alloc, or back to g_malloc() et al. if NULL;
+ * this fails with EBUSY while any memory allocated by libblot is in use */
+BLOT_API bool blot_set_allocator(const blot_allocator *alloc, GError **);
+
+/* counts for everything since the library was loaded, or last reset */
+BLOT_API void blot_get_mem_stats(blot_mem_stats *stats);
+
+/* start counting again, from what is currently in use */
+BLOT_API void blot_reset_mem_stats(void);
+
+/* allocations made by this thread (and work it hands to blot_parallel_for())
+ * are also counted in stats, until blot_mem_scope_leave() is given the
+ * value that was returned; stats must be zeroed by the caller */
+BLOT_API blot_mem_stats * blot_mem_scope_enter(blot_mem_stats *stats);
+BLOT_API void blot_mem_scope_leave(blot_mem_stats *prev);
+BLOT_API blot_mem_stats * blot_mem_scope_get(void);
+
+/* same as their g_* counterparts, but these return NULL when size is zero,
+ * or when the allocator fails */
+BLOT_API gpointer blot_malloc(gsize size);
+BLOT_API gpointer blot_malloc0(gsize size);
+BLOT_API gpointer blot_realloc(gpointer mem, gsize size);
+BLOT_API void blot_free(gpointer mem);
+
+BLOT_EXTERN_C_END
+
+static inline gsize blot_alloc_size_n(gsize count, gsize size)
+{
+	gsize total;
+	if (unlikely (__builtin_mul_overflow(count, size, &total)))
+		return 0;
+	return total;
+}
+
+#define blot_new(type,count) ((type*)blot_malloc(blot_alloc_size_n((count), sizeof(type))))
+#define blot_new0(type,count) ((type*)blot_malloc0(blot_alloc_size_n((count), sizeof(type))))
+#define blot_renew(type,mem,count) ((type*)blot_realloc((mem), blot_alloc_size_n((count), sizeof(type))))
+
+/* like g_autofree, for memory from blot_malloc() */
+static inline void blot_autofree_cleanup(void *pmem)
+{
+	blot_free(*(gpointer*)pmem);
+}
+#define blot_autofree __attribute__((cleanup(blot_autofree_cleanup)))
@@ -0,0 +1,48 @@
+/* blot: internal bump allocator for objects that live for a single render */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "blot_compiler.h"
+
+/* every allocation starts on its own cache line */
+#define BLOT_ARENA_ALIGN 64
+
+/* size of the first chunk, later ones are twice as large, or as large as
+ * the allocation that did not fit */
+#define BLOT_ARENA_CHUNK_SIZE (64*1024)
+
+struct blot_arena_chunk;
+
+/* objects are carved out of large chunks, and are never freed on their own;
+ * everything is returned at once by blot_arena_release() */
+typedef struct blot_arena {
+	struct blot_arena_chunk *chunk; // most recent, links to the older ones
+	guint8 *next, *end;             // free space left in the current chunk
+	gsize chunk_size;               // size of the next chunk to allocate
+	gsize used;                     // bytes handed out since the last release
+} blot_arena;
+
+BLOT_EXTERN_C_START
+
+BLOT_API bool blot_arena_init(blot_arena *arena, GError **);
+
+/* returns size bytes aligned to BLOT_ARENA_ALIGN, that stay valid
+ * until the next blot_arena_release() */
+BLOT_API void * blot_arena_alloc(blot_arena *arena, gsize size, GError **);
+
+/* free every chunk, the arena can be used again afterwards */
+BLOT_API void blot_arena_release(blot_arena *arena);
+
+BLOT_EXTERN_C_END
+
+static inline void * blot_arena_alloc0(blot_arena *arena, gsize size, GError **error)
+{
+	void *p = blot_arena_alloc(arena, size, error);
+	if (p)
+		memset(p, 0, size);
+	return p;
+}
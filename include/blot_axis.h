@@ -9,6 +9,8 @@
 #include "blot_types.h"
 #include "blot_error.h"
 
+struct blot_arena;
+
 struct blot_axis_tick {
 	double value;
 	char *label;
@@ -21,6 +23,8 @@ struct blot_axis {
 	blot_color color;
 	unsigned screen_length;
 	double data_min, data_max;
+	blot_strv labels;           // as given, only compared to see if it changed
+	gsize alloc_size;           // bytes allocated, including the arrays below
 
 	blot_axis_tick *entries[0]; // must be last
 };
@@ -39,8 +43,47 @@ BLOT_API blot_axis * blot_axis_new(bool is_vertical,
 				 GError **);
 BLOT_API void blot_axis_delete(blot_axis *axs);
 
+/* same as blot_axis_new(), but reuses the memory of axs (which can be NULL)
+ * when it is large enough, and returns axs untouched if it was built from
+ * the same arguments; axs must no longer be used after this, on error
+ * it is deleted; if arena is not NULL, axs came from it too, and a larger
+ * axis is carved out of it rather than reallocated, and nothing is deleted */
+BLOT_API blot_axis * blot_axis_renew(blot_axis *axs,
+				   struct blot_arena *arena,
+				   bool is_vertical,
+				   bool is_visible,
+				   blot_color color,
+				   unsigned screen_length,
+				   double data_min, double data_max,
+				   const blot_strv *labels,
+				   GError **);
+
 BLOT_EXTERN_C_END
 
+/* true if axs was built from these arguments, so it can be used as is; the
+ * labels are compared by their array, not by the strings in it */
+static inline bool blot_axis_matches(const blot_axis *axs,
+				     bool is_vertical,
+				     bool is_visible,
+				     blot_color color,
+				     unsigned screen_length,
+				     double data_min, double data_max,
+				     const blot_strv *labels)
+{
+	gsize label_count = labels ? labels->count : 0;
+	char **label_strings = label_count ? labels->strings : NULL;
+
+	return axs
+		&& axs->is_vertical == is_vertical
+		&& axs->is_visible == is_visible
+		&& axs->color == color
+		&& axs->screen_length == screen_length
+		&& axs->data_min == data_min
+		&& axs->data_max == data_max
+		&& axs->labels.count == label_count
+		&& axs->labels.strings == label_strings;
+}
+
 /* access */
 
 static inline const blot_axis_tick * blot_axis_get_tick_at(const blot_axis *axs,
@@ -32,6 +32,9 @@
 
 #define BRAILLE_GLYPH_MAP_INDEX(x,y) ( ( (y) * BRAILLE_GLYPH_COLS) + (x) )
 
+/* every braille glyph is 3 bytes long in UTF-8 */
+#define BRAILLE_GLYPH_UTF8_LEN 3
+
 BLOT_EXTERN_C_START
 
 extern guint8 braille_order_map[BRAILLE_GLYPH_SIZE];
@@ -40,4 +43,7 @@ extern guint8 braille_upsidedown_order_map[BRAILLE_GLYPH_SIZE];
 extern guint8 braille_masks[BRAILLE_GLYPH_SIZE];
 extern guint8 braille_upsidedown_masks[BRAILLE_GLYPH_SIZE];
 
+/* UTF-8 encoding of BRAILLE_GLYPH_BASE + mask, for each mask */
+extern const guint8 braille_utf8[256][BRAILLE_GLYPH_UTF8_LEN];
+
 BLOT_EXTERN_C_END
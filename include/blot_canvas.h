@@ -5,11 +5,47 @@
 #include <glib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "blot_compiler.h"
 #include "blot_types.h"
 #include "blot_utils.h"
 #include "blot_braille.h"
+#include "blot_cpu.h"
+
+struct blot_arena;
+
+/* sparse canvases (BLOT_RENDER_SPARSE) keep their pixels in tiles that cover
+ * 64x64 pixels, 32x16 cells in braille, which are only allocated once
+ * something is drawn in them; a tile is 64 rows of 8 bytes in the 1-bit
+ * layout, or 16 rows of 32 cells in the braille layout */
+#define BLOT_CANVAS_TILE_PIXELS 64
+#define BLOT_CANVAS_TILE_BYTES  512
+
+typedef struct blot_canvas_tiles {
+	unsigned cols, rows;            // number of tiles across and down
+	unsigned tile_cols, tile_rows;  // cells (or pixels) in one row of a tile, and rows in a tile
+	unsigned count;                 // number of tiles drawn in, listed in used
+	bool failed;                    // a tile could not be allocated, the canvas is incomplete
+	guint8 *free;                   // tiles kept after a clear, linked through their first bytes
+	unsigned *used;                 // position of each tile in index, in the order they were drawn in
+	guint8 *index[];                // the tile at tx,ty is index[ty*cols + tx], NULL if never drawn in
+} blot_canvas_tiles;
+
+/* blocked canvases (BLOT_RENDER_BLOCKS) keep each block of 8x8 pixels in a
+ * 64-bit word, so that a vertical run stays in one word for 8 rows rather
+ * than touching a new row of the bitmap every row; in the 1-bit layout bit
+ * 8*y+x of a word is pixel x,y of its block, and in the braille layout byte
+ * 4*y+x is the cell x,y of the 4x2 cells in the block; a pixel is then the
+ * one bit that both its row mask and its column mask have set */
+#define BLOT_CANVAS_BLOCK_PIXELS 8
+
+typedef struct blot_canvas_blocks {
+	unsigned cols, rows;            // number of blocks across and down
+	guint64 row_masks[8];           // bits of a block in each of its rows of pixels
+	guint64 col_masks[8];           // bits of a block in each of its columns of pixels
+	guint32 row_words[];            // first word of the row of blocks holding each row of pixels
+} blot_canvas_blocks;
 
 typedef struct blot_canvas {
 	blot_dimensions dim;
@@ -27,6 +63,16 @@ typedef struct blot_canvas {
 		} no_braille;
 	};
 
+	blot_canvas_tiles *tiles;       // only when sparse, bitmap is then empty
+
+	/* indexed canvases (BLOT_RENDER_INDEXED) are shared by all the layers
+	 * of a figure, which draw in order; bitmap holds the glyph of each cell,
+	 * as a braille dot mask or 1, and layers the layer that drew it */
+	guint8 *layers;                 // only when indexed, 1 + index of the layer on top, 0 if empty
+	guint8 layer;                   // only when indexed, 1 + index of the layer drawing now
+
+	blot_canvas_blocks *blocks;     // only when blocked, bitmap then holds the words
+
 	gsize bitmap_size;              // number of bits available
 	gsize bitmap_bytes;             // byte size of bitmap array
 	guint8 bitmap[] __aligned64;    // must be at end of structure
@@ -43,8 +89,120 @@ BLOT_API blot_canvas * blot_canvas_new(unsigned cols, unsigned rows,
 				     GError **);
 BLOT_API void blot_canvas_delete(blot_canvas *fig);
 
+/* same as blot_canvas_new(), but carved out of arena, if not NULL; such a
+ * canvas is not deleted, it goes away with blot_arena_release(); sparse
+ * canvases allocate their tiles on the fly, so they never use the arena */
+BLOT_API blot_canvas * blot_canvas_new_in(struct blot_arena *arena,
+					unsigned cols, unsigned rows,
+					blot_render_flags flags, blot_color color,
+					GError **);
+
+/* sparse canvases, these are used by the inline functions below */
+BLOT_API guint8 * blot_canvas_tile(blot_canvas *can, unsigned tx, unsigned ty);
+BLOT_API void blot_canvas_clear_tiles(blot_canvas *can);
+
 BLOT_EXTERN_C_END
 
+/* the tile at tx,ty if it was drawn in, NULL otherwise */
+static inline const guint8 * blot_canvas_tile_peek(const blot_canvas *can, unsigned tx, unsigned ty)
+{
+	return can->tiles->index[(ty * can->tiles->cols) + tx];
+}
+
+/* draw mask into cell of an indexed canvas; the first time the current
+ * layer draws in a cell it replaces what the layers before it drew there */
+static inline void blot_canvas_index_or(blot_canvas *can, gsize cell, guint8 mask)
+{
+	if (can->layers[cell] != can->layer) {
+		can->layers[cell] = can->layer;
+		can->bitmap[cell] = mask;
+	} else {
+		can->bitmap[cell] |= mask;
+	}
+}
+
+/* the cell holding pixel col,row of an indexed canvas, and its bit */
+static inline gsize blot_canvas_index_cell(const blot_canvas *can, unsigned col, unsigned row,
+					   guint8 *mask)
+{
+	if (can->flags & BLOT_RENDER_BRAILLE) {
+		*mask = can->braille.masks[((row%4)*2) + (col%2)];
+		return ((row/4) * (can->dim.cols/2)) + (col/2);
+	}
+
+	*mask = 1;
+	return ((gsize)row * can->dim.cols) + col;
+}
+
+/* the word holding pixel col,row of a blocked canvas, and its bit */
+static inline guint64 blot_canvas_block_mask(const blot_canvas *can, unsigned col, unsigned row,
+					     gsize *word)
+{
+	const blot_canvas_blocks *blocks = can->blocks;
+
+	*word = blocks->row_words[row] + (col / BLOT_CANVAS_BLOCK_PIXELS);
+	return blocks->row_masks[row % BLOT_CANVAS_BLOCK_PIXELS]
+		& blocks->col_masks[col % BLOT_CANVAS_BLOCK_PIXELS];
+}
+
+static inline guint64 * blot_canvas_words(blot_canvas *can)
+{
+	return (guint64*)can->bitmap;
+}
+
+/* false when a sparse canvas ran out of memory for its tiles, and some of
+ * what was drawn is missing */
+static inline bool blot_canvas_complete(const blot_canvas *can)
+{
+	return !can->tiles || !can->tiles->failed;
+}
+
+/* where the byte holding pixel col,row lives, and which bit of it is the
+ * pixel; a NULL tile means it was never drawn in */
+static inline gsize blot_canvas_sparse_byte(const blot_canvas *can, unsigned col, unsigned row,
+					    unsigned *tx, unsigned *ty, guint8 *mask)
+{
+	const blot_canvas_tiles *tiles = can->tiles;
+
+	if (can->flags & BLOT_RENDER_BRAILLE) {
+		unsigned cx = col/2, cy = row/4;
+		*tx = cx / tiles->tile_cols;
+		*ty = cy / tiles->tile_rows;
+		*mask = can->braille.masks[((row%4)*2) + (col%2)];
+		return ((cy % tiles->tile_rows) * tiles->tile_cols) + (cx % tiles->tile_cols);
+	}
+
+	unsigned x = col % BLOT_CANVAS_TILE_PIXELS;
+	*tx = col / BLOT_CANVAS_TILE_PIXELS;
+	*ty = row / BLOT_CANVAS_TILE_PIXELS;
+	*mask = 1 << (x % BLOT_CANVAS_BITMAP_CELL_SIZE);
+	return ((row % BLOT_CANVAS_TILE_PIXELS) * (BLOT_CANVAS_TILE_PIXELS/8)) + (x / 8);
+}
+
+/* true if can is what blot_canvas_new() would return for these arguments,
+ * other than its color and contents */
+static inline bool blot_canvas_fits(const blot_canvas *can, unsigned cols, unsigned rows,
+				    blot_render_flags flags)
+{
+	if (flags & BLOT_RENDER_BRAILLE) {
+		cols *= BRAILLE_GLYPH_COLS;
+		rows *= BRAILLE_GLYPH_ROWS;
+	}
+
+	return can->dim.cols == cols && can->dim.rows == rows && can->flags == flags;
+}
+
+/* clear all the pixels, so that the canvas can be drawn again */
+static inline void blot_canvas_clear(blot_canvas *can)
+{
+	if (can->tiles) {
+		blot_canvas_clear_tiles(can);
+		return;
+	}
+
+	memset(can->bitmap, 0, can->bitmap_bytes);
+}
+
 /* render */
 
 static inline bool blot_canvas_set(blot_canvas *can, unsigned col, unsigned row, bool val)
@@ -57,6 +215,51 @@ static inline bool blot_canvas_set(blot_canvas *can, unsigned col, unsigned row,
 	if (unlikely (row >= can->dim.rows))
 		return false;
 
+	if (unlikely (can->tiles)) {
+		unsigned tx, ty;
+		guint8 mask;
+		gsize byte = blot_canvas_sparse_byte(can, col, row, &tx, &ty, &mask);
+
+		if (!val) {
+			guint8 *tile = (guint8*)blot_canvas_tile_peek(can, tx, ty);
+			if (tile)
+				tile[byte] &= ~mask;
+			return true;
+		}
+
+		guint8 *tile = blot_canvas_tile(can, tx, ty);
+		if (unlikely (!tile))
+			return false;
+		tile[byte] |= mask;
+		return true;
+	}
+
+	if (can->blocks) {
+		gsize word;
+		guint64 mask = blot_canvas_block_mask(can, col, row, &word);
+
+		if (val)
+			blot_canvas_words(can)[word] |= mask;
+		else
+			blot_canvas_words(can)[word] &= ~mask;
+		return true;
+	}
+
+	if (unlikely (can->layers)) {
+		guint8 mask;
+		gsize cell = blot_canvas_index_cell(can, col, row, &mask);
+
+		if (val) {
+			blot_canvas_index_or(can, cell, mask);
+		} else if (can->layers[cell] == can->layer) {
+			/* what the layers below drew here is gone already */
+			can->bitmap[cell] &= ~mask;
+			if (!can->bitmap[cell])
+				can->layers[cell] = 0;
+		}
+		return true;
+	}
+
 	if (can->flags & BLOT_RENDER_BRAILLE) {
 
 		unsigned byte = ((row/4) * (can->dim.cols/2)) + (col/2);
@@ -111,6 +314,29 @@ static inline bool blot_canvas_get(const blot_canvas *can, unsigned col, unsigne
 	if (row >= can->dim.rows)
 		return 0;
 
+	if (unlikely (can->tiles)) {
+		unsigned tx, ty;
+		guint8 mask;
+		gsize byte = blot_canvas_sparse_byte(can, col, row, &tx, &ty, &mask);
+		const guint8 *tile = blot_canvas_tile_peek(can, tx, ty);
+
+		return tile && (tile[byte] & mask);
+	}
+
+	if (can->blocks) {
+		gsize word;
+		guint64 mask = blot_canvas_block_mask(can, col, row, &word);
+
+		return !!(((const guint64*)can->bitmap)[word] & mask);
+	}
+
+	if (unlikely (can->layers)) {
+		guint8 mask;
+		gsize cell = blot_canvas_index_cell(can, col, row, &mask);
+
+		return !!(can->bitmap[cell] & mask);
+	}
+
 	if (can->flags & BLOT_RENDER_BRAILLE) {
 
 		unsigned byte = ((row/4) * (can->dim.cols/2)) + (col/2);
@@ -169,6 +395,24 @@ static inline wchar_t blot_canvas_get_cell(const blot_canvas *can,
 		if (cell_row >= max_cell_rows)
 			return 0;
 
+		if (unlikely (can->tiles)) {
+			const blot_canvas_tiles *tiles = can->tiles;
+			const guint8 *tile = blot_canvas_tile_peek(can, cell_col / tiles->tile_cols,
+								   cell_row / tiles->tile_rows);
+			unsigned char val = tile ? tile[((cell_row % tiles->tile_rows) * tiles->tile_cols)
+							+ (cell_col % tiles->tile_cols)] : 0;
+			return val ? BRAILLE_GLYPH_BASE + val : 0;
+		}
+
+		if (can->blocks) {
+			/* the cell is one byte of the word */
+			const blot_canvas_blocks *blocks = can->blocks;
+			guint64 word = ((const guint64*)can->bitmap)[blocks->row_words[cell_row * BRAILLE_GLYPH_ROWS]
+								      + (cell_col / 4)];
+			unsigned char val = word >> (8 * (((cell_row % 2) * 4) + (cell_col % 4)));
+			return val ? BRAILLE_GLYPH_BASE + val : 0;
+		}
+
 		unsigned idx = (cell_row * max_cell_cols) + cell_col;
 
 		g_assert_cmpuint(idx, <, can->bitmap_bytes);
@@ -194,55 +438,16 @@ static inline void blot_canvas_draw_point(blot_canvas *can, unsigned x, unsigned
 	blot_canvas_set(can, x, y, 1);
 }
 
-static inline void blot_canvas_draw_line(blot_canvas *can,
-					double x0, double y0,
-					double x1, double y1)
-{
-	double dx = x1 - x0;
-	double dy = y1 - y0;
-
-	double ax = abs_t(double,dx);
-	double ay = abs_t(double,dy);
-
-	g_assert_cmpuint(ax, >=, 0);
-	g_assert_cmpuint(ay, >=, 0);
-
-	if (ax<=1 && ay<=1) {
-		blot_canvas_draw_point(can, x0, y0);
-		return;
-	}
-
-	if (ax > ay) {
-		if (x0 < x1) {
-			double m = dy/dx;
-			double x, y;
-
-			for (x=x0, y=y0; x<=x1; x++, y+=m)
-				blot_canvas_draw_point(can, x, y);
-		} else {
-			double m = dy/dx;
-			double x, y;
-
-			for (x=x0, y=y0; x>=x1; x--, y-=m)
-				blot_canvas_draw_point(can, x, y);
-		}
-
-	} else /* ax < ay */ {
-		if (y0 < y1) {
-			double m = dx/dy;
-			double x, y;
+BLOT_EXTERN_C_START
 
-			for (x=x0, y=y0; y<=y1; y++, x+=m)
-				blot_canvas_draw_point(can, x, y);
-		} else {
-			double m = dx/dy;
-			double x, y;
+/* draws both end points and every pixel between them, using integer
+ * Bresenham steps; the parts of the line that are off canvas are
+ * clipped away before any pixels are visited */
+BLOT_API void blot_canvas_draw_line(blot_canvas *can,
+				    double x0, double y0,
+				    double x1, double y1);
 
-			for (x=x0, y=y0; y>=y1; y--, x-=m)
-				blot_canvas_draw_point(can, x, y);
-		}
-	}
-}
+BLOT_EXTERN_C_END
 
 static inline void blot_canvas_draw_rect(blot_canvas *can,
 					double x0, double y0,
@@ -254,20 +459,40 @@ static inline void blot_canvas_draw_rect(blot_canvas *can,
 	blot_canvas_draw_line(can, x0, y0, x1, y0);
 }
 
-static inline void blot_canvas_fill_rect(blot_canvas *can,
-					unsigned x0, unsigned y0,
-					unsigned x1, unsigned y1)
-{
-	if (x0 > x1)
-		swap_t(unsigned, x0, x1);
+BLOT_EXTERN_C_START
 
-	if (y0 > y1)
-		swap_t(unsigned, y0, y1);
+/* fills every pixel from x0,y0 to x1,y1 (inclusive, in any order), whole
+ * bytes and words at a time; the parts that are off canvas are dropped */
+BLOT_API void blot_canvas_fill_rect(blot_canvas *can,
+				    unsigned x0, unsigned y0,
+				    unsigned x1, unsigned y1);
 
-	for (unsigned y=y0; y<=y1; y++) {
-		for (unsigned x=x0; x<=x1; x++) {
-			blot_canvas_draw_point(can, x, y);
-		}
-	}
-}
+BLOT_EXTERN_C_END
+
+/* merge */
+
+BLOT_EXTERN_C_START
 
+/* set every pixel in dst that is set in src; both canvases must have the
+ * same dimensions and layout, which is the case for renders of one layer;
+ * for sparse canvases only the tiles drawn in src are visited, and an
+ * indexed dst takes what a plain src drew as drawn by its current layer */
+BLOT_API bool blot_canvas_merge(blot_canvas *dst, const blot_canvas *src, GError **);
+
+/* same as above, but using at most the given instruction set; this is used
+ * to test and benchmark each of the variants */
+BLOT_API bool blot_canvas_merge_simd(blot_simd_level level, blot_canvas *dst,
+				     const blot_canvas *src, GError **);
+
+BLOT_EXTERN_C_END
+
+/* scroll */
+
+BLOT_EXTERN_C_START
+
+/* move everything drawn to the left by cells glyph cells, which drops what
+ * was in the first ones, and clear the cells this uncovers on the right;
+ * byte-per-cell layouts move a row of cells at a time, others a pixel */
+BLOT_API void blot_canvas_shift_left(blot_canvas *can, unsigned cells);
+
+BLOT_EXTERN_C_END
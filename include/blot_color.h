@@ -48,10 +48,21 @@
 #define COL_RESET    ESC "0" COL_SUFFIX
 #define CLR_SCR      ESC "2J" ESC "H"
 
+/* a precomputed escape sequence, str is not NUL terminated */
+typedef struct blot_color_seq {
+	guint8 len;
+	char str[15];
+} blot_color_seq;
+
 BLOT_EXTERN_C_START
 
+/* fg() and bg() follow this; figures rendered with a blot_context use the
+ * color setting of that context instead */
 extern BLOT_API bool have_color_support;
 
+/* the foreground escape sequence for each of the 256 colors */
+extern BLOT_API const blot_color_seq blot_color_fg_seqs[256];
+
 BLOT_EXTERN_C_END
 
 /* runtime support */
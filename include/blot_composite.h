@@ -0,0 +1,54 @@
+/* blot: compositing of layer canvases, one screen row at a time */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+#include "blot_types.h"
+#include "blot_cpu.h"
+
+struct blot_canvas;
+
+/* layers are tracked in a byte per cell, 0 means no layer */
+#define BLOT_COMPOSITE_MAX_LAYERS 255
+
+/* number of guint64 words in the occupancy bits of a row of cols cells */
+#define BLOT_COMPOSITE_BLOCK_WORDS(cols) (((cols) + 64*64 - 1) / (64*64))
+
+/* one row of cells, merged from every canvas; where canvases overlap, the
+ * one that came last is on top */
+typedef struct blot_composite_row {
+	unsigned cols;                  // number of cells in the row
+	guint8 *glyphs;                 // braille dots of the top cell, or 1 for a plain pixel
+	guint8 *layers;                 // 1 + index of the canvas on top, or 0 if the cell is empty
+	guint64 *blocks;                // bit b is set if any of the cells [64b, 64b+64) is set
+	bool empty;                     // no cell in this row is set
+} blot_composite_row;
+
+BLOT_EXTERN_C_START
+
+BLOT_API bool blot_composite_row_init(blot_composite_row *row, unsigned cols, GError **);
+BLOT_API void blot_composite_row_cleanup(blot_composite_row *row);
+
+/* merge cell row c_y of count canvases into row, replacing what it held
+ * before; cells that fall outside of a canvas are empty in that canvas;
+ * an indexed canvas already knows its top layers, so it has to come alone,
+ * and its row is copied as is */
+BLOT_API bool blot_composite_row_merge(blot_composite_row *row, unsigned count,
+				       struct blot_canvas *const*cans, unsigned c_y, GError **);
+
+/* same as above, but using at most the given instruction set; this is used
+ * to test and benchmark each of the variants */
+BLOT_API bool blot_composite_row_merge_simd(blot_simd_level level, blot_composite_row *row,
+					    unsigned count, struct blot_canvas *const*cans,
+					    unsigned c_y, GError **);
+
+BLOT_EXTERN_C_END
+
+static inline bool blot_composite_block_used(const blot_composite_row *row, unsigned col)
+{
+	unsigned block = col / 64;
+	return !!(row->blocks[block / 64] & (1ull << (block % 64)));
+}
@@ -0,0 +1,47 @@
+/* blot: settings that used to be process-wide, for rendering on any thread */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+#include "blot_types.h"
+
+/* A figure that is given a context takes the color support and the terminal
+ * size from it, and never reads or writes process-wide state while it
+ * renders.  This makes rendering reentrant:
+ *
+ *   - different figures can be rendered on different threads at the same
+ *     time, each with its own context or sharing one;
+ *   - a context can be shared by any number of threads, as long as nobody
+ *     changes it while they render;
+ *   - a figure, its layers and a blot_render_ctx belong to one thread at a
+ *     time, since rendering updates the caches kept in them.
+ *
+ * Figures without a context use have_color_support and the size given to
+ * blot_terminal_set_size(), which must then not change during a render. */
+typedef struct blot_context {
+	bool color;                     // emit color escape sequences
+	blot_dimensions term;           // terminal size, for figures without a screen size;
+					// when zero, COLUMNS/LINES or the terminal are asked
+} blot_context;
+
+BLOT_EXTERN_C_START
+
+/* create/delete */
+
+BLOT_API bool blot_context_init(blot_context *bctx, GError **);
+BLOT_API blot_context * blot_context_new(GError **);
+BLOT_API void blot_context_delete(blot_context *bctx);
+
+/* configure */
+
+BLOT_API bool blot_context_set_color(blot_context *bctx, bool color, GError **);
+BLOT_API bool blot_context_set_term_size(blot_context *bctx, blot_dimensions dims, GError **);
+
+/* the terminal size of this context */
+BLOT_API bool blot_context_get_term_size(const blot_context *bctx, blot_dimensions *dims,
+					 GError **);
+
+BLOT_EXTERN_C_END
@@ -0,0 +1,25 @@
+/* blot: CPU feature detection */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+
+typedef enum blot_simd_level {
+	BLOT_SIMD_NONE,                 // plain C
+	BLOT_SIMD_SSE2,
+	BLOT_SIMD_AVX2,
+	BLOT_SIMD_AVX512,               // AVX-512 F + BW
+	BLOT_SIMD_LEVEL_MAX
+} blot_simd_level;
+
+BLOT_EXTERN_C_START
+
+/* best vector instruction set supported by this CPU, this can
+ * be lowered (but not raised) with the BLOT_SIMD=<n> environment
+ * variable, where <n> is one of the blot_simd_level values */
+BLOT_API blot_simd_level blot_cpu_simd_level(void);
+
+BLOT_EXTERN_C_END
@@ -7,14 +7,19 @@
 
 #include "blot_compiler.h"
 #include "blot_types.h"
+#include "blot_alloc.h"
+#include "blot_layer.h"
 
 #define BLOT_MIN_COLS 10
 #define BLOT_MIN_ROWS 10
 #define BLOT_MAX_COLS 1000
 #define BLOT_MAX_ROWS 1000
 
+struct blot_context;
+
 typedef struct blot_figure {
 	/* config */
+	const struct blot_context *context;     // NULL uses the process-wide settings
 	blot_color axis_color;
 
 	bool screen_dimensions_set;
@@ -23,15 +28,67 @@ typedef struct blot_figure {
 	bool x_limits_set;
 	bool y_limits_set;
 	blot_xy_limits lim;
+	bool y_autoscale_in_x;          // Y limits only come from points in the X limits
 
 	blot_strv xlabels;
 
 	/* layers */
 	gsize layer_count;
+	gsize layer_size;               // number of entries allocated in layers
 	struct blot_layer **layers;
 
+	/* axes of the last render, used again while their limits and length
+	 * stay the same, so that the ticks and labels are not redone */
+	struct blot_axis *x_axs, *y_axs;
+
+	/* stats */
+	blot_mem_stats render_mem;      // allocations made by the last render
+
 } blot_figure;
 
+/* what the canvas of a layer was last drawn from, for BLOT_RENDER_REUSE */
+typedef struct blot_render_memo {
+	blot_layer_key key;
+	blot_layer_summary summary;     // of the layer, when it was drawn
+	bool valid;                     // the canvas holds what key describes
+	bool reused;                    // the last render kept the canvas as it was
+	bool scrolled;                  // the last render shifted the canvas, then drew from begin on
+	size_t begin;                   // the last render only drew the points from here on
+	double x_origin;                // X at the left edge of the canvas, key.lim.x_min unless scrolled
+	double x_last;                  // X of the last point drawn
+} blot_render_memo;
+
+/* everything a figure renders into, kept between frames, so that rendering
+ * a figure of the same size again does not need to allocate anything;
+ * with BLOT_RENDER_REUSE, a layer whose data, limits, size and flags are
+ * the same as when its canvas was drawn is not drawn again, and a layer
+ * that only gained points since then only draws those; this does not
+ * apply to BLOT_RENDER_INDEXED, where all layers share a canvas
+ *
+ * BLOT_RENDER_SCROLL also keeps the canvas of a layer whose X ascends when
+ * the X window only moved right, as in a strip chart: the canvas is shifted
+ * left by whole cells, and only the points that come into view are drawn;
+ * the canvas then starts less than a cell right of the X limit, which is
+ * made up once it is drawn again; this does not apply with
+ * BLOT_RENDER_LEGEND_DETAILS, since the points that scroll out of view
+ * cannot be taken out of the summary */
+typedef struct blot_render_ctx {
+	gsize can_count;                // number of entries in cans, errors and memos
+	struct blot_canvas **cans;      // one per layer, or one for all with BLOT_RENDER_INDEXED
+	GError **errors;                // one per layer, for BLOT_RENDER_PARALLEL
+	blot_render_memo *memos;        // one per layer, for BLOT_RENDER_REUSE
+	struct blot_screen *scr;        // result of the last render
+
+	/* layers that were reused, that only drew their new points, that
+	 * were scrolled, and that were drawn again, by renders with
+	 * BLOT_RENDER_REUSE or BLOT_RENDER_SCROLL; these only ever count up */
+	gsize reuse_hits, reuse_appends, reuse_scrolls, reuse_misses;
+
+	/* internal: when set, everything above other than the screen is
+	 * carved out of this arena, and is released with it */
+	struct blot_arena *arena;
+} blot_render_ctx;
+
 /* create/delete */
 
 BLOT_EXTERN_C_START
@@ -41,8 +98,17 @@ BLOT_API blot_figure * blot_figure_new(GError **);
 BLOT_API void blot_figure_cleanup(blot_figure *fig);
 BLOT_API void blot_figure_delete(blot_figure *fig);
 
+BLOT_API bool blot_render_ctx_init(blot_render_ctx *ctx, GError **);
+BLOT_API blot_render_ctx * blot_render_ctx_new(GError **);
+BLOT_API void blot_render_ctx_cleanup(blot_render_ctx *ctx);
+BLOT_API void blot_render_ctx_delete(blot_render_ctx *ctx);
+
 /* configure */
 
+/* render with the color support and terminal size of bctx, which must stay
+ * around until the figure is deleted; see blot_context.h */
+BLOT_API bool blot_figure_set_context(blot_figure *fig, const struct blot_context *bctx, GError **);
+
 BLOT_API bool blot_figure_set_axis_color(blot_figure *fig, blot_color, GError **);
 
 BLOT_API bool blot_figure_set_screen_size(blot_figure *fig,
@@ -53,6 +119,10 @@ BLOT_API bool blot_figure_set_x_limits(blot_figure *fig,
 BLOT_API bool blot_figure_set_y_limits(blot_figure *fig,
 				     double y_min, double y_max, GError **);
 
+/* when only the X limits are set, compute the Y limits from just the
+ * points that fall between them, rather than from all of the data */
+BLOT_API bool blot_figure_set_y_autoscale_in_x(blot_figure *fig, bool enable, GError **);
+
 BLOT_API bool blot_figure_set_x_axis_labels(blot_figure *fig, size_t label_count,
 					  char **x_labels, GError **);
 
@@ -62,7 +132,24 @@ BLOT_API struct blot_screen * blot_figure_render(blot_figure *fig,
 					       blot_render_flags flags,
 					       GError **);
 
-/* add layers */
+/* same as above, but renders into the canvases, axes and screen kept in ctx,
+ * which are only reallocated when the dimensions or flags change; the screen
+ * returned belongs to ctx, and is valid until the next render into ctx */
+BLOT_API struct blot_screen * blot_figure_render_into(blot_figure *fig,
+						    blot_render_ctx *ctx,
+						    blot_render_flags flags,
+						    GError **);
+
+/* what the last blot_figure_render() or blot_figure_render_into() call
+ * allocated; the screen returned by blot_figure_render() is still in use */
+BLOT_API bool blot_figure_get_render_mem_stats(const blot_figure *fig,
+					      blot_mem_stats *stats, GError **);
+
+/* layers */
+
+/* the layer added by the index-th plot call, which stays owned by the figure;
+ * use it to tell the figure about changes to the data */
+BLOT_API struct blot_layer * blot_figure_get_layer(blot_figure *fig, gsize index, GError **);
 
 BLOT_API bool blot_figure_plot(blot_figure *fig,
 		      blot_plot_type plot_type, blot_data_type data_type,
@@ -70,6 +157,13 @@ BLOT_API bool blot_figure_plot(blot_figure *fig,
 		      blot_color data_color, const char *data_label,
 		      GError **error);
 
+/* add an empty ring layer, that owns its data and keeps the last capacity
+ * points given to blot_layer_append(); use blot_figure_get_layer() for it */
+BLOT_API bool blot_figure_plot_ring(blot_figure *fig,
+			   blot_plot_type plot_type, blot_data_type data_type,
+			   size_t capacity, blot_color data_color, const char *data_label,
+			   GError **error);
+
 BLOT_EXTERN_C_END
 
 static inline bool blot_figure_scatter(blot_figure *fig, blot_data_type data_type,
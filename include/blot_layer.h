@@ -4,6 +4,7 @@
 
 #include <glib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "blot_compiler.h"
 #include "blot_types.h"
@@ -16,6 +17,14 @@ typedef struct blot_layer_summary {
 	bool enabled; // when (render_flags & BLOT_RENDER_LEGEND_DETAILS)
 } blot_layer_summary;
 
+/* min/max of the first count values of one axis, as they were in the given
+ * data generation; a zeroed cache matches no generation, so it starts empty */
+typedef struct blot_layer_lim_cache {
+	guint64 generation;
+	size_t count;
+	double min, max;
+} blot_layer_lim_cache;
+
 typedef struct blot_layer {
 
 	blot_plot_type plot_type;
@@ -23,10 +32,28 @@ typedef struct blot_layer {
 	size_t count;
 	const void *xs;
 	const void *ys;
+
+	/* a ring layer owns xs/ys, which hold up to capacity points, starting
+	 * at head and wrapping around; capacity is 0 for all other layers */
+	size_t capacity;
+	size_t head;
+
 	blot_color color;
 	const char *label;
 	blot_layer_summary summary;
 
+	/* renewed when the data is replaced or changed, but not when it grows */
+	guint64 generation;
+	/* renewed by every change to the data, growth included; both are
+	 * unique across all layers, so keys of different layers never match */
+	guint64 revision;
+	blot_layer_lim_cache x_lim, y_lim;
+
+	/* how many of the first X values were checked, and if they ascend */
+	guint64 x_order_generation;
+	size_t x_order_count;
+	bool x_sorted;
+
 } blot_layer;
 
 /* create/delete */
@@ -43,10 +70,132 @@ BLOT_API blot_layer * blot_layer_new(blot_plot_type plot_type,
 				   GError **);
 BLOT_API void blot_layer_delete(blot_layer *fig);
 
+/* a layer that starts out empty, and keeps the last capacity points
+ * appended to it; xs and ys are both stored */
+BLOT_API blot_layer * blot_layer_new_ring(blot_plot_type plot_type,
+					blot_data_type data_type,
+					size_t capacity,
+					blot_color data_color,
+					const char *data_label,
+					GError **);
+
+/* the data was changed in place, so anything cached about it is stale */
+BLOT_API void blot_layer_touch(blot_layer *lay);
+
+/* replace the data with count new points */
+BLOT_API bool blot_layer_set_data(blot_layer *lay, size_t count,
+				  const void *xs, const void *ys, GError **);
+
+/* the data grew to count points, of which the first lay->count are
+ * unchanged; the arrays can have moved, and xs must still be NULL if it was
+ * NULL before; cached limits are extended with only the new points */
+BLOT_API bool blot_layer_extend(blot_layer *lay, size_t count,
+				const void *xs, const void *ys, GError **);
+
+/* copy count points to the end of a ring layer, dropping the oldest ones
+ * once it is full; xs and ys are of the layer's data types */
+BLOT_API bool blot_layer_append(blot_layer *lay, size_t count,
+				const void *xs, const void *ys, GError **);
+
 BLOT_EXTERN_C_END
 
+/* everything that decides what a layer draws into a canvas; two renders
+ * with equal keys draw the same pixels */
+typedef struct blot_layer_key {
+	const blot_layer *lay;
+	const void *xs, *ys;
+	size_t count, head;
+	guint64 generation, revision;
+	blot_plot_type plot_type;
+	blot_data_type data_type;
+	blot_xy_limits lim;
+	blot_dimensions dim;
+	blot_render_flags flags;
+} blot_layer_key;
+
+static inline void blot_layer_key_init(blot_layer_key *key, const blot_layer *lay,
+				       const blot_xy_limits *lim, const blot_dimensions *dim,
+				       blot_render_flags flags)
+{
+	/* keys are compared as bytes, so the padding has to be zero */
+	memset(key, 0, sizeof(*key));
+
+	key->lay        = lay;
+	key->xs         = lay->xs;
+	key->ys         = lay->ys;
+	key->count      = lay->count;
+	key->head       = lay->head;
+	key->generation = lay->generation;
+	key->revision   = lay->revision;
+	key->plot_type  = lay->plot_type;
+	key->data_type  = lay->data_type;
+	key->lim        = *lim;
+	key->dim        = *dim;
+	key->flags      = flags;
+}
+
+static inline bool blot_layer_key_equal(const blot_layer_key *a, const blot_layer_key *b)
+{
+	return !memcmp(a, b, sizeof(*a));
+}
+
+/* the data of key only grew since old was taken, no point was changed or
+ * dropped, so drawing the new points on top of what old drew gives the
+ * same pixels as drawing them all; the arrays can have moved */
+static inline bool blot_layer_key_extends(const blot_layer_key *key, const blot_layer_key *old)
+{
+	if (key->count <= old->count)
+		return false;
+
+	blot_layer_key tmp;
+	memcpy(&tmp, key, sizeof(tmp));
+	tmp.xs       = old->xs;
+	tmp.ys       = old->ys;
+	tmp.count    = old->count;
+	tmp.revision = old->revision;
+	return blot_layer_key_equal(&tmp, old);
+}
+
 /* data */
 
+/* a run of points that are next to each other in xs/ys, [begin,end) are
+ * positions in the arrays, and index is the point number of begin */
+typedef struct blot_layer_segment {
+	size_t begin, end;
+	size_t index;
+} blot_layer_segment;
+
+/* position in xs/ys of the index-th point */
+static inline size_t blot_layer_pos(const blot_layer *lay, size_t index)
+{
+	if (likely (!lay->capacity))
+		return index;
+
+	size_t pos = lay->head + index;
+	return pos >= lay->capacity ? pos - lay->capacity : pos;
+}
+
+/* split the points [begin,end) into at most two segments, returns how many */
+static inline unsigned blot_layer_segments(const blot_layer *lay, size_t begin, size_t end,
+					   blot_layer_segment segs[2])
+{
+	if (begin >= end)
+		return 0;
+
+	size_t first = blot_layer_pos(lay, begin);
+	size_t count = end - begin;
+
+	if (likely (!lay->capacity) || first + count <= lay->capacity) {
+		segs[0] = (blot_layer_segment){ first, first + count, begin };
+		return 1;
+	}
+
+	size_t head = lay->capacity - first;
+	segs[0] = (blot_layer_segment){ first, lay->capacity, begin };
+	segs[1] = (blot_layer_segment){ 0, count - head, begin + head };
+	return 2;
+}
+
 static inline bool blot_layer_get_x(const blot_layer *lay, unsigned index,
 				    double *x, GError **error)
 {
@@ -60,6 +209,8 @@ static inline bool blot_layer_get_x(const blot_layer *lay, unsigned index,
 		return true;
 	}
 
+	index = blot_layer_pos(lay, index);
+
 	switch (lay->data_type & BLOT_DATA_X_MASK) {
 	case BLOT_DATA_X_INT16:
 		*x = ((const gint16 *)lay->xs)[index];
@@ -91,6 +242,8 @@ static inline bool blot_layer_get_y(const blot_layer *lay, unsigned index,
 	RETURN_ERRORx(index > lay->count, false, error, ERANGE,
 		      "index %u is out of range %u", index, lay->count);
 
+	index = blot_layer_pos(lay, index);
+
 	switch (lay->data_type & BLOT_DATA_Y_MASK) {
 	case BLOT_DATA_Y_INT16:
 		*y = ((const gint16 *)lay->ys)[index];
@@ -128,15 +281,62 @@ static inline bool blot_layer_get_x_y(const blot_layer *lay, unsigned index,
 
 BLOT_EXTERN_C_START
 
-BLOT_API bool blot_layer_get_lim(const blot_layer *lay, blot_xy_limits *lim,
+/* limits of all the data, from values cached in the layer, so that only
+ * points added since the last call are looked at */
+BLOT_API bool blot_layer_get_lim(blot_layer *lay, blot_xy_limits *lim,
 			       GError **);
+BLOT_API bool blot_layer_get_x_lim(blot_layer *lay, double *x_min, double *x_max,
+				 GError **);
+BLOT_API bool blot_layer_get_y_lim(blot_layer *lay, double *y_min, double *y_max,
+				 GError **);
+
+/* Y limits of only the points with X in [x_min,x_max]; when X ascends
+ * this only looks at those points, found is false if there are none */
+BLOT_API bool blot_layer_get_y_lim_in_x(blot_layer *lay, double x_min, double x_max,
+				      double *y_min, double *y_max, bool *found,
+				      GError **);
+
+/* true if X never goes down; this is tracked as points are added, so only
+ * the points added since the last call are looked at */
+BLOT_API bool blot_layer_x_ascends(blot_layer *lay);
+
+/* index of the first point with X not below x, X has to ascend */
+BLOT_API size_t blot_layer_x_find(const blot_layer *lay, double x);
 
 /* render */
 
+/* layers with more points than this are split across threads, each thread
+ * draws its part into a private canvas, and those are merged at the end */
+#define BLOT_LAYER_PARALLEL_MIN (1u<<20)
+#define BLOT_LAYER_PARALLEL_GRAIN (1u<<18)
+
+/* canvas pixels per unit of X, as the plot type of the layer draws it on a
+ * canvas that is cols pixels wide */
+BLOT_API double blot_layer_x_scale(const blot_layer *lay, const blot_xy_limits *lim,
+				   unsigned cols);
+
 BLOT_API struct blot_canvas * blot_layer_render(blot_layer *lay,
 					      const blot_xy_limits *lim,
 					      const blot_dimensions *dim,
 					      blot_render_flags flags,
 					      GError **);
 
+/* same as above, but draws on top of an existing canvas, which has the
+ * dimensions dim and the render flags to use */
+BLOT_API bool blot_layer_render_into(blot_layer *lay,
+				     const blot_xy_limits *lim,
+				     const blot_dimensions *dim,
+				     struct blot_canvas *can,
+				     GError **);
+
+/* draws only the points from begin on, on top of a canvas that already
+ * holds the points before it, as drawn with the same limits and flags;
+ * they are added to lay->summary, which has to describe those points */
+BLOT_API bool blot_layer_render_append(blot_layer *lay,
+				       const blot_xy_limits *lim,
+				       const blot_dimensions *dim,
+				       struct blot_canvas *can,
+				       size_t begin,
+				       GError **);
+
 BLOT_EXTERN_C_END
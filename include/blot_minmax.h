@@ -0,0 +1,45 @@
+/* blot: vectorized min/max reduction over typed data arrays */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+#include "blot_types.h"
+#include "blot_cpu.h"
+
+/* arrays larger than this are split across threads */
+#define BLOT_MINMAX_PARALLEL_MIN (1u<<20)
+#define BLOT_MINMAX_PARALLEL_GRAIN (1u<<18)
+
+/* the element type of a single array, as one of the BLOT_DATA_X_* values */
+#define BLOT_DATA_X_ELEM(data_type) ((data_type) & BLOT_DATA_X_MASK)
+#define BLOT_DATA_Y_ELEM(data_type) (((data_type) & BLOT_DATA_Y_MASK) >> 4)
+
+static inline size_t blot_data_elem_size(blot_data_type elem_type)
+{
+	switch (elem_type) {
+	case BLOT_DATA_X_INT16: return sizeof(gint16);
+	case BLOT_DATA_X_INT32: return sizeof(gint32);
+	case BLOT_DATA_X_INT64: return sizeof(gint64);
+	case BLOT_DATA_X_FLOAT: return sizeof(float);
+	default:                return sizeof(double);
+	}
+}
+
+BLOT_EXTERN_C_START
+
+/* find the smallest and largest value in data[0..count), using the best
+ * vector instructions this CPU has, and multiple threads for large arrays;
+ * NaN values are ignored */
+BLOT_API bool blot_minmax(blot_data_type elem_type, const void *data, size_t count,
+			  double *min, double *max, GError **);
+
+/* same as above, but on one thread, and using at most the given instruction
+ * set; this is used to test and benchmark each of the variants */
+BLOT_API bool blot_minmax_simd(blot_simd_level level, blot_data_type elem_type,
+			       const void *data, size_t count,
+			       double *min, double *max, GError **);
+
+BLOT_EXTERN_C_END
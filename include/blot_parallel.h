@@ -0,0 +1,33 @@
+/* blot: internal worker threads for splitting up work */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+
+/* called once per chunk, with the [begin,end) range of items to process */
+typedef void (*blot_parallel_fn)(void *data, unsigned chunk,
+				 size_t begin, size_t end);
+
+BLOT_EXTERN_C_START
+
+#define BLOT_PARALLEL_MAX_THREADS 256
+
+/* number of threads that work can be split across, this defaults to the
+ * number of processors, and can be changed with BLOT_THREADS=<n> */
+BLOT_API unsigned blot_parallel_threads(void);
+
+static inline unsigned blot_parallel_chunks(size_t count, size_t grain)
+{
+	return (count + grain - 1) / grain;
+}
+
+/* split count items into chunks of grain items, and run fn on each chunk
+ * using the shared worker threads; the calling thread also processes chunks,
+ * so this can be safely called from inside another blot_parallel_for() */
+BLOT_API bool blot_parallel_for(size_t count, size_t grain,
+				blot_parallel_fn fn, void *data, GError **);
+
+BLOT_EXTERN_C_END
@@ -8,14 +8,29 @@
 #include "blot_compiler.h"
 #include "blot_types.h"
 #include "blot_utils.h"
+#include "blot_composite.h"
+
+/* UTF-8 text in a buffer that grows as needed, str is NUL terminated */
+typedef struct blot_screen_buf {
+	gchar *str;
+	gsize size, used;               // in bytes
+} blot_screen_buf;
+
+struct blot_screen_grid;
 
 typedef struct blot_screen {
 	blot_render_flags flags;
+	bool color;                     // color escape sequences are used, set from the blot_context
 	blot_dimensions dim;
 	blot_margins mrg;
-	gsize data_size, data_used;     // in number of gunichar
 
-	wchar_t data[] __aligned64;    // must be at end of structure
+	blot_screen_buf utf8;           // rendered text
+	blot_screen_buf diff;           // last output of blot_screen_diff()
+	struct blot_screen_grid *grid;  // cells of the rendered text, used by blot_screen_diff()
+	blot_composite_row row;         // canvases merged for one row, kept between renders
+
+	wchar_t *data;                  // same text as wide chars, unless BLOT_RENDER_UTF8
+	gsize data_size, data_used;     // in number of wchar_t
 } blot_screen;
 
 BLOT_EXTERN_C_START
@@ -27,8 +42,17 @@ BLOT_API blot_screen * blot_screen_new(const blot_dimensions *dim,
 				     blot_render_flags flags, GError **);
 BLOT_API void blot_screen_delete(blot_screen *scr);
 
+/* change the size, margins and flags of a screen, so that it can be
+ * rendered again without allocating a new one */
+BLOT_API bool blot_screen_reset(blot_screen *scr,
+			      const blot_dimensions *dim,
+			      const blot_margins *mrg,
+			      blot_render_flags flags, GError **);
+
 /* render */
 
+/* there is a canvas for each of the count layers, or with
+ * BLOT_RENDER_INDEXED, a single canvas that all of them were drawn into */
 BLOT_API bool blot_screen_render(blot_screen *scr,
 			       const blot_xy_limits *lim,
 			       const struct blot_axis * x_axs,
@@ -38,7 +62,21 @@ BLOT_API bool blot_screen_render(blot_screen *scr,
 			       struct blot_canvas *const*cans,
 			       GError **);
 
+/* the rendered text as wide characters, txt_size is the number of wchar_t;
+ * this is not available for screens rendered with BLOT_RENDER_UTF8 */
 BLOT_API const wchar_t * blot_screen_get_text(const blot_screen *scr,
 					     gsize *txt_size, GError**);
 
+/* the rendered text encoded as UTF-8, txt_size is the number of bytes */
+BLOT_API const char * blot_screen_get_utf8(const blot_screen *scr,
+					  gsize *txt_size, GError**);
+
+/* the UTF-8 text that updates a terminal showing prev to show scr; only the
+ * runs of cells that changed are written, each after a cursor positioning
+ * escape, unless redrawing the whole screen takes fewer bytes; with no prev,
+ * or one of a different size, the whole screen is redrawn; the text is owned
+ * by scr and is valid until its next render or diff */
+BLOT_API const char * blot_screen_diff(blot_screen *scr, blot_screen *prev,
+				      gsize *txt_size, GError**);
+
 BLOT_EXTERN_C_END
@@ -10,8 +10,15 @@
 
 BLOT_EXTERN_C_START
 
+/* process-wide size, used by figures without a blot_context */
 BLOT_API bool blot_terminal_set_size(blot_dimensions dims, GError **);
 BLOT_API bool blot_terminal_get_size(blot_dimensions *dims, GError **);
 
+/* ERANGE unless dims is within BLOT_MIN_* and BLOT_MAX_* */
+BLOT_API bool blot_terminal_check_size(blot_dimensions dims, GError **);
+
+/* ask COLUMNS/LINES, or the terminal on stdout, ignoring the size set above */
+BLOT_API bool blot_terminal_query_size(blot_dimensions *dims, GError **);
+
 BLOT_EXTERN_C_END
 
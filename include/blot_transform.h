@@ -0,0 +1,50 @@
+/* blot: batched data to canvas coordinate transform */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#pragma once
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "blot_compiler.h"
+#include "blot_types.h"
+#include "blot_cpu.h"
+
+/* points are transformed this many at a time, through buffers on the stack */
+#define BLOT_TRANSFORM_BATCH 256
+
+/* number of guint64 words in a visibility mask for count points */
+#define BLOT_TRANSFORM_MASK_WORDS(count) (((count) + 63) / 64)
+
+/* maps data values onto the canvas:
+ *
+ *   col = round((x - x_min) * x_scale)
+ *   row = round((y - y_min) * y_scale)
+ *
+ * a point is visible if 0 <= col < cols and 0 <= row < rows */
+typedef struct blot_transform {
+	double x_min, x_scale;
+	double y_min, y_scale;
+	unsigned cols, rows;
+} blot_transform;
+
+BLOT_EXTERN_C_START
+
+/* transform points [first, first+count) of the xs/ys arrays, which hold values of
+ * data_type (xs may be NULL, then the index is used as X); the coordinates are
+ * written to out_cols/out_rows[0..count), and bit i of visible[i/64] is set for
+ * every point that lands on the canvas (coordinates of invisible points are
+ * undefined); the number of visible points is stored in nvisible, if not NULL */
+BLOT_API bool blot_transform_points(const blot_transform *tr, blot_data_type data_type,
+				    const void *xs, const void *ys, size_t first, size_t count,
+				    gint32 *out_cols, gint32 *out_rows, guint64 *visible,
+				    size_t *nvisible, GError **);
+
+/* same as above, but using at most the given instruction set; this is used
+ * to test and benchmark each of the variants */
+BLOT_API bool blot_transform_points_simd(blot_simd_level level, const blot_transform *tr,
+					 blot_data_type data_type,
+					 const void *xs, const void *ys, size_t first, size_t count,
+					 gint32 *out_cols, gint32 *out_rows, guint64 *visible,
+					 size_t *nvisible, GError **);
+
+BLOT_EXTERN_C_END
@@ -75,6 +75,14 @@ typedef enum blot_render_flags {
 	BLOT_RENDER_NO_X_AXIS           = 0x00000080,
 	BLOT_RENDER_NO_Y_AXIS           = 0x00000100,
 	BLOT_RENDER_LEGEND_DETAILS      = 0x00000200,
+	BLOT_RENDER_NO_DECIMATION       = 0x00000400,   // draw every line segment, even when many share a column
+	BLOT_RENDER_PARALLEL            = 0x00000800,   // rasterize layers concurrently, on the worker threads
+	BLOT_RENDER_UTF8                = 0x00001000,   // only produce UTF-8 text, see blot_screen_get_utf8()
+	BLOT_RENDER_SPARSE              = 0x00002000,   // layer canvases allocate tiles on first write, see blot_canvas.h
+	BLOT_RENDER_INDEXED             = 0x00004000,   // all layers draw into one canvas that keeps the top layer of each cell
+	BLOT_RENDER_BLOCKS              = 0x00008000,   // layer canvases keep 8x8 pixels per 64-bit word, see blot_canvas.h
+	BLOT_RENDER_REUSE               = 0x00010000,   // keep the canvas of a layer that did not change, see blot_render_ctx
+	BLOT_RENDER_SCROLL              = 0x00020000,   // as REUSE, and shift canvases left as the X window moves right
 } blot_render_flags;
 DEFINE_ENUM_OPERATORS_FOR(blot_render_flags)
 
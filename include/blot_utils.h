@@ -46,6 +46,9 @@
 	(_a > _b) ? _a : _b;                                    \
 	})
 
+#define clamp_t(type,v,lo,hi) \
+	min_t(type, max_t(type, v, lo), hi)
+
 #define swap_t(type,a,b) ({                                     \
 	type _t = (a);                                          \
 	(a) = (b);                                              \
@@ -91,3 +94,42 @@ BLOT_API unsigned blot_env_to_uint(const char *name, unsigned dflt);
 BLOT_API int blot_format_number(char *p, unsigned room, double d_val);
 
 BLOT_EXTERN_C_END
+
+/* UTF-8 */
+
+#define BLOT_UTF8_MAX 4
+
+/* encode wch into p, which has room for BLOT_UTF8_MAX bytes, and return the
+ * number of bytes used */
+static inline unsigned blot_utf8_encode(char *p, gunichar wch)
+{
+	if (likely (wch < 0x80)) {
+		p[0] = wch;
+		return 1;
+	}
+	if (wch < 0x800) {
+		p[0] = 0xC0 | (wch >> 6);
+		p[1] = 0x80 | (wch & 0x3F);
+		return 2;
+	}
+	if (wch < 0x10000) {
+		p[0] = 0xE0 | (wch >> 12);
+		p[1] = 0x80 | ((wch >> 6) & 0x3F);
+		p[2] = 0x80 | (wch & 0x3F);
+		return 3;
+	}
+	p[0] = 0xF0 | (wch >> 18);
+	p[1] = 0x80 | ((wch >> 12) & 0x3F);
+	p[2] = 0x80 | ((wch >> 6) & 0x3F);
+	p[3] = 0x80 | (wch & 0x3F);
+	return 4;
+}
+
+/* number of characters in the first len bytes of a UTF-8 string */
+static inline gsize blot_utf8_count(const char *p, gsize len)
+{
+	gsize count = 0;
+	for (gsize i=0; i<len; i++)
+		count += ((guint8)p[i] & 0xC0) != 0x80;
+	return count;
+}
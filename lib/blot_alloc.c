@@ -0,0 +1,173 @@
+/* blot: memory allocation hooks and accounting */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include "blot_alloc.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+/* every block starts with its size, so that frees can be accounted for;
+ * the header is 16 bytes to keep the memory after it aligned */
+typedef struct blot_mem_header {
+	gsize size;
+	gsize pad;
+} blot_mem_header;
+
+static gpointer blot_default_malloc(gsize size, gpointer user_data)
+{
+	return g_malloc(size);
+}
+
+static gpointer blot_default_realloc(gpointer mem, gsize size, gpointer user_data)
+{
+	return g_realloc(mem, size);
+}
+
+static void blot_default_free(gpointer mem, gpointer user_data)
+{
+	g_free(mem);
+}
+
+static const blot_allocator blot_default_allocator = {
+	.malloc = blot_default_malloc,
+	.realloc = blot_default_realloc,
+	.free = blot_default_free,
+};
+
+static blot_allocator blot_alloc = blot_default_allocator;
+static blot_mem_stats blot_mem_global;
+static __thread blot_mem_stats *blot_mem_scope;
+
+/* accounting */
+
+static void blot_mem_stats_update(blot_mem_stats *st, gssize delta, gsize bytes)
+{
+	if (bytes) {
+		__atomic_add_fetch(&st->allocations, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&st->bytes_allocated, bytes, __ATOMIC_RELAXED);
+	}
+
+	gssize now = __atomic_add_fetch(&st->bytes_in_use, delta, __ATOMIC_RELAXED);
+	gssize peak = __atomic_load_n(&st->peak_bytes, __ATOMIC_RELAXED);
+	while (now > peak && !__atomic_compare_exchange_n(&st->peak_bytes, &peak, now, true,
+							   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/* delta is the change in bytes in use, bytes is what was just allocated */
+static inline void blot_mem_account(gssize delta, gsize bytes)
+{
+	blot_mem_stats_update(&blot_mem_global, delta, bytes);
+
+	if (blot_mem_scope)
+		blot_mem_stats_update(blot_mem_scope, delta, bytes);
+}
+
+bool blot_set_allocator(const blot_allocator *alloc, GError **error)
+{
+	RETURN_ERRORx(alloc && (!alloc->malloc || !alloc->realloc || !alloc->free),
+		      false, error, EINVAL, "allocator is missing a function");
+
+	/* memory must be freed by the allocator that handed it out */
+	gssize in_use = __atomic_load_n(&blot_mem_global.bytes_in_use, __ATOMIC_RELAXED);
+	RETURN_ERRORx(in_use != 0, false, error, EBUSY,
+		      "%zd bytes are still in use", in_use);
+
+	blot_alloc = alloc ? *alloc : blot_default_allocator;
+
+	return true;
+}
+
+void blot_get_mem_stats(blot_mem_stats *stats)
+{
+	stats->allocations = __atomic_load_n(&blot_mem_global.allocations, __ATOMIC_RELAXED);
+	stats->bytes_allocated = __atomic_load_n(&blot_mem_global.bytes_allocated, __ATOMIC_RELAXED);
+	stats->bytes_in_use = __atomic_load_n(&blot_mem_global.bytes_in_use, __ATOMIC_RELAXED);
+	stats->peak_bytes = __atomic_load_n(&blot_mem_global.peak_bytes, __ATOMIC_RELAXED);
+}
+
+void blot_reset_mem_stats(void)
+{
+	gssize in_use = __atomic_load_n(&blot_mem_global.bytes_in_use, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&blot_mem_global.allocations, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&blot_mem_global.bytes_allocated, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&blot_mem_global.peak_bytes, in_use, __ATOMIC_RELAXED);
+}
+
+blot_mem_stats * blot_mem_scope_enter(blot_mem_stats *stats)
+{
+	blot_mem_stats *prev = blot_mem_scope;
+	blot_mem_scope = stats;
+	return prev;
+}
+
+void blot_mem_scope_leave(blot_mem_stats *prev)
+{
+	blot_mem_scope = prev;
+}
+
+blot_mem_stats * blot_mem_scope_get(void)
+{
+	return blot_mem_scope;
+}
+
+/* allocate */
+
+gpointer blot_malloc(gsize size)
+{
+	if (unlikely (!size || size > G_MAXSSIZE - sizeof(blot_mem_header)))
+		return NULL;
+
+	blot_mem_header *hdr = blot_alloc.malloc(sizeof(*hdr) + size, blot_alloc.user_data);
+	if (unlikely (!hdr))
+		return NULL;
+
+	hdr->size = size;
+	blot_mem_account(size, size);
+
+	return hdr + 1;
+}
+
+gpointer blot_malloc0(gsize size)
+{
+	gpointer mem = blot_malloc(size);
+	if (mem)
+		memset(mem, 0, size);
+	return mem;
+}
+
+gpointer blot_realloc(gpointer mem, gsize size)
+{
+	if (!mem)
+		return blot_malloc(size);
+
+	if (!size) {
+		blot_free(mem);
+		return NULL;
+	}
+
+	if (unlikely (size > G_MAXSSIZE - sizeof(blot_mem_header)))
+		return NULL;
+
+	blot_mem_header *hdr = (blot_mem_header*)mem - 1;
+	gsize old_size = hdr->size;
+
+	hdr = blot_alloc.realloc(hdr, sizeof(*hdr) + size, blot_alloc.user_data);
+	if (unlikely (!hdr))
+		return NULL;
+
+	hdr->size = size;
+	blot_mem_account((gssize)size - (gssize)old_size, size);
+
+	return hdr + 1;
+}
+
+void blot_free(gpointer mem)
+{
+	if (!mem)
+		return;
+
+	blot_mem_header *hdr = (blot_mem_header*)mem - 1;
+	blot_mem_account(-(gssize)hdr->size, 0);
+
+	blot_alloc.free(hdr, blot_alloc.user_data);
+}
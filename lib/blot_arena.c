@@ -0,0 +1,82 @@
+/* blot: internal bump allocator for objects that live for a single render */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <string.h>
+#include "blot_arena.h"
+#include "blot_alloc.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+struct blot_arena_chunk {
+	struct blot_arena_chunk *prev;
+	guint8 data[] __aligned64;
+};
+
+bool blot_arena_init(blot_arena *arena, GError **error)
+{
+	RETURN_EFAULT_IF(arena==NULL, false, error);
+
+	memset(arena, 0, sizeof(*arena));
+	arena->chunk_size = BLOT_ARENA_CHUNK_SIZE;
+
+	return true;
+}
+
+/* start a new chunk that can hold at least size bytes */
+static bool blot_arena_grow(blot_arena *arena, gsize size, GError **error)
+{
+	gsize data_size = max_t(gsize, arena->chunk_size, size);
+
+	/* blot_malloc() only aligns to 16 bytes, so leave room to align the chunk */
+	gsize total_size = sizeof(struct blot_arena_chunk) + data_size + BLOT_ARENA_ALIGN;
+	void *mem = blot_malloc(total_size);
+	RETURN_ERROR(!mem, false, error, "new blot_arena_chunk [%zu]", data_size);
+
+	/* the pointer to free sits just before the aligned chunk */
+	struct blot_arena_chunk *chunk = ALIGN_PTR_UP((guint8*)mem + sizeof(void*),
+						      BLOT_ARENA_ALIGN);
+	((void**)chunk)[-1] = mem;
+
+	chunk->prev = arena->chunk;
+	arena->chunk = chunk;
+	arena->next = chunk->data;
+	arena->end = chunk->data + data_size;
+
+	/* an oversized request gets a chunk of its own */
+	if (data_size == arena->chunk_size)
+		arena->chunk_size *= 2;
+
+	return true;
+}
+
+void * blot_arena_alloc(blot_arena *arena, gsize size, GError **error)
+{
+	RETURN_EFAULT_IF(arena==NULL, NULL, error);
+
+	size = ALIGN_SIZE_UP(max_t(gsize, size, 1), BLOT_ARENA_ALIGN);
+
+	if (unlikely (size > (gsize)(arena->end - arena->next))) {
+		bool ok = blot_arena_grow(arena, size, error);
+		RETURN_IF(!ok, NULL);
+	}
+
+	void *p = arena->next;
+	arena->next += size;
+	arena->used += size;
+
+	return p;
+}
+
+void blot_arena_release(blot_arena *arena)
+{
+	struct blot_arena_chunk *chunk = arena->chunk;
+
+	while (chunk) {
+		struct blot_arena_chunk *prev = chunk->prev;
+		blot_free(((void**)chunk)[-1]);
+		chunk = prev;
+	}
+
+	arena->chunk = NULL;
+	arena->next = arena->end = NULL;
+	arena->used = 0;
+}
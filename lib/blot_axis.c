@@ -4,6 +4,8 @@
 #include <math.h>
 #include <string.h>
 #include "blot_axis.h"
+#include "blot_alloc.h"
+#include "blot_arena.h"
 #include "blot_error.h"
 #include "blot_types.h"
 #include "blot_utils.h"
@@ -12,6 +14,22 @@
 
 /* create/delete */
 
+/* grow the allocation of axs to size bytes, if needed; the old contents
+ * are not kept, since the axis is always built again from scratch */
+static blot_axis * blot_axis_alloc(blot_axis *axs, blot_arena *arena, gsize size)
+{
+	if (axs && axs->alloc_size >= size)
+		return axs;
+
+	if (arena)
+		axs = blot_arena_alloc(arena, size, NULL);
+	else
+		axs = blot_realloc(axs, size);
+	if (axs)
+		axs->alloc_size = size;
+	return axs;
+}
+
 blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 			  blot_color color,
 			  unsigned screen_length,
@@ -19,8 +37,27 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 			  const blot_strv *labels,
 			  GError **error)
 {
-	RETURN_ERRORx(screen_length == 0, NULL, error, EINVAL, "screen_length cannot be zero");
-	RETURN_ERRORx(data_min >= data_max, NULL, error, EINVAL, "data_min must be less than data_max");
+	return blot_axis_renew(NULL, NULL, is_vertical, is_visible, color, screen_length,
+			       data_min, data_max, labels, error);
+}
+
+static inline void blot_axis_set_labels(blot_axis *axs, const blot_strv *labels)
+{
+	axs->labels.count = labels ? labels->count : 0;
+	axs->labels.strings = axs->labels.count ? labels->strings : NULL;
+}
+
+/* builds the axis into *paxs, which is updated as soon as it is reallocated */
+static bool blot_axis_build(blot_axis **paxs, blot_arena *arena,
+			    bool is_vertical, bool is_visible,
+			    blot_color color,
+			    unsigned screen_length,
+			    double data_min, double data_max,
+			    const blot_strv *labels,
+			    GError **error)
+{
+	RETURN_ERRORx(screen_length == 0, false, error, EINVAL, "screen_length cannot be zero");
+	RETURN_ERRORx(data_min >= data_max, false, error, EINVAL, "data_min must be less than data_max");
 
 	blot_axis *axs;
 
@@ -28,8 +65,9 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 
 	if (!is_visible) {
 
-		axs = g_new0(blot_axis, 1);
-		RETURN_ERROR(!axs, NULL, error, "new blot_axis");
+		axs = blot_axis_alloc(*paxs, arena, sizeof(blot_axis));
+		RETURN_ERROR(!axs, false, error, "new blot_axis");
+		*paxs = axs;
 
 		axs->is_vertical = is_vertical;
 		axs->is_visible = is_visible;
@@ -37,8 +75,9 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 		axs->screen_length = screen_length;
 		axs->data_min = data_min;
 		axs->data_max = data_max;
+		blot_axis_set_labels(axs, labels);
 
-		return axs;
+		return true;
 
 	}
 
@@ -98,9 +137,10 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 		+ tick_count * sizeof(blot_axis_tick)
 		+ string_bytes;
 
-	axs = g_malloc(total_size);
-	RETURN_ERROR(!axs, NULL, error, "new blot_axis(%u,%u,%zu",
+	axs = blot_axis_alloc(*paxs, arena, total_size);
+	RETURN_ERROR(!axs, false, error, "new blot_axis(%u,%u,%zu",
 		     screen_length, tick_count, string_bytes);
+	*paxs = axs;
 
 	/* populate the constants */
 
@@ -110,6 +150,7 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 	axs->screen_length = screen_length;
 	axs->data_min = data_min;
 	axs->data_max = data_max;
+	blot_axis_set_labels(axs, labels);
 
 	memset(axs->entries, 0, screen_length * sizeof(axs->entries[0])); // NOLINT - we want the sizeof a pointer
 
@@ -140,7 +181,7 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 			if (!is_vertical)
 				room = min_t(size_t, end-p, floor(s_jump));
 			int rc = blot_format_number(p, (unsigned)room, d_val);
-			RETURN_ERROR(rc<0, NULL, error,
+			RETURN_ERROR(rc<0, false, error,
 				     "axis label for %f format", d_val);
 			g_assert_cmpuint(rc, <=, BLOT_AXIS_LABEL_MAX);
 			label = p;
@@ -159,11 +200,35 @@ blot_axis * blot_axis_new(bool is_vertical, bool is_visible,
 
 	g_assert(p <= end);
 
+	return true;
+}
+
+blot_axis * blot_axis_renew(blot_axis *axs, blot_arena *arena,
+			    bool is_vertical, bool is_visible,
+			    blot_color color,
+			    unsigned screen_length,
+			    double data_min, double data_max,
+			    const blot_strv *labels,
+			    GError **error)
+{
+	/* same limits and size as the last time, so the ticks are the same */
+	if (blot_axis_matches(axs, is_vertical, is_visible, color, screen_length,
+			      data_min, data_max, labels))
+		return axs;
+
+	bool ok = blot_axis_build(&axs, arena, is_vertical, is_visible, color,
+				  screen_length, data_min, data_max, labels, error);
+	if (!ok) {
+		if (!arena)
+			blot_axis_delete(axs);
+		return NULL;
+	}
+
 	return axs;
 }
 
 void blot_axis_delete(blot_axis *axs)
 {
-	g_free(axs);
+	blot_free(axs);
 }
 
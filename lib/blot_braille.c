@@ -29,3 +29,13 @@ guint8 braille_upsidedown_masks[BRAILLE_GLYPH_SIZE] = {
 	0x02, 0x10,
 	0x01, 0x08,
 };
+
+/* U+2800..U+28FF encode as E2 A0..A3 80..BF */
+#define BRAILLE_UTF8(m)    { 0xE2, 0xA0 | ((m) >> 6), 0x80 | ((m) & 0x3F) }
+#define BRAILLE_UTF8_4(m)  BRAILLE_UTF8(m), BRAILLE_UTF8(m+1), BRAILLE_UTF8(m+2), BRAILLE_UTF8(m+3)
+#define BRAILLE_UTF8_16(m) BRAILLE_UTF8_4(m), BRAILLE_UTF8_4(m+4), BRAILLE_UTF8_4(m+8), BRAILLE_UTF8_4(m+12)
+#define BRAILLE_UTF8_64(m) BRAILLE_UTF8_16(m), BRAILLE_UTF8_16(m+16), BRAILLE_UTF8_16(m+32), BRAILLE_UTF8_16(m+48)
+
+const guint8 braille_utf8[256][BRAILLE_GLYPH_UTF8_LEN] = {
+	BRAILLE_UTF8_64(0), BRAILLE_UTF8_64(64), BRAILLE_UTF8_64(128), BRAILLE_UTF8_64(192),
+};
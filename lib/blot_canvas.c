@@ -1,15 +1,60 @@
 /* blot: a canvas is a render of a single layer w/o colour coding */
 /* vim: set noet sw=8 ts=8 tw=120: */
+#include <stdint.h>
 #include <string.h>
+#include <math.h>
 #include "blot_canvas.h"
+#include "blot_alloc.h"
+#include "blot_arena.h"
 #include "blot_braille.h"
 #include "blot_error.h"
+#include "blot_cpu.h"
+#include "blot_utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOT_CANVAS_X86 1
+#endif
 
 /* create/delete */
 
-blot_canvas * blot_canvas_new(unsigned _cols, unsigned _rows,
+/* the bits of each row and column of pixels in a block, see blot_canvas.h */
+static void blot_canvas_block_masks(const blot_canvas *can, blot_canvas_blocks *blocks)
+{
+	if (!(can->flags & BLOT_RENDER_BRAILLE)) {
+		for (unsigned i=0; i<8; i++) {
+			blocks->row_masks[i] = 0xFFull << (8*i);
+			blocks->col_masks[i] = 0x0101010101010101ull << i;
+		}
+		return;
+	}
+
+	const guint8 *masks = can->braille.masks;
+
+	for (unsigned i=0; i<8; i++) {
+		/* a row has both dots of its row of every cell, in its half */
+		guint64 dots = masks[(i%4)*2] | masks[((i%4)*2) + 1];
+		blocks->row_masks[i] = (dots * 0x01010101ull) << (32 * (i/4));
+
+		/* a column has all four dots of its side of a cell, in both halves */
+		dots = 0;
+		for (unsigned j=0; j<4; j++)
+			dots |= masks[(j*2) + (i%2)];
+		blocks->col_masks[i] = (dots * 0x0000000100000001ull) << (8 * (i/2));
+	}
+}
+
+blot_canvas * blot_canvas_new(unsigned cols, unsigned rows,
 			      blot_render_flags flags, blot_color color,
 			      GError **error)
+{
+	return blot_canvas_new_in(NULL, cols, rows, flags, color, error);
+}
+
+blot_canvas * blot_canvas_new_in(struct blot_arena *arena,
+				 unsigned _cols, unsigned _rows,
+				 blot_render_flags flags, blot_color color,
+				 GError **error)
 {
 	RETURN_ERRORx(_cols == 0 || _rows == 0, NULL, error, EINVAL, "dimensions cannot be zero");
 
@@ -32,9 +77,54 @@ blot_canvas * blot_canvas_new(unsigned _cols, unsigned _rows,
 	gsize bitmap_bytes = (bitmap_size + BLOT_CANVAS_BITMAP_CELL_SIZE - 1)
 		/ BLOT_CANVAS_BITMAP_CELL_SIZE;
 
+	blot_render_flags layout = flags & (BLOT_RENDER_SPARSE | BLOT_RENDER_INDEXED | BLOT_RENDER_BLOCKS);
+	RETURN_ERRORx(layout & (layout - 1), NULL, error, EINVAL,
+		      "flags BLOT_RENDER_SPARSE, BLOT_RENDER_INDEXED and "
+		      "BLOT_RENDER_BLOCKS are exclusive");
+
+	/* an indexed canvas has a glyph and a layer for each cell */
+	gsize cells = (flags & BLOT_RENDER_BRAILLE) ? (gsize)_cols * _rows : bitmap_size;
+	if (flags & BLOT_RENDER_INDEXED)
+		bitmap_bytes = 2 * cells;
+
+	/* a blocked canvas has a word per block, followed by its tables */
+	unsigned blocks_x = 0, blocks_y = 0;
+	gsize blocks_offset = 0;
+	if (flags & BLOT_RENDER_BLOCKS) {
+		blocks_x = (cols + BLOT_CANVAS_BLOCK_PIXELS - 1) / BLOT_CANVAS_BLOCK_PIXELS;
+		blocks_y = (rows + BLOT_CANVAS_BLOCK_PIXELS - 1) / BLOT_CANVAS_BLOCK_PIXELS;
+		RETURN_ERRORx((gsize)blocks_x * blocks_y > UINT32_MAX, NULL, error, ERANGE,
+			      "too many blocks for a %ux%u canvas", cols, rows);
+
+		blocks_offset = (gsize)blocks_x * blocks_y * sizeof(guint64);
+		bitmap_bytes = blocks_offset + sizeof(blot_canvas_blocks)
+			+ (gsize)rows * sizeof(guint32);
+	}
+
+	/* a sparse canvas only holds the index of its tiles */
+	unsigned tile_cols = 0, tile_rows = 0, tiles_x = 0, tiles_y = 0;
+	if (flags & BLOT_RENDER_SPARSE) {
+		bool braille = flags & BLOT_RENDER_BRAILLE;
+		tile_cols = BLOT_CANVAS_TILE_PIXELS / (braille ? BRAILLE_GLYPH_COLS : 1);
+		tile_rows = BLOT_CANVAS_TILE_PIXELS / (braille ? BRAILLE_GLYPH_ROWS : 1);
+		tiles_x = ((braille ? _cols : cols) + tile_cols - 1) / tile_cols;
+		tiles_y = ((braille ? _rows : rows) + tile_rows - 1) / tile_rows;
+
+		gsize tile_count = (gsize)tiles_x * tiles_y;
+		bitmap_bytes = sizeof(blot_canvas_tiles)
+			+ tile_count * (sizeof(guint8*) + sizeof(unsigned));
+		arena = NULL;
+	}
+
 	gsize total_size = sizeof(blot_canvas) + bitmap_bytes;
-	blot_canvas *can = g_malloc(total_size);
-	RETURN_ERROR(!can, NULL, error, "new blot_canvas [%zu]", bitmap_size);
+	blot_canvas *can;
+	if (arena) {
+		can = blot_arena_alloc(arena, total_size, error);
+		RETURN_IF(!can, NULL);
+	} else {
+		can = blot_malloc(total_size);
+		RETURN_ERROR(!can, NULL, error, "new blot_canvas [%zu]", bitmap_size);
+	}
 
 	can->dim.cols     = cols;
 	can->dim.rows     = rows;
@@ -53,11 +143,932 @@ blot_canvas * blot_canvas_new(unsigned _cols, unsigned _rows,
 	}
 
 	memset(can->bitmap, 0, bitmap_bytes);
+	can->tiles = NULL;
+	can->layers = (flags & BLOT_RENDER_INDEXED) ? can->bitmap + cells : NULL;
+	can->layer = 1;
+	can->blocks = NULL;
+
+	if (flags & BLOT_RENDER_BLOCKS) {
+		blot_canvas_blocks *blocks = (blot_canvas_blocks*)(can->bitmap + blocks_offset);
+		blocks->cols = blocks_x;
+		blocks->rows = blocks_y;
+		blot_canvas_block_masks(can, blocks);
+		for (unsigned row=0; row<rows; row++)
+			blocks->row_words[row] = (row / BLOT_CANVAS_BLOCK_PIXELS) * blocks_x;
+
+		can->blocks = blocks;
+		can->bitmap_bytes = blocks_offset;
+	}
+
+	if (flags & BLOT_RENDER_SPARSE) {
+		blot_canvas_tiles *tiles = (blot_canvas_tiles*)can->bitmap;
+		tiles->cols      = tiles_x;
+		tiles->rows      = tiles_y;
+		tiles->tile_cols = tile_cols;
+		tiles->tile_rows = tile_rows;
+		tiles->used      = (unsigned*)(tiles->index + (gsize)tiles_x * tiles_y);
+
+		can->tiles = tiles;
+		can->bitmap_bytes = 0;
+	}
 
 	return can;
 }
+
+static guint8 * blot_canvas_tile_pop_free(blot_canvas_tiles *tiles)
+{
+	guint8 *tile = tiles->free;
+	if (tile)
+		memcpy(&tiles->free, tile, sizeof(tiles->free));
+	return tile;
+}
+
 void blot_canvas_delete(blot_canvas *can)
 {
-	g_free(can);
+	if (!can)
+		return;
+
+	if (can->tiles) {
+		blot_canvas_clear_tiles(can);
+		for (guint8 *tile; (tile = blot_canvas_tile_pop_free(can->tiles)); )
+			blot_free(tile);
+	}
+
+	blot_free(can);
 }
 
+
+/* tiles
+ *
+ * Tiles that are drawn in are listed in the order they were first used, so
+ * that clearing a sparse canvas only visits those.  A clear keeps the tiles
+ * on a free list, so a canvas that is drawn again and again stops allocating
+ * once it has seen as many tiles as it needs. */
+
+guint8 * blot_canvas_tile(blot_canvas *can, unsigned tx, unsigned ty)
+{
+	blot_canvas_tiles *tiles = can->tiles;
+	unsigned ti = (ty * tiles->cols) + tx;
+
+	g_assert_cmpuint(tx, <, tiles->cols);
+	g_assert_cmpuint(ty, <, tiles->rows);
+
+	guint8 *tile = tiles->index[ti];
+	if (likely (tile))
+		return tile;
+
+	tile = blot_canvas_tile_pop_free(tiles);
+	if (!tile)
+		tile = blot_malloc(BLOT_CANVAS_TILE_BYTES);
+	if (unlikely (!tile)) {
+		tiles->failed = true;
+		return NULL;
+	}
+
+	memset(tile, 0, BLOT_CANVAS_TILE_BYTES);
+	tiles->index[ti] = tile;
+	tiles->used[tiles->count++] = ti;
+	return tile;
+}
+
+void blot_canvas_clear_tiles(blot_canvas *can)
+{
+	blot_canvas_tiles *tiles = can->tiles;
+
+	for (unsigned i=0; i<tiles->count; i++) {
+		guint8 *tile = tiles->index[tiles->used[i]];
+		memcpy(tile, &tiles->free, sizeof(tiles->free));
+		tiles->free = tile;
+		tiles->index[tiles->used[i]] = NULL;
+	}
+
+	tiles->count = 0;
+	tiles->failed = false;
+}
+
+
+/* spans
+ *
+ * Horizontal and vertical runs of pixels, and rectangles, are written whole
+ * bytes (and words) at a time, rather than one pixel at a time.  All of the
+ * coordinates passed in are inclusive, ordered, and already on the canvas.
+ *
+ * In the 1-bit layout a horizontal run is a contiguous range of bits, which
+ * is a partial byte at either end, and whole bytes between.  In the braille
+ * layout each byte is a cell of 2x4 pixels, so a run is a repeated byte value
+ * (with the edge cells using only one of their columns), and a vertical run
+ * covers up to four rows of a cell with one write.  In the blocked layouts
+ * any rectangle within a block is one write, of its row and column masks. */
+
+/* all bits from first to last, inclusive */
+static void blot_bits_or(guint8 *bitmap, gsize first, gsize last)
+{
+	gsize b0 = first / 8, b1 = last / 8;
+	guint8 head = 0xFF << (first % 8);
+	guint8 tail = 0xFF >> (7 - (last % 8));
+
+	if (b0 == b1) {
+		bitmap[b0] |= head & tail;
+		return;
+	}
+
+	bitmap[b0] |= head;
+	memset(bitmap + b0 + 1, 0xFF, b1 - b0 - 1);
+	bitmap[b1] |= tail;
+}
+
+/* the same byte value into n consecutive bytes */
+static void blot_bytes_or(guint8 *p, gsize n, guint8 val)
+{
+	guint64 val64 = val * 0x0101010101010101ull;
+
+	for (; n >= 8; n -= 8, p += 8) {
+		guint64 word;
+		memcpy(&word, p, sizeof(word));
+		word |= val64;
+		memcpy(p, &word, sizeof(word));
+	}
+
+	for (; n; n--, p++)
+		*p |= val;
+}
+
+/* running ORs of the braille dots in one column of a cell, the dots for rows
+ * a..b (0..3) are pre[b+1] & ~pre[a], since every dot is a different bit */
+static inline void blot_braille_column_prefix(const blot_canvas *can, unsigned col, guint8 pre[5])
+{
+	pre[0] = 0;
+	for (unsigned j=0; j<4; j++)
+		pre[j+1] = pre[j] | can->braille.masks[(j*2) + (col%2)];
+}
+
+static inline guint8 blot_braille_rows(const guint8 pre[5], unsigned a, unsigned b)
+{
+	return pre[b+1] & ~pre[a];
+}
+
+/* a filled rectangle of the braille layout, one row of cells at a time */
+static void blot_span_braille_rect(blot_canvas *can, unsigned c0, unsigned r0,
+				   unsigned c1, unsigned r1)
+{
+	unsigned cell_cols = can->dim.cols / 2;
+	unsigned x0 = c0 / 2, x1 = c1 / 2;
+	guint8 left[5], right[5];
+
+	blot_braille_column_prefix(can, 0, left);
+	blot_braille_column_prefix(can, 1, right);
+
+	for (unsigned row=r0; row<=r1; ) {
+		/* the rows of the rectangle that are in this row of cells */
+		unsigned last = min_t(unsigned, r1, row | 3);
+		guint8 lmask = blot_braille_rows(left, row % 4, last % 4);
+		guint8 rmask = blot_braille_rows(right, row % 4, last % 4);
+		guint8 *cells = can->bitmap + (row / 4) * cell_cols;
+
+		/* the edge cells may only have one of their columns inside */
+		guint8 first_mask = (c0 % 2 ? 0 : lmask) | (x0 < x1 || c1 % 2 ? rmask : 0);
+		cells[x0] |= first_mask;
+
+		if (x1 > x0) {
+			blot_bytes_or(cells + x0 + 1, x1 - x0 - 1, lmask | rmask);
+			cells[x1] |= lmask | (c1 % 2 ? rmask : 0);
+		}
+
+		row = last + 1;
+	}
+}
+
+/* a filled rectangle of a sparse canvas, one row of a tile at a time, with
+ * the same masks as the dense layouts use */
+static void blot_span_sparse_rect(blot_canvas *can, unsigned c0, unsigned r0,
+				  unsigned c1, unsigned r1)
+{
+	const blot_canvas_tiles *tiles = can->tiles;
+	unsigned tc = tiles->tile_cols, tr = tiles->tile_rows;
+
+	if (!(can->flags & BLOT_RENDER_BRAILLE)) {
+		for (unsigned row=r0; row<=r1; row++) {
+			for (unsigned tx=c0/tc; tx<=c1/tc; tx++) {
+				guint8 *tile = blot_canvas_tile(can, tx, row / tr);
+				if (unlikely (!tile))
+					return;
+
+				unsigned first = max_t(unsigned, c0, tx*tc) - tx*tc;
+				unsigned last = min_t(unsigned, c1, (tx*tc) + tc - 1) - tx*tc;
+				blot_bits_or(tile + (row % tr) * (tc/8), first, last);
+			}
+		}
+		return;
+	}
+
+	unsigned x0 = c0 / 2, x1 = c1 / 2;
+	guint8 left[5], right[5];
+
+	blot_braille_column_prefix(can, 0, left);
+	blot_braille_column_prefix(can, 1, right);
+
+	for (unsigned row=r0; row<=r1; ) {
+		unsigned last = min_t(unsigned, r1, row | 3);
+		guint8 lmask = blot_braille_rows(left, row % 4, last % 4);
+		guint8 rmask = blot_braille_rows(right, row % 4, last % 4);
+		guint8 first_mask = (c0 % 2 ? 0 : lmask) | (x0 < x1 || c1 % 2 ? rmask : 0);
+		guint8 last_mask = lmask | (c1 % 2 ? rmask : 0);
+		unsigned cy = row / 4;
+
+		for (unsigned tx=x0/tc; tx<=x1/tc; tx++) {
+			guint8 *tile = blot_canvas_tile(can, tx, cy / tr);
+			if (unlikely (!tile))
+				return;
+
+			guint8 *cells = tile + (cy % tr) * tc;
+			unsigned cx0 = max_t(unsigned, x0, tx*tc);
+			unsigned cx1 = min_t(unsigned, x1, (tx*tc) + tc - 1);
+
+			for (unsigned cx=cx0; cx<=cx1; cx++)
+				cells[cx - tx*tc] |= cx == x0 ? first_mask
+					: cx == x1 ? last_mask : lmask | rmask;
+		}
+
+		row = last + 1;
+	}
+}
+
+/* a filled rectangle of an indexed canvas, one cell at a time */
+static void blot_span_indexed_rect(blot_canvas *can, unsigned c0, unsigned r0,
+				   unsigned c1, unsigned r1)
+{
+	if (!(can->flags & BLOT_RENDER_BRAILLE)) {
+		for (gsize row=r0; row<=r1; row++)
+			for (gsize col=c0; col<=c1; col++)
+				blot_canvas_index_or(can, (row * can->dim.cols) + col, 1);
+		return;
+	}
+
+	unsigned cell_cols = can->dim.cols / 2;
+	unsigned x0 = c0 / 2, x1 = c1 / 2;
+	guint8 left[5], right[5];
+
+	blot_braille_column_prefix(can, 0, left);
+	blot_braille_column_prefix(can, 1, right);
+
+	for (unsigned row=r0; row<=r1; ) {
+		unsigned last = min_t(unsigned, r1, row | 3);
+		guint8 lmask = blot_braille_rows(left, row % 4, last % 4);
+		guint8 rmask = blot_braille_rows(right, row % 4, last % 4);
+		gsize cells = (gsize)(row / 4) * cell_cols;
+
+		blot_canvas_index_or(can, cells + x0,
+				     (c0 % 2 ? 0 : lmask) | (x0 < x1 || c1 % 2 ? rmask : 0));
+		for (unsigned x=x0+1; x<x1; x++)
+			blot_canvas_index_or(can, cells + x, lmask | rmask);
+		if (x1 > x0)
+			blot_canvas_index_or(can, cells + x1, lmask | (c1 % 2 ? rmask : 0));
+
+		row = last + 1;
+	}
+}
+
+/* the bits of a block in its rows (or columns) a..b, 0..7 */
+static inline guint64 blot_block_range(const guint64 masks[8], unsigned a, unsigned b)
+{
+	guint64 bits = 0;
+	for (unsigned i=a; i<=b; i++)
+		bits |= masks[i];
+	return bits;
+}
+
+/* a filled rectangle of a blocked canvas, one word per block it covers */
+static void blot_span_blocks_rect(blot_canvas *can, unsigned c0, unsigned r0,
+				  unsigned c1, unsigned r1)
+{
+	const blot_canvas_blocks *blocks = can->blocks;
+	guint64 *words = blot_canvas_words(can);
+	unsigned bx0 = c0 / 8, bx1 = c1 / 8;
+
+	/* only the blocks at either end have some of their columns outside */
+	guint64 first_cols = blot_block_range(blocks->col_masks, c0 % 8, bx0 < bx1 ? 7 : c1 % 8);
+	guint64 last_cols = blot_block_range(blocks->col_masks, 0, c1 % 8);
+
+	for (unsigned row=r0; row<=r1; ) {
+		unsigned last = min_t(unsigned, r1, row | 7);
+		guint64 rows = blot_block_range(blocks->row_masks, row % 8, last % 8);
+		guint64 *p = words + blocks->row_words[row];
+
+		p[bx0] |= rows & first_cols;
+		for (unsigned bx=bx0+1; bx<bx1; bx++)
+			p[bx] |= rows;
+		if (bx1 > bx0)
+			p[bx1] |= rows & last_cols;
+
+		row = last + 1;
+	}
+}
+
+static void blot_span_rect(blot_canvas *can, unsigned c0, unsigned r0,
+			   unsigned c1, unsigned r1)
+{
+	if (can->blocks) {
+		blot_span_blocks_rect(can, c0, r0, c1, r1);
+		return;
+	}
+
+	if (can->tiles) {
+		blot_span_sparse_rect(can, c0, r0, c1, r1);
+		return;
+	}
+
+	if (can->layers) {
+		blot_span_indexed_rect(can, c0, r0, c1, r1);
+		return;
+	}
+
+	if (can->flags & BLOT_RENDER_BRAILLE) {
+		blot_span_braille_rect(can, c0, r0, c1, r1);
+		return;
+	}
+
+	gsize cols = can->dim.cols;
+
+	/* full width rows are one run of bits */
+	if (c0 == 0 && c1 == cols - 1) {
+		blot_bits_or(can->bitmap, r0 * cols, (r1 * cols) + c1);
+		return;
+	}
+
+	for (gsize row=r0; row<=r1; row++)
+		blot_bits_or(can->bitmap, (row * cols) + c0, (row * cols) + c1);
+}
+
+static void blot_span_horizontal(blot_canvas *can, unsigned row, unsigned c0, unsigned c1)
+{
+	blot_span_rect(can, c0, row, c1, row);
+}
+
+static void blot_span_vertical(blot_canvas *can, unsigned col, unsigned r0, unsigned r1)
+{
+	if (can->blocks) {
+		blot_span_blocks_rect(can, col, r0, col, r1);
+		return;
+	}
+
+	if (can->tiles) {
+		blot_span_sparse_rect(can, col, r0, col, r1);
+		return;
+	}
+
+	if (can->layers) {
+		blot_span_indexed_rect(can, col, r0, col, r1);
+		return;
+	}
+
+	if (can->flags & BLOT_RENDER_BRAILLE) {
+		blot_span_braille_rect(can, col, r0, col, r1);
+		return;
+	}
+
+	/* every row is a different byte */
+	gsize cols = can->dim.cols;
+	for (gsize row=r0; row<=r1; row++) {
+		gsize idx = (row * cols) + col;
+		can->bitmap[idx / BLOT_CANVAS_BITMAP_CELL_SIZE]
+			|= 1 << (idx % BLOT_CANVAS_BITMAP_CELL_SIZE);
+	}
+}
+
+void blot_canvas_fill_rect(blot_canvas *can, unsigned x0, unsigned y0,
+			   unsigned x1, unsigned y1)
+{
+	g_assert_nonnull(can);
+
+	if (x0 > x1)
+		swap_t(unsigned, x0, x1);
+
+	if (y0 > y1)
+		swap_t(unsigned, y0, y1);
+
+	if (x0 >= can->dim.cols || y0 >= can->dim.rows)
+		return;
+
+	x1 = min_t(unsigned, x1, can->dim.cols - 1);
+	y1 = min_t(unsigned, y1, can->dim.rows - 1);
+
+	blot_span_rect(can, x0, y0, x1, y1);
+}
+
+/* lines
+ *
+ * A line steps one pixel at a time along its major axis (the one with the
+ * larger delta), and at step k it is f(k) pixels along the minor axis:
+ *
+ *   f(k) = floor((2*k*d_minor + d_major) / (2*d_major))
+ *
+ * which is k*d_minor/d_major rounded to nearest.  f() never decreases, so
+ * the steps that land inside the canvas are one contiguous range, which is
+ * found with a few divisions up front.  Only that range is walked, and the
+ * pixels are the same as walking the whole line and dropping the ones that
+ * are off canvas.  Cohen–Sutherland outcodes catch the common cases early:
+ * lines that are entirely on, or entirely off one side of the canvas. */
+
+enum blot_clip_code {
+	BLOT_CLIP_LEFT   = 1,
+	BLOT_CLIP_RIGHT  = 2,
+	BLOT_CLIP_BOTTOM = 4,
+	BLOT_CLIP_TOP    = 8,
+};
+
+/* end points further out than this are first clipped to this box in floating
+ * point, which keeps the integer math well inside of 64 bits */
+#define BLOT_LINE_GUARD ((double)(1<<28))
+
+static inline unsigned blot_clip_outcode(double x, double y,
+					 double x_min, double y_min,
+					 double x_max, double y_max)
+{
+	unsigned code = 0;
+
+	if (x < x_min)
+		code |= BLOT_CLIP_LEFT;
+	else if (x > x_max)
+		code |= BLOT_CLIP_RIGHT;
+
+	if (y < y_min)
+		code |= BLOT_CLIP_BOTTOM;
+	else if (y > y_max)
+		code |= BLOT_CLIP_TOP;
+
+	return code;
+}
+
+static inline unsigned blot_clip_outcode_int(gint64 x, gint64 y, gint64 x_max, gint64 y_max)
+{
+	return (x < 0 ? BLOT_CLIP_LEFT : 0) | (x > x_max ? BLOT_CLIP_RIGHT : 0)
+		| (y < 0 ? BLOT_CLIP_BOTTOM : 0) | (y > y_max ? BLOT_CLIP_TOP : 0);
+}
+
+/* Cohen–Sutherland, returns false if no part of the line is inside the box */
+static bool blot_clip_line(double *x0, double *y0, double *x1, double *y1,
+			   double x_min, double y_min, double x_max, double y_max)
+{
+	unsigned c0 = blot_clip_outcode(*x0, *y0, x_min, y_min, x_max, y_max);
+	unsigned c1 = blot_clip_outcode(*x1, *y1, x_min, y_min, x_max, y_max);
+
+	/* each pass moves an end point onto one of the edges, and rounding
+	 * could in theory keep it bouncing between two of them */
+	for (int pass=0; pass<8; pass++) {
+		if (!(c0 | c1))
+			return true;
+		if (c0 & c1)
+			return false;
+
+		unsigned c = c0 ?: c1;
+		double x, y;
+
+		if (c & BLOT_CLIP_TOP) {
+			x = *x0 + (*x1 - *x0) * (y_max - *y0) / (*y1 - *y0);
+			y = y_max;
+		} else if (c & BLOT_CLIP_BOTTOM) {
+			x = *x0 + (*x1 - *x0) * (y_min - *y0) / (*y1 - *y0);
+			y = y_min;
+		} else if (c & BLOT_CLIP_RIGHT) {
+			y = *y0 + (*y1 - *y0) * (x_max - *x0) / (*x1 - *x0);
+			x = x_max;
+		} else {
+			y = *y0 + (*y1 - *y0) * (x_min - *x0) / (*x1 - *x0);
+			x = x_min;
+		}
+
+		if (c == c0) {
+			*x0 = x; *y0 = y;
+			c0 = blot_clip_outcode(x, y, x_min, y_min, x_max, y_max);
+		} else {
+			*x1 = x; *y1 = y;
+			c1 = blot_clip_outcode(x, y, x_min, y_min, x_max, y_max);
+		}
+	}
+
+	return false;
+}
+
+/* same as round(), for values inside of the guard box, but without a call
+ * into libm; adding the largest double below 0.5 never rounds up a value
+ * that is below one half */
+static inline gint64 blot_line_round(double v)
+{
+	return (gint64)(v + copysign(0.49999999999999994, v));
+}
+
+static inline gint64 blot_ceil_div(gint64 n, gint64 d)
+{
+	/* only used with n > 0 and d > 0 */
+	return (n + d - 1) / d;
+}
+
+/* narrow the steps [*k_lo, *k_hi] of a line to the ones where the major axis
+ * position a0 + sa*k is in [0, a_max] and the minor axis position b0 + sb*f(k)
+ * is in [0, b_max]; returns false if there are none */
+static bool blot_line_clip_steps(gint64 a0, int sa, gint64 da, gint64 a_max,
+				 gint64 b0, int sb, gint64 db, gint64 b_max,
+				 gint64 *k_lo, gint64 *k_hi)
+{
+	gint64 lo = 0, hi = da;
+
+	if (sa > 0) {
+		lo = max_t(gint64, lo, -a0);
+		hi = min_t(gint64, hi, a_max - a0);
+	} else {
+		lo = max_t(gint64, lo, a0 - a_max);
+		hi = min_t(gint64, hi, a0);
+	}
+
+	/* the minor axis is visible when fmin <= f(k) <= fmax */
+	gint64 fmin = sb > 0 ? -b0 : b0 - b_max;
+	gint64 fmax = sb > 0 ? b_max - b0 : b0;
+
+	/* f(k) covers 0..db */
+	if (fmax < 0 || fmin > db)
+		return false;
+
+	if (fmin > 0)
+		lo = max_t(gint64, lo, blot_ceil_div(2*da*fmin - da, 2*db));
+	if (fmax < db)
+		hi = min_t(gint64, hi, blot_ceil_div(2*da*(fmax+1) - da, 2*db) - 1);
+
+	*k_lo = lo;
+	*k_hi = hi;
+	return lo <= hi;
+}
+
+/* walks n pixels starting at (col,row), stepping sa along the major axis
+ * every time, and sb along the minor axis when the error term wraps; this
+ * is always inlined with constant braille/x_major, so each of the four
+ * combinations gets its own tight loop */
+static inline __attribute__((always_inline))
+void blot_line_walk(blot_canvas *can, bool braille, bool x_major,
+		    unsigned col, unsigned row, int sa, int sb,
+		    gint64 err, gint64 two_da, gint64 two_db, gint64 n)
+{
+	unsigned cols = can->dim.cols;
+	const guint8 *masks = can->braille.masks;
+
+	for (gint64 i=0; i<n; i++) {
+		/* every pixel walked is on the canvas, so they are written directly */
+		if (braille) {
+			can->bitmap[(row/4) * (cols/2) + (col/2)] |= masks[((row%4)*2) + (col%2)];
+		} else {
+			unsigned idx = (row * cols) + col;
+			can->bitmap[idx / BLOT_CANVAS_BITMAP_CELL_SIZE]
+				|= 1 << (idx % BLOT_CANVAS_BITMAP_CELL_SIZE);
+		}
+
+		if (x_major) col += sa; else row += sa;
+
+		err += two_db;
+		if (err >= two_da) {
+			err -= two_da;
+			if (x_major) row += sb; else col += sb;
+		}
+	}
+}
+
+/* same walk for a sparse canvas, the tile is looked up for every pixel */
+static void blot_line_walk_sparse(blot_canvas *can, bool x_major,
+				  unsigned col, unsigned row, int sa, int sb,
+				  gint64 err, gint64 two_da, gint64 two_db, gint64 n)
+{
+	for (gint64 i=0; i<n; i++) {
+		unsigned tx, ty;
+		guint8 mask;
+		gsize byte = blot_canvas_sparse_byte(can, col, row, &tx, &ty, &mask);
+		guint8 *tile = blot_canvas_tile(can, tx, ty);
+		if (unlikely (!tile))
+			return;
+		tile[byte] |= mask;
+
+		if (x_major) col += sa; else row += sa;
+
+		err += two_db;
+		if (err >= two_da) {
+			err -= two_da;
+			if (x_major) row += sb; else col += sb;
+		}
+	}
+}
+
+/* for a blocked canvas, where one word covers up to 8 steps of the line,
+ * whichever way it goes */
+static void blot_line_walk_blocks(blot_canvas *can, bool x_major,
+				  unsigned col, unsigned row, int sa, int sb,
+				  gint64 err, gint64 two_da, gint64 two_db, gint64 n)
+{
+	guint64 *words = blot_canvas_words(can);
+
+	for (gint64 i=0; i<n; i++) {
+		gsize word;
+		guint64 mask = blot_canvas_block_mask(can, col, row, &word);
+		words[word] |= mask;
+
+		if (x_major) col += sa; else row += sa;
+
+		err += two_db;
+		if (err >= two_da) {
+			err -= two_da;
+			if (x_major) row += sb; else col += sb;
+		}
+	}
+}
+
+/* and for an indexed canvas, where a cell may first have to be taken over */
+static void blot_line_walk_indexed(blot_canvas *can, bool x_major,
+				   unsigned col, unsigned row, int sa, int sb,
+				   gint64 err, gint64 two_da, gint64 two_db, gint64 n)
+{
+	for (gint64 i=0; i<n; i++) {
+		guint8 mask;
+		gsize cell = blot_canvas_index_cell(can, col, row, &mask);
+		blot_canvas_index_or(can, cell, mask);
+
+		if (x_major) col += sa; else row += sa;
+
+		err += two_db;
+		if (err >= two_da) {
+			err -= two_da;
+			if (x_major) row += sb; else col += sb;
+		}
+	}
+}
+
+void blot_canvas_draw_line(blot_canvas *can, double fx0, double fy0, double fx1, double fy1)
+{
+	g_assert_nonnull(can);
+
+	/* this is also false for NaN */
+	bool inside_guard = fabs(fx0) <= BLOT_LINE_GUARD && fabs(fy0) <= BLOT_LINE_GUARD
+		&& fabs(fx1) <= BLOT_LINE_GUARD && fabs(fy1) <= BLOT_LINE_GUARD;
+
+	if (unlikely (!inside_guard)) {
+		if (isnan(fx0) || isnan(fy0) || isnan(fx1) || isnan(fy1))
+			return;
+
+		bool visible = blot_clip_line(&fx0, &fy0, &fx1, &fy1,
+					      -BLOT_LINE_GUARD, -BLOT_LINE_GUARD,
+					      BLOT_LINE_GUARD, BLOT_LINE_GUARD);
+		if (!visible)
+			return;
+	}
+
+	gint64 x0 = blot_line_round(fx0), y0 = blot_line_round(fy0);
+	gint64 x1 = blot_line_round(fx1), y1 = blot_line_round(fy1);
+	gint64 w = (gint64)can->dim.cols - 1;
+	gint64 h = (gint64)can->dim.rows - 1;
+
+	unsigned c0 = blot_clip_outcode_int(x0, y0, w, h);
+	unsigned c1 = blot_clip_outcode_int(x1, y1, w, h);
+
+	/* entirely off one side of the canvas */
+	if (c0 & c1)
+		return;
+
+	gint64 dx = x1 - x0, dy = y1 - y0;
+	int sx = dx < 0 ? -1 : 1;
+	int sy = dy < 0 ? -1 : 1;
+	dx = abs_t(gint64, dx);
+	dy = abs_t(gint64, dy);
+
+	if (!dx) {
+		if (x0 < 0 || x0 > w)
+			return;
+		gint64 r0 = max_t(gint64, min_t(gint64, y0, y1), 0);
+		gint64 r1 = min_t(gint64, max_t(gint64, y0, y1), h);
+		blot_span_vertical(can, x0, r0, r1);
+		return;
+	}
+
+	if (!dy) {
+		if (y0 < 0 || y0 > h)
+			return;
+		gint64 c0 = max_t(gint64, min_t(gint64, x0, x1), 0);
+		gint64 c1 = min_t(gint64, max_t(gint64, x0, x1), w);
+		blot_span_horizontal(can, y0, c0, c1);
+		return;
+	}
+
+	/* the major axis is a, the minor axis is b */
+	bool x_major = dx >= dy;
+	gint64 a0 = x_major ? x0 : y0, da = x_major ? dx : dy;
+	gint64 b0 = x_major ? y0 : x0, db = x_major ? dy : dx;
+	int sa = x_major ? sx : sy, sb = x_major ? sy : sx;
+
+	gint64 k_lo = 0, k_hi = da;
+	if (c0 | c1) {
+		bool visible = x_major
+			? blot_line_clip_steps(a0, sa, da, w, b0, sb, db, h, &k_lo, &k_hi)
+			: blot_line_clip_steps(a0, sa, da, h, b0, sb, db, w, &k_lo, &k_hi);
+		if (!visible)
+			return;
+	}
+
+	/* position and error term at the first visible step */
+	gint64 two_da = 2*da, two_db = 2*db;
+	gint64 a = a0 + sa*k_lo;
+	gint64 b = b0;
+	gint64 err = da;
+	if (k_lo) {
+		/* only divide when the start was clipped, it is not cheap */
+		gint64 num = 2*k_lo*db + da;
+		b += sb*(num / two_da);
+		err = num % two_da;
+	}
+	gint64 n = k_hi - k_lo + 1;
+
+	unsigned col = x_major ? a : b;
+	unsigned row = x_major ? b : a;
+
+	if (can->tiles) {
+		blot_line_walk_sparse(can, x_major, col, row, sa, sb, err, two_da, two_db, n);
+	} else if (can->blocks) {
+		blot_line_walk_blocks(can, x_major, col, row, sa, sb, err, two_da, two_db, n);
+	} else if (can->layers) {
+		blot_line_walk_indexed(can, x_major, col, row, sa, sb, err, two_da, two_db, n);
+	} else if (can->flags & BLOT_RENDER_BRAILLE) {
+		if (x_major)
+			blot_line_walk(can, true, true, col, row, sa, sb, err, two_da, two_db, n);
+		else
+			blot_line_walk(can, true, false, col, row, sa, sb, err, two_da, two_db, n);
+	} else {
+		if (x_major)
+			blot_line_walk(can, false, true, col, row, sa, sb, err, two_da, two_db, n);
+		else
+			blot_line_walk(can, false, false, col, row, sa, sb, err, two_da, two_db, n);
+	}
+}
+
+/* merge
+ *
+ * Canvases of the same shape are combined by OR-ing their bitmaps, a whole
+ * vector at a time, with the remainder done a byte at a time. */
+
+typedef void (*blot_canvas_or_fn)(guint8 *dst, const guint8 *src, gsize n);
+
+static void blot_canvas_or_scalar(guint8 *dst, const guint8 *src, gsize n)
+{
+	gsize i = 0;
+	for (; i + 8 <= n; i += 8) {
+		guint64 d, s;
+		memcpy(&d, dst + i, 8);
+		memcpy(&s, src + i, 8);
+		d |= s;
+		memcpy(dst + i, &d, 8);
+	}
+	for (; i < n; i++)
+		dst[i] |= src[i];
+}
+
+#ifdef BLOT_CANVAS_X86
+
+#define BLOT_CANVAS_OR_VECTOR(ISA, TARGET, VT, LANES, LOAD, OR, STORE) \
+__attribute__((target(TARGET))) \
+static void blot_canvas_or_##ISA(guint8 *dst, const guint8 *src, gsize n) \
+{ \
+	gsize i = 0; \
+	for (; i + 2*LANES <= n; i += 2*LANES) { \
+		VT d0 = OR(LOAD(dst + i),         LOAD(src + i)); \
+		VT d1 = OR(LOAD(dst + i + LANES), LOAD(src + i + LANES)); \
+		STORE(dst + i, d0); \
+		STORE(dst + i + LANES, d1); \
+	} \
+	blot_canvas_or_scalar(dst + i, src + i, n - i); \
+}
+
+#define BLOT_SSE2_LOADU(p)     _mm_loadu_si128((const __m128i*)(p))
+#define BLOT_SSE2_STOREU(p,v)  _mm_storeu_si128((__m128i*)(p), v)
+#define BLOT_AVX2_LOADU(p)     _mm256_loadu_si256((const __m256i*)(p))
+#define BLOT_AVX2_STOREU(p,v)  _mm256_storeu_si256((__m256i*)(p), v)
+#define BLOT_AVX512_LOADU(p)   _mm512_loadu_si512(p)
+#define BLOT_AVX512_STOREU(p,v) _mm512_storeu_si512(p, v)
+
+BLOT_CANVAS_OR_VECTOR(sse2,   "sse2",             __m128i, 16, BLOT_SSE2_LOADU,   _mm_or_si128,    BLOT_SSE2_STOREU)
+BLOT_CANVAS_OR_VECTOR(avx2,   "avx2",             __m256i, 32, BLOT_AVX2_LOADU,   _mm256_or_si256, BLOT_AVX2_STOREU)
+BLOT_CANVAS_OR_VECTOR(avx512, "avx512f,avx512bw", __m512i, 64, BLOT_AVX512_LOADU, _mm512_or_si512, BLOT_AVX512_STOREU)
+
+#endif // BLOT_CANVAS_X86
+
+static const blot_canvas_or_fn blot_canvas_or_fns[BLOT_SIMD_LEVEL_MAX] = {
+	[BLOT_SIMD_NONE]   = blot_canvas_or_scalar,
+#ifdef BLOT_CANVAS_X86
+	[BLOT_SIMD_SSE2]   = blot_canvas_or_sse2,
+	[BLOT_SIMD_AVX2]   = blot_canvas_or_avx2,
+	[BLOT_SIMD_AVX512] = blot_canvas_or_avx512,
+#endif
+};
+
+bool blot_canvas_merge_simd(blot_simd_level level, blot_canvas *dst,
+			    const blot_canvas *src, GError **error)
+{
+	RETURN_EFAULT_IF(dst==NULL, false, error);
+	RETURN_EFAULT_IF(src==NULL, false, error);
+	RETURN_EINVAL_IF(level>=BLOT_SIMD_LEVEL_MAX, false, error);
+	RETURN_ERRORx(dst->dim.cols != src->dim.cols || dst->dim.rows != src->dim.rows,
+		      false, error, EINVAL, "canvas dimensions differ %ux%u vs %ux%u",
+		      dst->dim.cols, dst->dim.rows, src->dim.cols, src->dim.rows);
+	RETURN_ERRORx((dst->flags ^ src->flags) & (BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE | BLOT_RENDER_BLOCKS),
+		      false, error, EINVAL, "canvas layouts differ");
+	RETURN_ERRORx(src->layers, false, error, EINVAL, "cannot merge from an indexed canvas");
+
+	if (dst->layers) {
+		/* every cell that src drew in is drawn in by the current layer */
+		bool braille = dst->flags & BLOT_RENDER_BRAILLE;
+
+		for (gsize i=0; i<src->bitmap_bytes; i++) {
+			guint8 byte = src->bitmap[i];
+			if (!byte)
+				continue;
+
+			if (braille) {
+				blot_canvas_index_or(dst, i, byte);
+				continue;
+			}
+
+			for (; byte; byte &= byte-1)
+				blot_canvas_index_or(dst, (i * 8) + __builtin_ctz(byte), 1);
+		}
+		return true;
+	}
+
+	/* never use instructions the CPU does not have */
+	level = min_t(unsigned, level, blot_cpu_simd_level());
+
+	/* fall back to the best thing we have */
+	while (level && !blot_canvas_or_fns[level])
+		level --;
+
+	if (!src->tiles) {
+		blot_canvas_or_fns[level](dst->bitmap, src->bitmap, dst->bitmap_bytes);
+		return true;
+	}
+
+	const blot_canvas_tiles *tiles = src->tiles;
+	RETURN_ERROR(tiles->failed, false, error, "new blot_canvas tile");
+
+	for (unsigned i=0; i<tiles->count; i++) {
+		unsigned ti = tiles->used[i];
+		guint8 *tile = blot_canvas_tile(dst, ti % tiles->cols, ti / tiles->cols);
+		RETURN_ERROR(!tile, false, error, "new blot_canvas tile");
+
+		blot_canvas_or_fns[level](tile, tiles->index[ti], BLOT_CANVAS_TILE_BYTES);
+	}
+	return true;
+}
+
+bool blot_canvas_merge(blot_canvas *dst, const blot_canvas *src, GError **error)
+{
+	return blot_canvas_merge_simd(blot_cpu_simd_level(), dst, src, error);
+}
+
+/* scroll */
+
+static void blot_canvas_shift_cells(guint8 *cells, unsigned cols, unsigned rows, unsigned shift)
+{
+	for (unsigned row=0; row<rows; row++) {
+		guint8 *p = cells + ((gsize)row * cols);
+		memmove(p, p + shift, cols - shift);
+		memset(p + cols - shift, 0, shift);
+	}
+}
+
+void blot_canvas_shift_left(blot_canvas *can, unsigned cells)
+{
+	g_assert_nonnull(can);
+
+	if (!cells)
+		return;
+
+	bool braille = can->flags & BLOT_RENDER_BRAILLE;
+	unsigned cell_cols = braille ? can->dim.cols / BRAILLE_GLYPH_COLS : can->dim.cols;
+	unsigned cell_rows = braille ? can->dim.rows / BRAILLE_GLYPH_ROWS : can->dim.rows;
+
+	if (cells >= cell_cols) {
+		blot_canvas_clear(can);
+		return;
+	}
+
+	if (can->layers) {
+		blot_canvas_shift_cells(can->bitmap, cell_cols, cell_rows, cells);
+		blot_canvas_shift_cells(can->layers, cell_cols, cell_rows, cells);
+		return;
+	}
+
+	if (braille && !can->tiles && !can->blocks) {
+		blot_canvas_shift_cells(can->bitmap, cell_cols, cell_rows, cells);
+		return;
+	}
+
+	unsigned shift = braille ? cells * BRAILLE_GLYPH_COLS : cells;
+	unsigned keep = can->dim.cols - shift;
+
+	for (unsigned row=0; row<can->dim.rows; row++) {
+		for (unsigned col=0; col<keep; col++)
+			blot_canvas_set(can, col, row, blot_canvas_get(can, col + shift, row));
+		for (unsigned col=keep; col<can->dim.cols; col++)
+			blot_canvas_set(can, col, row, false);
+	}
+}
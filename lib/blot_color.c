@@ -3,3 +3,17 @@
 #include "blot_color.h"
 
 bool have_color_support = true;
+
+#define COL_FG_SEQ(n) { sizeof(COL_FG_PREFIX #n COL_SUFFIX)-1, COL_FG_PREFIX #n COL_SUFFIX }
+#define COL_FG_SEQ_10(t) \
+	COL_FG_SEQ(t##0), COL_FG_SEQ(t##1), COL_FG_SEQ(t##2), COL_FG_SEQ(t##3), COL_FG_SEQ(t##4), \
+	COL_FG_SEQ(t##5), COL_FG_SEQ(t##6), COL_FG_SEQ(t##7), COL_FG_SEQ(t##8), COL_FG_SEQ(t##9)
+
+const blot_color_seq blot_color_fg_seqs[256] = {
+	COL_FG_SEQ_10(),   COL_FG_SEQ_10(1),  COL_FG_SEQ_10(2),  COL_FG_SEQ_10(3),  COL_FG_SEQ_10(4),
+	COL_FG_SEQ_10(5),  COL_FG_SEQ_10(6),  COL_FG_SEQ_10(7),  COL_FG_SEQ_10(8),  COL_FG_SEQ_10(9),
+	COL_FG_SEQ_10(10), COL_FG_SEQ_10(11), COL_FG_SEQ_10(12), COL_FG_SEQ_10(13), COL_FG_SEQ_10(14),
+	COL_FG_SEQ_10(15), COL_FG_SEQ_10(16), COL_FG_SEQ_10(17), COL_FG_SEQ_10(18), COL_FG_SEQ_10(19),
+	COL_FG_SEQ_10(20), COL_FG_SEQ_10(21), COL_FG_SEQ_10(22), COL_FG_SEQ_10(23), COL_FG_SEQ_10(24),
+	COL_FG_SEQ(250), COL_FG_SEQ(251), COL_FG_SEQ(252), COL_FG_SEQ(253), COL_FG_SEQ(254), COL_FG_SEQ(255),
+};
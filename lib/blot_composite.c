@@ -0,0 +1,411 @@
+/* blot: compositing of layer canvases, one screen row at a time */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <string.h>
+#include "blot_composite.h"
+#include "blot_alloc.h"
+#include "blot_canvas.h"
+#include "blot_braille.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOT_COMPOSITE_X86 1
+#endif
+
+/* create/delete */
+
+bool blot_composite_row_init(blot_composite_row *row, unsigned cols, GError **error)
+{
+	RETURN_EFAULT_IF(row==NULL, false, error);
+	RETURN_ERRORx(!cols, false, error, EINVAL, "cannot composite a zero sized row");
+
+	memset(row, 0, sizeof(*row));
+
+	row->cols   = cols;
+	row->glyphs = blot_new0(guint8, cols);
+	row->layers = blot_new0(guint8, cols);
+	row->blocks = blot_new0(guint64, BLOT_COMPOSITE_BLOCK_WORDS(cols));
+	row->empty  = true;
+
+	bool ok = row->glyphs && row->layers && row->blocks;
+	if (!ok)
+		blot_composite_row_cleanup(row);
+	RETURN_ERROR(!ok, false, error, "new blot_composite_row [%u]", cols);
+
+	return true;
+}
+
+void blot_composite_row_cleanup(blot_composite_row *row)
+{
+	blot_free(row->glyphs);
+	blot_free(row->layers);
+	blot_free(row->blocks);
+	memset(row, 0, sizeof(*row));
+}
+
+/* braille
+ *
+ * Every byte of a braille canvas is a cell, so a row of cells is a row of
+ * bytes, and every non-zero byte replaces what is under it.  The vector
+ * kernels skip over runs of empty cells without writing anything. */
+
+typedef void (*blot_composite_fn)(guint8 *glyphs, guint8 *layers,
+				  const guint8 *src, gsize n, guint8 layer);
+
+static void blot_composite_scalar(guint8 *glyphs, guint8 *layers,
+				  const guint8 *src, gsize n, guint8 layer)
+{
+	for (gsize i=0; i<n; i++) {
+		if (!src[i])
+			continue;
+		glyphs[i] = src[i];
+		layers[i] = layer;
+	}
+}
+
+#ifdef BLOT_COMPOSITE_X86
+
+__attribute__((target("sse2")))
+static void blot_composite_sse2(guint8 *glyphs, guint8 *layers,
+				const guint8 *src, gsize n, guint8 layer)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lay = _mm_set1_epi8(layer);
+	gsize i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i z = _mm_cmpeq_epi8(v, zero);
+		if (_mm_movemask_epi8(z) == 0xFFFF)
+			continue;
+
+		/* keep what was there where the source is empty */
+		__m128i g = _mm_loadu_si128((const __m128i*)(glyphs + i));
+		__m128i l = _mm_loadu_si128((const __m128i*)(layers + i));
+		g = _mm_or_si128(_mm_and_si128(z, g), _mm_andnot_si128(z, v));
+		l = _mm_or_si128(_mm_and_si128(z, l), _mm_andnot_si128(z, lay));
+		_mm_storeu_si128((__m128i*)(glyphs + i), g);
+		_mm_storeu_si128((__m128i*)(layers + i), l);
+	}
+
+	blot_composite_scalar(glyphs + i, layers + i, src + i, n - i, layer);
+}
+
+__attribute__((target("avx2")))
+static void blot_composite_avx2(guint8 *glyphs, guint8 *layers,
+				const guint8 *src, gsize n, guint8 layer)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lay = _mm256_set1_epi8(layer);
+	gsize i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i z = _mm256_cmpeq_epi8(v, zero);
+		if (_mm256_movemask_epi8(z) == -1)
+			continue;
+
+		__m256i g = _mm256_loadu_si256((const __m256i*)(glyphs + i));
+		__m256i l = _mm256_loadu_si256((const __m256i*)(layers + i));
+		_mm256_storeu_si256((__m256i*)(glyphs + i), _mm256_blendv_epi8(v, g, z));
+		_mm256_storeu_si256((__m256i*)(layers + i), _mm256_blendv_epi8(lay, l, z));
+	}
+
+	blot_composite_scalar(glyphs + i, layers + i, src + i, n - i, layer);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void blot_composite_avx512(guint8 *glyphs, guint8 *layers,
+				  const guint8 *src, gsize n, guint8 layer)
+{
+	const __m512i lay = _mm512_set1_epi8(layer);
+	gsize i = 0;
+
+	for (; i + 64 <= n; i += 64) {
+		__m512i v = _mm512_loadu_si512(src + i);
+		__mmask64 k = _mm512_test_epi8_mask(v, v);
+		if (!k)
+			continue;
+
+		_mm512_mask_storeu_epi8(glyphs + i, k, v);
+		_mm512_mask_storeu_epi8(layers + i, k, lay);
+	}
+
+	blot_composite_scalar(glyphs + i, layers + i, src + i, n - i, layer);
+}
+
+#endif // BLOT_COMPOSITE_X86
+
+static const blot_composite_fn blot_composite_fns[BLOT_SIMD_LEVEL_MAX] = {
+	[BLOT_SIMD_NONE]   = blot_composite_scalar,
+#ifdef BLOT_COMPOSITE_X86
+	[BLOT_SIMD_SSE2]   = blot_composite_sse2,
+	[BLOT_SIMD_AVX2]   = blot_composite_avx2,
+	[BLOT_SIMD_AVX512] = blot_composite_avx512,
+#endif
+};
+
+/* 1-bit
+ *
+ * Rows of a plain canvas are runs of bits that need not start on a byte, so
+ * they are read 64 bits at a time, and only the set bits are visited. */
+
+static inline guint64 blot_composite_load_bits(const guint8 *bitmap, gsize bytes, gsize bit)
+{
+	gsize byte = bit / 8;
+	unsigned shift = bit % 8;
+	guint64 lo = 0, hi = 0;
+
+	for (unsigned b=0; b<8 && byte+b<bytes; b++)
+		lo |= (guint64)bitmap[byte+b] << (8*b);
+	if (shift && byte+8 < bytes)
+		hi = bitmap[byte+8];
+
+	return shift ? (lo >> shift) | (hi << (64-shift)) : lo;
+}
+
+static void blot_composite_bits(guint8 *glyphs, guint8 *layers,
+				const blot_canvas *can, gsize bit, unsigned n, guint8 layer)
+{
+	for (unsigned i=0; i<n; i+=64) {
+		guint64 w = blot_composite_load_bits(can->bitmap, can->bitmap_bytes, bit + i);
+		if (n - i < 64)
+			w &= (1ull << (n - i)) - 1;
+
+		for (; w; w &= w-1) {
+			unsigned c = i + __builtin_ctzll(w);
+			glyphs[c] = 1;
+			layers[c] = layer;
+		}
+	}
+}
+
+/* sparse
+ *
+ * A row of a sparse canvas is spread over a row of tiles; tiles that were
+ * never drawn in are skipped, and the rest are merged as above, a piece of
+ * a row at a time. */
+
+static void blot_composite_sparse(blot_composite_fn fn, guint8 *glyphs, guint8 *layers,
+				  const blot_canvas *can, unsigned c_y, unsigned n, guint8 layer)
+{
+	const blot_canvas_tiles *tiles = can->tiles;
+	unsigned tc = tiles->tile_cols, tr = tiles->tile_rows;
+	bool braille = can->flags & BLOT_RENDER_BRAILLE;
+
+	for (unsigned tx=0; tx*tc<n; tx++) {
+		const guint8 *tile = blot_canvas_tile_peek(can, tx, c_y / tr);
+		if (!tile)
+			continue;
+
+		unsigned c = tx*tc;
+		unsigned w = min_t(unsigned, tc, n - c);
+		const guint8 *src = tile + (c_y % tr) * (braille ? tc : tc/8);
+
+		if (braille) {
+			fn(glyphs + c, layers + c, src, w, layer);
+			continue;
+		}
+
+		guint64 bits = 0;
+		for (unsigned b=0; b<8; b++)
+			bits |= (guint64)src[b] << (8*b);
+		if (w < 64)
+			bits &= (1ull << w) - 1;
+
+		for (; bits; bits &= bits-1) {
+			unsigned i = c + __builtin_ctzll(bits);
+			glyphs[i] = 1;
+			layers[i] = layer;
+		}
+	}
+}
+
+/* blocked
+ *
+ * A row of cells of a blocked canvas is one half of each word in a row of
+ * blocks in the braille layout, and one byte of each word in the 1-bit
+ * layout.  Braille cells are gathered a piece of a row at a time, so that
+ * the kernels above can merge them. */
+
+#define BLOT_COMPOSITE_GATHER 256
+
+static void blot_composite_blocked(blot_composite_fn fn, guint8 *glyphs, guint8 *layers,
+				   const blot_canvas *can, unsigned c_y, unsigned n, guint8 layer)
+{
+	const blot_canvas_blocks *blocks = can->blocks;
+	const guint64 *words = (const guint64*)can->bitmap;
+
+	if (!(can->flags & BLOT_RENDER_BRAILLE)) {
+		unsigned shift = 8 * (c_y % BLOT_CANVAS_BLOCK_PIXELS);
+		words += blocks->row_words[c_y];
+
+		for (unsigned i=0; i<n; i+=64) {
+			guint64 bits = 0;
+			for (unsigned b=0; b<8 && i+(8*b)<n; b++)
+				bits |= ((words[(i/8) + b] >> shift) & 0xFF) << (8*b);
+			if (n - i < 64)
+				bits &= (1ull << (n - i)) - 1;
+
+			for (; bits; bits &= bits-1) {
+				unsigned c = i + __builtin_ctzll(bits);
+				glyphs[c] = 1;
+				layers[c] = layer;
+			}
+		}
+		return;
+	}
+
+	unsigned shift = 32 * (c_y % 2);
+	guint8 src[BLOT_COMPOSITE_GATHER];
+	words += blocks->row_words[c_y * BRAILLE_GLYPH_ROWS];
+
+	for (unsigned c=0; c<n; c+=BLOT_COMPOSITE_GATHER) {
+		unsigned m = min_t(unsigned, BLOT_COMPOSITE_GATHER, n - c);
+		const guint64 *w = words + (c / 4);
+		guint64 any = 0;
+
+		/* two blocks make 8 cells, in the order they are on the screen */
+		for (unsigned i=0; i<m; i+=8) {
+			guint64 lo = (guint32)(w[i/4] >> shift);
+			guint64 hi = i+4 < m ? (guint32)(w[(i/4) + 1] >> shift) : 0;
+			guint64 cells = lo | (hi << 32);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			cells = __builtin_bswap64(cells);
+#endif
+			any |= cells;
+			memcpy(src + i, &cells, sizeof(cells));
+		}
+
+		if (any)
+			fn(glyphs + c, layers + c, src, m, layer);
+	}
+}
+
+/* occupancy */
+
+static void blot_composite_blocks(blot_composite_row *row)
+{
+	bool empty = true;
+
+	memset(row->blocks, 0, BLOT_COMPOSITE_BLOCK_WORDS(row->cols) * sizeof(guint64));
+
+	for (unsigned c=0; c<row->cols; c+=64) {
+		unsigned n = min_t(unsigned, 64, row->cols - c);
+		guint64 any = 0;
+		unsigned i = 0;
+
+		for (; i + 8 <= n; i += 8) {
+			guint64 w;
+			memcpy(&w, row->layers + c + i, 8);
+			any |= w;
+		}
+		for (; i < n; i++)
+			any |= row->layers[c + i];
+
+		if (!any)
+			continue;
+
+		unsigned block = c / 64;
+		row->blocks[block / 64] |= 1ull << (block % 64);
+		empty = false;
+	}
+
+	row->empty = empty;
+}
+
+/* composite */
+
+bool blot_composite_row_merge_simd(blot_simd_level level, blot_composite_row *row,
+				   unsigned count, blot_canvas *const*cans,
+				   unsigned c_y, GError **error)
+{
+	RETURN_EFAULT_IF(row==NULL, false, error);
+	RETURN_EFAULT_IF(count && cans==NULL, false, error);
+	RETURN_EINVAL_IF(level>=BLOT_SIMD_LEVEL_MAX, false, error);
+	RETURN_ERRORx(count > BLOT_COMPOSITE_MAX_LAYERS, false, error, EINVAL,
+		      "cannot composite %u layers, limit is %u",
+		      count, BLOT_COMPOSITE_MAX_LAYERS);
+
+	/* never use instructions the CPU does not have */
+	level = min_t(unsigned, level, blot_cpu_simd_level());
+
+	/* fall back to the best thing we have */
+	while (level && !blot_composite_fns[level])
+		level --;
+
+	memset(row->glyphs, 0, row->cols);
+	memset(row->layers, 0, row->cols);
+
+	for (unsigned ci=0; ci<count; ci++) {
+		const blot_canvas *can = cans[ci];
+		RETURN_EFAULT_IF(can==NULL, false, error);
+
+		if (can->layers) {
+			RETURN_ERRORx(count != 1, false, error, EINVAL,
+				      "an indexed canvas cannot be composited with others");
+
+			bool braille = can->flags & BLOT_RENDER_BRAILLE;
+			unsigned cols = can->dim.cols / (braille ? BRAILLE_GLYPH_COLS : 1);
+			unsigned rows = can->dim.rows / (braille ? BRAILLE_GLYPH_ROWS : 1);
+			if (c_y >= rows)
+				continue;
+
+			/* the cells were resolved as they were drawn */
+			unsigned n = min_t(unsigned, row->cols, cols);
+			gsize cell = (gsize)c_y * cols;
+			memcpy(row->glyphs, can->bitmap + cell, n);
+			memcpy(row->layers, can->layers + cell, n);
+
+		} else if (can->blocks) {
+			bool braille = can->flags & BLOT_RENDER_BRAILLE;
+			unsigned cols = can->dim.cols / (braille ? BRAILLE_GLYPH_COLS : 1);
+			unsigned rows = can->dim.rows / (braille ? BRAILLE_GLYPH_ROWS : 1);
+			if (c_y >= rows)
+				continue;
+
+			unsigned n = min_t(unsigned, row->cols, cols);
+			blot_composite_blocked(blot_composite_fns[level], row->glyphs, row->layers,
+					       can, c_y, n, ci+1);
+
+		} else if (can->tiles) {
+			bool braille = can->flags & BLOT_RENDER_BRAILLE;
+			unsigned cols = can->dim.cols / (braille ? BRAILLE_GLYPH_COLS : 1);
+			unsigned rows = can->dim.rows / (braille ? BRAILLE_GLYPH_ROWS : 1);
+			if (c_y >= rows)
+				continue;
+
+			unsigned n = min_t(unsigned, row->cols, cols);
+			blot_composite_sparse(blot_composite_fns[level], row->glyphs, row->layers,
+					      can, c_y, n, ci+1);
+
+		} else if (can->flags & BLOT_RENDER_BRAILLE) {
+			unsigned cell_cols = can->dim.cols / BRAILLE_GLYPH_COLS;
+			unsigned cell_rows = can->dim.rows / BRAILLE_GLYPH_ROWS;
+			if (c_y >= cell_rows)
+				continue;
+
+			unsigned n = min_t(unsigned, row->cols, cell_cols);
+			const guint8 *src = can->bitmap + (gsize)c_y * cell_cols;
+			blot_composite_fns[level](row->glyphs, row->layers, src, n, ci+1);
+
+		} else {
+			if (c_y >= can->dim.rows)
+				continue;
+
+			unsigned n = min_t(unsigned, row->cols, can->dim.cols);
+			gsize bit = (gsize)c_y * can->dim.cols;
+			blot_composite_bits(row->glyphs, row->layers, can, bit, n, ci+1);
+		}
+	}
+
+	blot_composite_blocks(row);
+	return true;
+}
+
+bool blot_composite_row_merge(blot_composite_row *row, unsigned count,
+			      blot_canvas *const*cans, unsigned c_y, GError **error)
+{
+	return blot_composite_row_merge_simd(blot_cpu_simd_level(), row, count, cans, c_y, error);
+}
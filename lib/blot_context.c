@@ -0,0 +1,73 @@
+/* blot: settings that used to be process-wide, for rendering on any thread */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <string.h>
+
+#include "blot_context.h"
+#include "blot_alloc.h"
+#include "blot_error.h"
+#include "blot_terminal.h"
+
+/* create/delete */
+
+bool blot_context_init(blot_context *bctx, GError **error)
+{
+	RETURN_EFAULT_IF(bctx==NULL, false, error);
+
+	memset(bctx, 0, sizeof(*bctx));
+	bctx->color = true;
+
+	return true;
+}
+
+blot_context * blot_context_new(GError **error)
+{
+	blot_context *bctx;
+
+	bctx = blot_new(blot_context, 1);
+	RETURN_ERROR(!bctx, NULL, error, "new blot_context");
+
+	bool ok = blot_context_init(bctx, error);
+	RETURN_IF(!ok, NULL);
+
+	return bctx;
+}
+
+void blot_context_delete(blot_context *bctx)
+{
+	blot_free(bctx);
+}
+
+/* configure */
+
+bool blot_context_set_color(blot_context *bctx, bool color, GError **error)
+{
+	RETURN_EFAULT_IF(bctx==NULL, false, error);
+
+	bctx->color = color;
+	return true;
+}
+
+bool blot_context_set_term_size(blot_context *bctx, blot_dimensions dims, GError **error)
+{
+	RETURN_EFAULT_IF(bctx==NULL, false, error);
+
+	bool ok = blot_terminal_check_size(dims, error);
+	RETURN_IF(!ok, false);
+
+	bctx->term = dims;
+	return true;
+}
+
+bool blot_context_get_term_size(const blot_context *bctx, blot_dimensions *dims,
+				GError **error)
+{
+	RETURN_EFAULT_IF(bctx==NULL, false, error);
+	RETURN_EFAULT_IF(dims==NULL, false, error);
+
+	if (bctx->term.cols && bctx->term.rows) {
+		*dims = bctx->term;
+		return true;
+	}
+
+	return blot_terminal_query_size(dims, error);
+}
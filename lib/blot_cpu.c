@@ -0,0 +1,34 @@
+/* blot: CPU feature detection */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include "blot_cpu.h"
+#include "blot_utils.h"
+
+static blot_simd_level blot_cpu_detect(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return BLOT_SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return BLOT_SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return BLOT_SIMD_SSE2;
+#endif
+	return BLOT_SIMD_NONE;
+}
+
+blot_simd_level blot_cpu_simd_level(void)
+{
+	/* detection is idempotent, so racing threads just store the same value */
+	static int cached = -1;
+	int level = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+
+	if (unlikely (level < 0)) {
+		level = blot_cpu_detect();
+		level = min_t(unsigned, level, blot_env_to_uint("BLOT_SIMD", level));
+		__atomic_store_n(&cached, level, __ATOMIC_RELAXED);
+	}
+
+	return level;
+}
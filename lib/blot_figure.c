@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include "blot_figure.h"
+#include "blot_alloc.h"
 #include "blot_error.h"
 #include "blot_color.h"
 #include "blot_layer.h"
@@ -10,6 +11,10 @@
 #include "blot_screen.h"
 #include "blot_terminal.h"
 #include "blot_axis.h"
+#include "blot_parallel.h"
+#include "blot_arena.h"
+#include "blot_context.h"
+#include "blot_composite.h"
 
 /* create/delete */
 
@@ -31,15 +36,18 @@ void blot_figure_cleanup(blot_figure *fig)
 			blot_layer_delete(lay);
 		}
 
-		g_free(fig->layers);
+		blot_free(fig->layers);
 	}
+
+	blot_axis_delete(fig->x_axs);
+	blot_axis_delete(fig->y_axs);
 }
 
 blot_figure * blot_figure_new(GError **error)
 {
 	blot_figure *fig;
 
-	fig = g_new(blot_figure, 1);
+	fig = blot_new(blot_figure, 1);
 	RETURN_ERROR(!fig, NULL, error, "new blot_figure");
 
 	bool ok = blot_figure_init(fig, error);
@@ -51,12 +59,76 @@ blot_figure * blot_figure_new(GError **error)
 void blot_figure_delete(blot_figure *fig)
 {
 	blot_figure_cleanup(fig);
-	g_free(fig);
+	blot_free(fig);
+}
+
+bool blot_render_ctx_init(blot_render_ctx *ctx, GError **error)
+{
+	RETURN_EFAULT_IF(ctx==NULL, false, error);
+
+	memset(ctx, 0, sizeof(*ctx));
+
+	return true;
+}
+
+blot_render_ctx * blot_render_ctx_new(GError **error)
+{
+	blot_render_ctx *ctx;
+
+	ctx = blot_new(blot_render_ctx, 1);
+	RETURN_ERROR(!ctx, NULL, error, "new blot_render_ctx");
+
+	bool ok = blot_render_ctx_init(ctx, error);
+	RETURN_IF(!ok, NULL);
+
+	return ctx;
+}
+
+/* canvases come from the arena when there is one, other than sparse ones,
+ * which allocate their tiles as they go */
+static inline bool blot_render_ctx_owns(const blot_render_ctx *ctx, const blot_canvas *can)
+{
+	return !ctx->arena || (can && can->tiles);
+}
+
+void blot_render_ctx_cleanup(blot_render_ctx *ctx)
+{
+	for (gsize ci=0; ci<ctx->can_count; ci++) {
+		if (blot_render_ctx_owns(ctx, ctx->cans[ci]))
+			blot_canvas_delete(ctx->cans[ci]);
+		g_clear_error(&ctx->errors[ci]);
+	}
+
+	if (!ctx->arena) {
+		blot_free(ctx->cans);
+		blot_free(ctx->errors);
+		blot_free(ctx->memos);
+	}
+	blot_screen_delete(ctx->scr);
+
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void blot_render_ctx_delete(blot_render_ctx *ctx)
+{
+	if (!ctx)
+		return;
+
+	blot_render_ctx_cleanup(ctx);
+	blot_free(ctx);
 }
 
 
 /* configure */
 
+bool blot_figure_set_context(blot_figure *fig, const blot_context *bctx, GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, false, error);
+
+	fig->context = bctx;
+	return true;
+}
+
 bool blot_figure_set_axis_color(blot_figure *fig, blot_color color, GError **error)
 {
 	RETURN_EFAULT_IF(fig==NULL, false, error);
@@ -107,6 +179,14 @@ bool blot_figure_set_y_limits(blot_figure *fig,
 	return true;
 }
 
+bool blot_figure_set_y_autoscale_in_x(blot_figure *fig, bool enable, GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, false, error);
+
+	fig->y_autoscale_in_x = enable;
+	return true;
+}
+
 bool blot_figure_set_x_axis_labels(blot_figure *fig, size_t label_count,
 				   char **x_labels, GError **error)
 {
@@ -116,11 +196,45 @@ bool blot_figure_set_x_axis_labels(blot_figure *fig, size_t label_count,
 
 	fig->xlabels.count = label_count;
 	fig->xlabels.strings = x_labels;
+
+	/* the strings could have changed, even if the array did not */
+	blot_axis_delete(fig->x_axs);
+	fig->x_axs = NULL;
 	return true;
 }
 
 
-/* add layers */
+/* layers */
+
+blot_layer * blot_figure_get_layer(blot_figure *fig, gsize index, GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, NULL, error);
+	RETURN_ERRORx(index >= fig->layer_count, NULL, error, ERANGE,
+		      "layer %zu is out of range %zu", index, fig->layer_count);
+
+	return fig->layers[index];
+}
+
+static bool blot_figure_add_layer(blot_figure *fig, blot_layer *lay, GError **error)
+{
+	/* grow geometrically, so that adding many layers is not quadratic */
+	if (fig->layer_count == fig->layer_size) {
+		gsize size = max_t(gsize, 4, fig->layer_size * 2);
+		blot_layer **layers = blot_renew(blot_layer*, fig->layers, size);
+		if (!layers)
+			blot_layer_delete(lay);
+		RETURN_ERROR(!layers, false, error,
+			     "realloc *blot_layers x %zu", size);
+
+		fig->layers = layers;
+		fig->layer_size = size;
+	}
+
+	fig->layers[fig->layer_count] = lay;
+	fig->layer_count ++;
+
+	return true;
+}
 
 bool blot_figure_plot(blot_figure *fig,
 		      blot_plot_type plot_type, blot_data_type data_type,
@@ -140,17 +254,25 @@ bool blot_figure_plot(blot_figure *fig,
 					 error);
 	RETURN_IF(lay==NULL,false);
 
-	blot_layer **layers = g_realloc_n(fig->layers,
-					 fig->layer_count + 1,
-					 sizeof(blot_layer*));
-	RETURN_ERROR(!layers, NULL, error,
-		     "realloc *blot_layers x %u", fig->layer_count + 1);
+	return blot_figure_add_layer(fig, lay, error);
+}
 
-	fig->layers = layers;
-	fig->layers[fig->layer_count] = lay;
-	fig->layer_count ++;
+bool blot_figure_plot_ring(blot_figure *fig,
+			   blot_plot_type plot_type, blot_data_type data_type,
+			   size_t capacity, blot_color data_color, const char *data_label,
+			   GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, false, error);
 
-	return true;
+	blot_layer *lay = blot_layer_new_ring(plot_type,
+					      data_type,
+					      capacity,
+					      data_color,
+					      data_label,
+					      error);
+	RETURN_IF(lay==NULL,false);
+
+	return blot_figure_add_layer(fig, lay, error);
 }
 
 
@@ -165,7 +287,9 @@ static blot_dimensions blot_figure_finalize_dimensions(const blot_figure *fig,
 	/* if we cannot get terminal dimensions, use the minimum values */
 	blot_dimensions dim = {BLOT_MIN_COLS, BLOT_MIN_ROWS};
 
-	bool ok = blot_terminal_get_size(&dim, error);
+	bool ok = fig->context
+		? blot_context_get_term_size(fig->context, &dim, error)
+		: blot_terminal_get_size(&dim, error);
 	if (!ok) {
 		// caller should call blot_terminal_set_size() if the terminal size cannot be determine
 		return (blot_dimensions){};
@@ -181,56 +305,91 @@ static blot_dimensions blot_figure_finalize_dimensions(const blot_figure *fig,
 	return dim;
 }
 
+/* if there is a range, widen it by 0.1% on either side,
+ * if there is only one value, make the range 10% on either side */
+static void blot_figure_widen_limits(double *min, double *max)
+{
+	double range = *max - *min;
+	double fudge = range ? range * 0.001 : (*min == 0 ? 0.1 : fabs(*min * 0.1));
+	*min -= fudge;
+	*max += fudge;
+}
+
+/* limits that were not set are computed from the layers, which cache them,
+ * so data that did not change is not looked at again */
 static blot_xy_limits blot_figure_finalize_limits(const blot_figure *fig,
 						  GError **error)
 {
 	if (fig->x_limits_set && fig->y_limits_set)
 		return fig->lim;
 
-	blot_xy_limits lim = {0,0,0,0};
-	bool something_set = false;
+	blot_xy_limits lim = fig->lim;
+	bool find_x = !fig->x_limits_set;
+	bool find_y = !fig->y_limits_set;
+	bool y_in_x = fig->x_limits_set && fig->y_autoscale_in_x;
+	bool x_found = false, y_found = false;
 
 	for (int li=0; li<fig->layer_count; li++) {
 		blot_layer *lay = fig->layers[li];
+		double min, max;
+		bool ok, found = true;
 
 		if (!lay->count)
 			continue;
 
-		blot_xy_limits lay_lim;
-		bool ok = blot_layer_get_lim(lay, &lay_lim, error);
-		RETURN_IF(!ok, (blot_xy_limits){});
+		if (find_x) {
+			ok = blot_layer_get_x_lim(lay, &min, &max, error);
+			RETURN_IF(!ok, (blot_xy_limits){});
+
+			lim.x_min = x_found ? min_t(double, lim.x_min, min) : min;
+			lim.x_max = x_found ? max_t(double, lim.x_max, max) : max;
+			x_found = true;
+		}
+
+		if (find_y) {
+			if (y_in_x)
+				ok = blot_layer_get_y_lim_in_x(lay, fig->lim.x_min, fig->lim.x_max,
+							       &min, &max, &found, error);
+			else
+				ok = blot_layer_get_y_lim(lay, &min, &max, error);
+			RETURN_IF(!ok, (blot_xy_limits){});
+
+			if (found) {
+				lim.y_min = y_found ? min_t(double, lim.y_min, min) : min;
+				lim.y_max = y_found ? max_t(double, lim.y_max, max) : max;
+				y_found = true;
+			}
+		}
+	}
+
+	/* nothing inside of the X limits, so fall back to all of the data */
+	if (find_y && y_in_x && !y_found) {
+		for (int li=0; li<fig->layer_count; li++) {
+			blot_layer *lay = fig->layers[li];
+			double min, max;
 
-		if (likely (something_set)) {
-			lim.x_min = min_t(double, lim.x_min, lay_lim.x_min);
-			lim.x_max = max_t(double, lim.x_max, lay_lim.x_max);
+			if (!lay->count)
+				continue;
 
-			lim.y_min = min_t(double, lim.y_min, lay_lim.y_min);
-			lim.y_max = max_t(double, lim.y_max, lay_lim.y_max);
+			bool ok = blot_layer_get_y_lim(lay, &min, &max, error);
+			RETURN_IF(!ok, (blot_xy_limits){});
 
-		} else {
-			lim = lay_lim;
-			something_set = true;
+			lim.y_min = y_found ? min_t(double, lim.y_min, min) : min;
+			lim.y_max = y_found ? max_t(double, lim.y_max, max) : max;
+			y_found = true;
 		}
 	}
 
-	if (unlikely (!something_set)) {
+	if (unlikely ((find_x && !x_found) || (find_y && !y_found))) {
 		blot_set_error_unix(error, ENOENT,
 				    "could not determine limits automatically, since there is no data");
 		return lim;
 	}
 
-
-	/* if there is a range, widen it by 0.1% on either side,
-	 * if there is only one value, make the range 10% on either side */
-	double x_range = lim.x_max - lim.x_min;
-	double x_fudge = x_range ? x_range * 0.001 : (lim.x_min == 0 ? 0.1 : fabs(lim.x_min * 0.1));
-	lim.x_min -= x_fudge;
-	lim.x_max += x_fudge;
-
-	double y_range = lim.y_max - lim.y_min;
-	double y_fudge = y_range ? y_range * 0.001 : (lim.y_min == 0 ? 0.1 : fabs(lim.y_min * 0.1));
-	lim.y_min -= y_fudge;
-	lim.y_max += y_fudge;
+	if (find_x)
+		blot_figure_widen_limits(&lim.x_min, &lim.x_max);
+	if (find_y)
+		blot_figure_widen_limits(&lim.y_min, &lim.y_max);
 
 	return lim;
 }
@@ -315,20 +474,303 @@ static blot_dimensions blot_figure_finalize_usable(const blot_figure *fig,
 	return use;
 }
 
-static void __free_canvases_array(blot_canvas **cans, unsigned count)
+/* with BLOT_RENDER_SCROLL, a canvas whose X window only moved right, and
+ * kept its width, is shifted left by whole cells, and the points from the
+ * right edge of what it held on are drawn again; rounding the shift up
+ * leaves the left edge less than a cell right of the X limit, so that the
+ * newest points are never past the right edge, and a window that moved by
+ * less than that since does not shift at all */
+static bool blot_figure_scroll_canvas(blot_layer *lay, blot_canvas *can, blot_render_memo *memo,
+				      const blot_layer_key *key)
+{
+	const blot_layer_key *old = &memo->key;
+	double range = key->lim.x_max - key->lim.x_min;
+
+	if (key->lay != old->lay || key->generation != old->generation
+	    || key->plot_type != old->plot_type || key->data_type != old->data_type
+	    || key->flags != old->flags
+	    || key->dim.cols != old->dim.cols || key->dim.rows != old->dim.rows
+	    || key->lim.y_min != old->lim.y_min || key->lim.y_max != old->lim.y_max)
+		return false;
+
+	/* moving both ends by the same amount can round the width */
+	if (fabs(range - (old->lim.x_max - old->lim.x_min)) > range * 1e-12)
+		return false;
+
+	/* the summary cannot drop the points that scroll out of view */
+	if (key->flags & BLOT_RENDER_LEGEND_DETAILS)
+		return false;
+
+	if (!lay->count || !blot_layer_x_ascends(lay))
+		return false;
+
+	unsigned cell_cols = (key->flags & BLOT_RENDER_BRAILLE) ? BRAILLE_GLYPH_COLS : 1;
+	double scale = blot_layer_x_scale(lay, &key->lim, can->dim.cols);
+	double shift = (key->lim.x_min - memo->x_origin) * scale / cell_cols;
+
+	/* the canvas can already be up to a cell ahead; this is also false for NaN */
+	if (!(shift > -1))
+		return false;
+
+	double cells = max_t(double, 0, ceil(shift - 1e-9));
+	if (cells >= can->dim.cols / cell_cols)
+		return false;
+
+	/* what was past the right edge was never drawn */
+	double x_from = min_t(double, memo->x_last, memo->x_origin + range);
+
+	blot_canvas_shift_left(can, cells);
+
+	memo->x_origin += cells * cell_cols / scale;
+	if (fabs(memo->x_origin - key->lim.x_min) * scale < 1e-6)
+		memo->x_origin = key->lim.x_min;
+
+	/* nothing in the summary is used, it only has to be set */
+	lay->summary = memo->summary;
+	memo->begin = blot_layer_x_find(lay, x_from);
+	memo->scrolled = true;
+	return true;
+}
+
+/* make sure there is a cleared canvas of the right size for every layer,
+ * or with BLOT_RENDER_INDEXED, a single one that they all share; with
+ * BLOT_RENDER_REUSE, canvases that still hold what their layer would draw
+ * are kept as they are, and marked as reused, and canvases that hold all
+ * but the points added since are kept, with begin set past what they hold */
+static bool blot_figure_prepare_canvases(blot_figure *fig, blot_render_ctx *ctx,
+					 const blot_xy_limits *lim,
+					 const blot_dimensions *use,
+					 blot_render_flags flags,
+					 GError **error)
 {
-	for (int ci=0; ci<count; ci++) {
-		if (!cans[ci])
+	bool indexed = flags & BLOT_RENDER_INDEXED;
+	bool scroll = (flags & BLOT_RENDER_SCROLL) && !indexed;
+	bool reuse = ((flags & BLOT_RENDER_REUSE) || scroll) && !indexed;
+	gsize count = indexed ? 1 : fig->layer_count;
+
+	RETURN_ERRORx(indexed && fig->layer_count > BLOT_COMPOSITE_MAX_LAYERS, false, error, EINVAL,
+		      "cannot index %zu layers, limit is %u",
+		      fig->layer_count, BLOT_COMPOSITE_MAX_LAYERS);
+
+	if (ctx->can_count < count && ctx->arena) {
+		blot_canvas **cans = blot_arena_alloc(ctx->arena, count * sizeof(*cans), error);
+		RETURN_IF(!cans, false);
+		GError **errors = blot_arena_alloc(ctx->arena, count * sizeof(*errors), error);
+		RETURN_IF(!errors, false);
+		blot_render_memo *memos = blot_arena_alloc(ctx->arena, count * sizeof(*memos), error);
+		RETURN_IF(!memos, false);
+
+		if (ctx->can_count) {
+			memcpy(cans, ctx->cans, ctx->can_count * sizeof(*cans));
+			memcpy(errors, ctx->errors, ctx->can_count * sizeof(*errors));
+			memcpy(memos, ctx->memos, ctx->can_count * sizeof(*memos));
+		}
+		ctx->cans = cans;
+		ctx->errors = errors;
+		ctx->memos = memos;
+
+	} else if (ctx->can_count < count) {
+		blot_canvas **cans = blot_renew(blot_canvas*, ctx->cans, count);
+		RETURN_ERROR(!cans, false, error, "new *canvas x %zu", count);
+		ctx->cans = cans;
+
+		GError **errors = blot_renew(GError*, ctx->errors, count);
+		RETURN_ERROR(!errors, false, error, "new *error x %zu", count);
+		ctx->errors = errors;
+
+		blot_render_memo *memos = blot_renew(blot_render_memo, ctx->memos, count);
+		RETURN_ERROR(!memos, false, error, "new memo x %zu", count);
+		ctx->memos = memos;
+	}
+
+	if (ctx->can_count < count) {
+		for (gsize ci=ctx->can_count; ci<count; ci++) {
+			ctx->cans[ci] = NULL;
+			ctx->errors[ci] = NULL;
+			memset(&ctx->memos[ci], 0, sizeof(ctx->memos[ci]));
+		}
+		ctx->can_count = count;
+	}
+
+	/* canvases left over from renders that were not indexed */
+	for (gsize ci=count; ci<ctx->can_count; ci++) {
+		if (ctx->cans[ci] && blot_render_ctx_owns(ctx, ctx->cans[ci]))
+			blot_canvas_delete(ctx->cans[ci]);
+		ctx->cans[ci] = NULL;
+		ctx->memos[ci].valid = false;
+	}
+
+	for (gsize li=0; li<count; li++) {
+		blot_layer *lay = fig->layers[li];
+		blot_canvas *can = ctx->cans[li];
+		blot_render_memo *memo = &ctx->memos[li];
+
+		memo->reused = false;
+		memo->scrolled = false;
+		memo->begin = 0;
+
+		if (can && !blot_canvas_fits(can, use->cols, use->rows, flags)) {
+			if (blot_render_ctx_owns(ctx, can))
+				blot_canvas_delete(can);
+			can = ctx->cans[li] = NULL;
+		}
+
+		if (!can) {
+			memo->valid = false;
+			memo->x_origin = lim->x_min;
+			can = blot_canvas_new_in(ctx->arena, use->cols, use->rows, flags,
+						 lay->color, error);
+			RETURN_IF(!can, false);
+			ctx->cans[li] = can;
 			continue;
-		blot_canvas_delete(cans[ci]);
-		cans[ci] = NULL;
+		}
+
+		can->color = lay->color;
+
+		if (reuse && memo->valid) {
+			blot_layer_key key;
+			blot_layer_key_init(&key, lay, lim, use, flags);
+
+			if (blot_layer_key_equal(&key, &memo->key)) {
+				/* the summary is only made while drawing */
+				lay->summary = memo->summary;
+				memo->reused = true;
+				ctx->reuse_hits ++;
+				continue;
+			}
+
+			if (memo->x_origin == lim->x_min
+			    && blot_layer_key_extends(&key, &memo->key)) {
+				/* the new points add to the summary of the old ones */
+				lay->summary = memo->summary;
+				memo->begin = memo->key.count;
+				ctx->reuse_appends ++;
+				continue;
+			}
+
+			if (scroll && blot_figure_scroll_canvas(lay, can, memo, &key)) {
+				ctx->reuse_scrolls ++;
+				continue;
+			}
+		}
+
+		memo->valid = false;
+		memo->x_origin = lim->x_min;
+		blot_canvas_clear(can);
 	}
+
+	return true;
 }
 
-blot_screen * blot_figure_render(blot_figure *fig, blot_render_flags flags,
-				 GError **error)
+/* remember what the canvases that were drawn now hold */
+static void blot_figure_remember_canvases(blot_figure *fig, blot_render_ctx *ctx,
+					  const blot_xy_limits *lim,
+					  const blot_dimensions *use,
+					  blot_render_flags flags)
+{
+	if (!(flags & (BLOT_RENDER_REUSE | BLOT_RENDER_SCROLL)) || (flags & BLOT_RENDER_INDEXED))
+		return;
+
+	for (gsize li=0; li<fig->layer_count; li++) {
+		blot_layer *lay = fig->layers[li];
+		blot_render_memo *memo = &ctx->memos[li];
+
+		if (memo->reused)
+			continue;
+
+		if (!memo->begin && !memo->scrolled)
+			ctx->reuse_misses ++;
+
+		blot_layer_key_init(&memo->key, lay, lim, use, flags);
+		memo->summary = lay->summary;
+		memo->x_last = -INFINITY;
+		if (lay->count)
+			blot_layer_get_x(lay, lay->count - 1, &memo->x_last, NULL);
+		memo->valid = true;
+	}
+}
+
+/* draw a layer into its canvas, or only the points that its canvas does
+ * not hold yet; a scrolled canvas is drawn with the X window it holds */
+static bool blot_figure_render_layer(blot_layer *lay, const blot_render_memo *memo,
+				     const blot_xy_limits *lim, const blot_dimensions *use,
+				     blot_canvas *can, GError **error)
+{
+	blot_xy_limits at = *lim;
+	if (memo->x_origin != lim->x_min) {
+		at.x_min = memo->x_origin;
+		at.x_max = memo->x_origin + (lim->x_max - lim->x_min);
+	}
+
+	if (memo->begin || memo->scrolled)
+		return blot_layer_render_append(lay, &at, use, can, memo->begin, error);
+
+	return blot_layer_render_into(lay, &at, use, can, error);
+}
+
+/* each layer renders into its own canvas, and records its own error */
+struct blot_figure_render_job {
+	blot_figure *fig;
+	const blot_xy_limits *lim;
+	const blot_dimensions *use;
+	blot_canvas **cans;
+	GError **errors;
+	const blot_render_memo *memos;
+};
+
+static void blot_figure_render_layers_chunk(void *data, unsigned chunk,
+					    size_t begin, size_t end)
+{
+	struct blot_figure_render_job *job = data;
+
+	for (size_t li=begin; li<end; li++) {
+		blot_layer *lay = job->fig->layers[li];
+
+		if (job->memos[li].reused)
+			continue;
+
+		bool ok = blot_figure_render_layer(lay, &job->memos[li], job->lim, job->use,
+						   job->cans[li], &job->errors[li]);
+		if (!ok && !job->errors[li])
+			blot_set_error_unix(&job->errors[li], EFAULT,
+					    "layer %zu failed to render", li);
+	}
+}
+
+static bool blot_figure_render_layers_parallel(blot_figure *fig,
+					       blot_render_ctx *ctx,
+					       const blot_xy_limits *lim,
+					       const blot_dimensions *use,
+					       GError **error)
+{
+	GError **errors = ctx->errors;
+
+	struct blot_figure_render_job job = {
+		.fig = fig, .lim = lim, .use = use,
+		.cans = ctx->cans, .errors = errors,
+		.memos = ctx->memos,
+	};
+
+	if (!blot_parallel_for(fig->layer_count, 1,
+			       blot_figure_render_layers_chunk, &job, error))
+		return false;
+
+	/* report the error of the lowest failing layer, as the serial loop would */
+	bool render_ok = true;
+	for (int li=0; li<fig->layer_count; li++) {
+		if (errors[li] && render_ok) {
+			g_propagate_error(error, g_steal_pointer(&errors[li]));
+			render_ok = false;
+		}
+		g_clear_error(&errors[li]);
+	}
+
+	return render_ok;
+}
+
+static blot_screen * blot_figure_render_ctx(blot_figure *fig, blot_render_ctx *ctx,
+					    blot_render_flags flags, GError **error)
 {
-	RETURN_EFAULT_IF(fig==NULL, NULL, error);
 	RETURN_EINVAL_IF(fig->layer_count==0, NULL, error);
 	RETURN_EINVAL_IF(fig->layers==NULL, NULL, error);
 
@@ -356,68 +798,124 @@ blot_screen * blot_figure_render(blot_figure *fig, blot_render_flags flags,
 
 	/* generate the canvases */
 
-	g_autofree blot_canvas **cans = NULL;
-	g_autofree blot_axis *x_axs = NULL;
-	g_autofree blot_axis *y_axs = NULL;
+	bool ok = blot_figure_prepare_canvases(fig, ctx, &lim, &use, flags, error);
+	RETURN_IF(!ok, NULL);
+
+	if (flags & BLOT_RENDER_INDEXED) {
+		/* layers draw one after the other, in the order they stack */
+		blot_canvas *can = ctx->cans[0];
 
-	/* generate the canvases */
+		for (int li=0; li<fig->layer_count; li++) {
+			can->layer = li + 1;
 
-	cans = g_new0(blot_canvas*, fig->layer_count);
-	RETURN_ERROR(!cans, NULL, error, "new *canvas x %u", fig->layer_count);
+			ok = blot_layer_render_into(fig->layers[li], &lim, &use, can, error);
+			RETURN_IF(!ok, NULL);
+		}
 
-	for (int li=0; li<fig->layer_count; li++) {
+	} else if ((flags & BLOT_RENDER_PARALLEL) && fig->layer_count > 1) {
+		ok = blot_figure_render_layers_parallel(fig, ctx, &lim, &use, error);
+		RETURN_IF(!ok, NULL);
+
+	} else for (int li=0; li<fig->layer_count; li++) {
 		blot_layer *lay = fig->layers[li];
 
-		cans[li] = blot_layer_render(lay, &lim, &use,
-					     flags, error);
-		if (!cans[li]) {
-			/* error: unwind the canvases we allocated */
-			__free_canvases_array(cans, li);
-			return NULL;
-		}
+		if (ctx->memos[li].reused)
+			continue;
+
+		ok = blot_figure_render_layer(lay, &ctx->memos[li], &lim, &use, ctx->cans[li], error);
+		RETURN_IF(!ok, NULL);
 	}
 
-	/* prepare the axis */
+	blot_figure_remember_canvases(fig, ctx, &lim, &use, flags);
+
+	/* prepare the axis, these are kept by the figure between renders */
 
 	bool x_axs_visible = !(flags & BLOT_RENDER_NO_X_AXIS);
-	x_axs = blot_axis_new(0, x_axs_visible,
-					fig->axis_color,
-					dim.cols - mrg.left - mrg.right,
-					lim.x_min, lim.x_max,
-					&fig->xlabels, error);
-	if (*error) __free_canvases_array(cans, fig->layer_count);
-	RETURN_IF(*error, NULL);
+	fig->x_axs = blot_axis_renew(fig->x_axs, NULL, 0, x_axs_visible,
+				     fig->axis_color,
+				     dim.cols - mrg.left - mrg.right,
+				     lim.x_min, lim.x_max,
+				     &fig->xlabels, error);
+	RETURN_IF(!fig->x_axs, NULL);
 
 	bool y_axs_visible = !(flags & BLOT_RENDER_NO_Y_AXIS);
-	y_axs = blot_axis_new(1, y_axs_visible,
-					fig->axis_color,
-					dim.rows - mrg.top - mrg.bottom,
-					lim.y_min, lim.y_max,
-					NULL, error);
-	if (*error) __free_canvases_array(cans, fig->layer_count);
-	RETURN_IF(*error, NULL);
+	fig->y_axs = blot_axis_renew(fig->y_axs, NULL, 1, y_axs_visible,
+				     fig->axis_color,
+				     dim.rows - mrg.top - mrg.bottom,
+				     lim.y_min, lim.y_max,
+				     NULL, error);
+	RETURN_IF(!fig->y_axs, NULL);
 
 	/* merge canvases to screen */
 
-	blot_screen *scr = blot_screen_new(&dim, &mrg, flags, error);
-	if (!scr) {
-		__free_canvases_array(cans, fig->layer_count);
-		return NULL;
-	}
+	if (ctx->scr)
+		ok = blot_screen_reset(ctx->scr, &dim, &mrg, flags, error);
+	else
+		ok = !!(ctx->scr = blot_screen_new(&dim, &mrg, flags, error));
+	RETURN_IF(!ok, NULL);
+
+	ctx->scr->color = fig->context ? fig->context->color : have_color_support;
 
-	bool render_ok = blot_screen_render(scr, &lim, x_axs, y_axs,
-					    fig->layer_count, fig->layers, cans,
-					    error);
+	ok = blot_screen_render(ctx->scr, &lim, fig->x_axs, fig->y_axs,
+				fig->layer_count, fig->layers, ctx->cans,
+				error);
+	RETURN_IF(!ok, NULL);
 
-	/* we no longer need the canvases */
-	__free_canvases_array(cans, fig->layer_count);
+	return ctx->scr;
+}
 
-	/* if render to screen failed, we return */
-	if (!render_ok) {
-		blot_screen_delete(scr);
-		return NULL;
-	}
+blot_screen * blot_figure_render_into(blot_figure *fig, blot_render_ctx *ctx,
+				      blot_render_flags flags, GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, NULL, error);
+	RETURN_EFAULT_IF(ctx==NULL, NULL, error);
+
+	memset(&fig->render_mem, 0, sizeof(fig->render_mem));
+	blot_mem_stats *prev = blot_mem_scope_enter(&fig->render_mem);
+
+	blot_screen *scr = blot_figure_render_ctx(fig, ctx, flags, error);
+
+	blot_mem_scope_leave(prev);
+	return scr;
+}
+
+blot_screen * blot_figure_render(blot_figure *fig, blot_render_flags flags,
+				 GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, NULL, error);
 
+	blot_render_ctx ctx;
+	blot_arena arena;
+
+	bool ok = blot_render_ctx_init(&ctx, error)
+		&& blot_arena_init(&arena, error);
+	RETURN_IF(!ok, NULL);
+
+	memset(&fig->render_mem, 0, sizeof(fig->render_mem));
+	blot_mem_stats *prev = blot_mem_scope_enter(&fig->render_mem);
+
+	/* everything but the screen is only needed during the render, so it
+	 * comes from an arena that is thrown away in one go at the end */
+	ctx.arena = &arena;
+
+	blot_screen *scr = blot_figure_render_ctx(fig, &ctx, flags, error);
+
+	/* the screen is handed to the caller, the rest is not needed */
+	if (scr)
+		ctx.scr = NULL;
+	blot_render_ctx_cleanup(&ctx);
+	blot_arena_release(&arena);
+
+	blot_mem_scope_leave(prev);
 	return scr;
 }
 
+bool blot_figure_get_render_mem_stats(const blot_figure *fig,
+				      blot_mem_stats *stats, GError **error)
+{
+	RETURN_EFAULT_IF(fig==NULL, false, error);
+	RETURN_EFAULT_IF(stats==NULL, false, error);
+
+	*stats = fig->render_mem;
+	return true;
+}
@@ -3,8 +3,21 @@
 #include <string.h>
 #include <math.h>
 #include "blot_layer.h"
+#include "blot_alloc.h"
 #include "blot_error.h"
 #include "blot_canvas.h"
+#include "blot_minmax.h"
+#include "blot_transform.h"
+#include "blot_parallel.h"
+
+/* generations and revisions come from one counter shared by all layers,
+ * so that a layer never takes over the key of one deleted before it */
+static guint64 blot_layer_stamp_counter;
+
+static inline guint64 blot_layer_stamp(void)
+{
+	return __atomic_add_fetch(&blot_layer_stamp_counter, 1, __ATOMIC_RELAXED);
+}
 
 /* create/delete */
 
@@ -25,7 +38,7 @@ blot_layer * blot_layer_new(blot_plot_type plot_type,
 	RETURN_ERRORx(plot_type >= BLOT_PLOT_TYPE_MAX, false, error, EINVAL,
 		      "x_min >= x_max");
 
-	lay = g_new(blot_layer, 1);
+	lay = blot_new0(blot_layer, 1);
 	RETURN_ERROR(!lay, NULL, error, "new blot_layer");
 
 	lay->plot_type = plot_type;
@@ -35,65 +48,387 @@ blot_layer * blot_layer_new(blot_plot_type plot_type,
 	lay->ys        = ys;
 	lay->color     = color;
 	lay->label     = label ?: "";
+	lay->generation = lay->revision = blot_layer_stamp();
+
+	return lay;
+}
+
+blot_layer * blot_layer_new_ring(blot_plot_type plot_type,
+				 blot_data_type data_type,
+				 size_t capacity,
+				 blot_color color,
+				 const char *label,
+				 GError **error)
+{
+	RETURN_ERRORx(!capacity, NULL, error, EINVAL, "capacity is zero");
+	RETURN_ERRORx(plot_type >= BLOT_PLOT_TYPE_MAX, NULL, error, EINVAL,
+		      "plot_type=%u is invalid", plot_type);
+	RETURN_ERRORx(data_type >= BLOT_DATA_TYPE_MAX, NULL, error, EINVAL,
+		      "data_type=%u is invalid", data_type);
+
+	blot_layer *lay = blot_new0(blot_layer, 1);
+	RETURN_ERROR(!lay, NULL, error, "new blot_layer");
+
+	size_t x_size = blot_data_elem_size(BLOT_DATA_X_ELEM(data_type));
+	size_t y_size = blot_data_elem_size(BLOT_DATA_Y_ELEM(data_type));
+
+	/* set first, so that delete frees the arrays */
+	lay->capacity = capacity;
+	lay->xs = blot_malloc(blot_alloc_size_n(capacity, x_size));
+	lay->ys = blot_malloc(blot_alloc_size_n(capacity, y_size));
+	if (!lay->xs || !lay->ys) {
+		blot_layer_delete(lay);
+		RETURN_ERRORx(true, NULL, error, ENOMEM, "new ring of %zu points", capacity);
+	}
+
+	lay->plot_type = plot_type;
+	lay->data_type = data_type;
+	lay->color     = color;
+	lay->label     = label ?: "";
+	lay->generation = lay->revision = blot_layer_stamp();
 
 	return lay;
 }
 
 void blot_layer_delete(blot_layer *lay)
 {
-	g_free(lay);
+	if (lay && lay->capacity) {
+		blot_free((void*)lay->xs);
+		blot_free((void*)lay->ys);
+	}
+	blot_free(lay);
 }
 
 /* data */
 
-bool blot_layer_get_lim(const blot_layer *lay, blot_xy_limits *lim, GError **error)
+void blot_layer_touch(blot_layer *lay)
 {
-	RETURN_EFAULT_IF(lay==NULL, NULL, error);
-	double x, y;
-	bool ok;
+	lay->generation = lay->revision = blot_layer_stamp();
+}
+
+bool blot_layer_set_data(blot_layer *lay, size_t count,
+			 const void *xs, const void *ys, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+	RETURN_ERRORx(lay->capacity, false, error, EINVAL, "ring layer owns its data");
+	RETURN_ERRORx(!count, false, error, EFAULT, "count is NULL");
+	RETURN_ERRORx(!ys, false, error, EFAULT, "ys pointer is NULL");
+
+	lay->count = count;
+	lay->xs    = xs;
+	lay->ys    = ys;
+	lay->generation = lay->revision = blot_layer_stamp();
+
+	return true;
+}
+
+bool blot_layer_extend(blot_layer *lay, size_t count,
+		       const void *xs, const void *ys, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+	RETURN_ERRORx(lay->capacity, false, error, EINVAL, "ring layer owns its data");
+	RETURN_ERRORx(!ys, false, error, EFAULT, "ys pointer is NULL");
+	RETURN_ERRORx(count < lay->count, false, error, EINVAL,
+		      "data cannot shrink from %zu to %zu", lay->count, count);
+	RETURN_ERRORx(!xs != !lay->xs, false, error, EINVAL,
+		      "xs cannot switch between an index and an array");
+
+	lay->count = count;
+	lay->xs    = xs;
+	lay->ys    = ys;
+	lay->revision = blot_layer_stamp();
+
+	return true;
+}
+
+/* the oldest points of a ring are dropped; the cached limits stay valid
+ * for the points that remain, unless one of the dropped points was an
+ * extreme, since there could be no other point with that value */
+static void blot_layer_lim_cache_drop(blot_layer_lim_cache *cache, const blot_layer *lay,
+				      bool x, size_t dropped)
+{
+	if (cache->generation != lay->generation)
+		return;
+
+	size_t checked = min_t(size_t, dropped, cache->count);
+	for (size_t i=0; i<checked; i++) {
+		double v = 0;
+		if (x)
+			blot_layer_get_x(lay, i, &v, NULL);
+		else
+			blot_layer_get_y(lay, i, &v, NULL);
+
+		if (v <= cache->min || v >= cache->max) {
+			cache->count = 0;
+			return;
+		}
+	}
+
+	cache->count -= checked;
+}
+
+bool blot_layer_append(blot_layer *lay, size_t count,
+		       const void *xs, const void *ys, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+	RETURN_ERRORx(!lay->capacity, false, error, EINVAL, "only a ring layer can be appended to");
+	RETURN_ERRORx(!xs, false, error, EFAULT, "xs pointer is NULL");
+	RETURN_ERRORx(!ys, false, error, EFAULT, "ys pointer is NULL");
+
+	size_t x_size = blot_data_elem_size(BLOT_DATA_X_ELEM(lay->data_type));
+	size_t y_size = blot_data_elem_size(BLOT_DATA_Y_ELEM(lay->data_type));
+
+	if (count >= lay->capacity) {
+		/* only the last capacity points are kept, they replace everything */
+		size_t skip = count - lay->capacity;
+		memcpy((void*)lay->xs, (const guint8 *)xs + skip * x_size, lay->capacity * x_size);
+		memcpy((void*)lay->ys, (const guint8 *)ys + skip * y_size, lay->capacity * y_size);
+		lay->head = 0;
+		lay->count = lay->capacity;
+		lay->generation = lay->revision = blot_layer_stamp();
+		return true;
+	}
+
+	size_t dropped = lay->count + count > lay->capacity
+		? lay->count + count - lay->capacity : 0;
+
+	if (dropped) {
+		blot_layer_lim_cache_drop(&lay->x_lim, lay, true, dropped);
+		blot_layer_lim_cache_drop(&lay->y_lim, lay, false, dropped);
+
+		/* what is left of an ascending run still ascends */
+		if (lay->x_order_generation == lay->generation)
+			lay->x_order_count -= min_t(size_t, dropped, lay->x_order_count);
+
+		lay->head = blot_layer_pos(lay, dropped);
+		lay->count -= dropped;
+	}
+
+	/* the new points go after the last one, in at most two pieces */
+	blot_layer_segment segs[2];
+	size_t begin = lay->count;
+	lay->count += count;
+	lay->revision = blot_layer_stamp();
+	unsigned nsegs = blot_layer_segments(lay, begin, lay->count, segs);
+
+	for (unsigned si=0; si<nsegs; si++) {
+		size_t n = segs[si].end - segs[si].begin;
+		size_t from = segs[si].index - begin;
+
+		memcpy((guint8 *)lay->xs + segs[si].begin * x_size,
+		       (const guint8 *)xs + from * x_size, n * x_size);
+		memcpy((guint8 *)lay->ys + segs[si].begin * y_size,
+		       (const guint8 *)ys + from * y_size, n * y_size);
+	}
+
+	return true;
+}
+
+/* min/max of the points [begin,end) of one axis, which can wrap around */
+static bool blot_layer_minmax(const blot_layer *lay, blot_data_type elem_type, const void *data,
+			      size_t begin, size_t end, double *min, double *max, GError **error)
+{
+	blot_layer_segment segs[2];
+	unsigned nsegs = blot_layer_segments(lay, begin, end, segs);
+	size_t elem_size = blot_data_elem_size(elem_type);
+
+	for (unsigned si=0; si<nsegs; si++) {
+		double smin, smax;
+		const guint8 *first = (const guint8 *)data + segs[si].begin * elem_size;
+		bool ok = blot_minmax(elem_type, first, segs[si].end - segs[si].begin,
+				      &smin, &smax, error);
+		RETURN_IF(!ok, false);
+
+		*min = si ? min_t(double, *min, smin) : smin;
+		*max = si ? max_t(double, *max, smax) : smax;
+	}
+
+	return true;
+}
+
+/* fold the values that the cache has not seen yet into it */
+static bool blot_layer_lim_cache_update(blot_layer_lim_cache *cache, const blot_layer *lay,
+					blot_data_type elem_type, const void *data,
+					GError **error)
+{
+	if (cache->generation != lay->generation || cache->count > lay->count) {
+		cache->generation = lay->generation;
+		cache->count = 0;
+	}
+
+	if (likely (cache->count == lay->count))
+		return true;
+
+	double min, max;
+	bool ok = blot_layer_minmax(lay, elem_type, data, cache->count, lay->count,
+				    &min, &max, error);
+	RETURN_IF(!ok, false);
+
+	if (cache->count) {
+		cache->min = min_t(double, cache->min, min);
+		cache->max = max_t(double, cache->max, max);
+	} else {
+		cache->min = min;
+		cache->max = max;
+	}
+	cache->count = lay->count;
+
+	return true;
+}
+
+bool blot_layer_get_x_lim(blot_layer *lay, double *x_min, double *x_max, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
 
 	if (unlikely (!lay->count)) {
-		memset(lim, 0, sizeof(*lim));
+		*x_min = *x_max = 0;
 		return true;
 	}
 
 	if (unlikely (!lay->xs)) {
+		/* X data can be NULL, that means we
+		 * are plotting the index as X */
+		*x_min = 0;
+		*x_max = lay->count - 1;
+		return true;
+	}
 
-		lim->x_min = 0;
-		lim->x_max = lay->count > 0 ? lay->count - 1 : 0;
+	bool ok = blot_layer_lim_cache_update(&lay->x_lim, lay, BLOT_DATA_X_ELEM(lay->data_type),
+					      lay->xs, error);
+	RETURN_IF(!ok, false);
 
-		ok = blot_layer_get_y(lay, 0, &y, error);
-		RETURN_IF(!ok, lim);
+	*x_min = lay->x_lim.min;
+	*x_max = lay->x_lim.max;
+	return true;
+}
 
-		lim->y_min = lim->y_max = y;
+bool blot_layer_get_y_lim(blot_layer *lay, double *y_min, double *y_max, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
 
-		for (int di=1; di<lay->count; di++) {
-			ok = blot_layer_get_y(lay, di, &y, error);
-			RETURN_IF(!ok, lim);
+	if (unlikely (!lay->count)) {
+		*y_min = *y_max = 0;
+		return true;
+	}
 
-			lim->y_min = min_t(double, lim->y_min, y);
-			lim->y_max = max_t(double, lim->y_max, y);
-		}
+	RETURN_ERRORx(!lay->ys, false, error, ENOENT, "Y-data is NULL");
+
+	bool ok = blot_layer_lim_cache_update(&lay->y_lim, lay, BLOT_DATA_Y_ELEM(lay->data_type),
+					      lay->ys, error);
+	RETURN_IF(!ok, false);
+
+	*y_min = lay->y_lim.min;
+	*y_max = lay->y_lim.max;
+	return true;
+}
+
+bool blot_layer_get_lim(blot_layer *lay, blot_xy_limits *lim, GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+
+	return blot_layer_get_x_lim(lay, &lim->x_min, &lim->x_max, error)
+		&& blot_layer_get_y_lim(lay, &lim->y_min, &lim->y_max, error);
+}
+
+static inline double blot_layer_x_at(const blot_layer *lay, size_t index)
+{
+	double x = 0;
+	blot_layer_get_x(lay, index, &x, NULL);
+	return x;
+}
+
+/* appended data only needs to be compared with what came before it */
+bool blot_layer_x_ascends(blot_layer *lay)
+{
+	if (!lay->xs)
 		return true;
+
+	if (lay->x_order_generation != lay->generation || lay->x_order_count > lay->count
+	    || !lay->x_order_count) {
+		lay->x_order_generation = lay->generation;
+		lay->x_order_count = 0;
+		lay->x_sorted = true;
 	}
 
-	ok = blot_layer_get_x_y(lay, 0, &x, &y, error);
-	RETURN_IF(!ok, lim);
+	if (lay->x_sorted) {
+		double prev = lay->x_order_count ? blot_layer_x_at(lay, lay->x_order_count - 1) : -INFINITY;
+
+		for (size_t i=lay->x_order_count; i<lay->count; i++) {
+			double x = blot_layer_x_at(lay, i);
+			/* NaN does not ascend either */
+			if (!(x >= prev)) {
+				lay->x_sorted = false;
+				break;
+			}
+			prev = x;
+		}
+	}
+	lay->x_order_count = lay->count;
+
+	return lay->x_sorted;
+}
+
+/* index of the first point with X not below x (or above it, if past) */
+static size_t blot_layer_x_bound(const blot_layer *lay, double x, bool past)
+{
+	size_t lo = 0, hi = lay->count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		double v = blot_layer_x_at(lay, mid);
+		if (past ? v <= x : v < x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+size_t blot_layer_x_find(const blot_layer *lay, double x)
+{
+	return blot_layer_x_bound(lay, x, false);
+}
+
+bool blot_layer_get_y_lim_in_x(blot_layer *lay, double x_min, double x_max,
+			       double *y_min, double *y_max, bool *found,
+			       GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+
+	*found = false;
+	*y_min = INFINITY;
+	*y_max = -INFINITY;
+
+	if (unlikely (!lay->count))
+		return true;
+
+	RETURN_ERRORx(!lay->ys, false, error, ENOENT, "Y-data is NULL");
+
+	if (blot_layer_x_ascends(lay)) {
+		/* the points in the window are all next to each other */
+		size_t begin = blot_layer_x_bound(lay, x_min, false);
+		size_t end = blot_layer_x_bound(lay, x_max, true);
+		if (begin >= end)
+			return true;
 
-	lim->x_min = lim->x_max = x;
-	lim->y_min = lim->y_max = y;
+		bool ok = blot_layer_minmax(lay, BLOT_DATA_Y_ELEM(lay->data_type), lay->ys,
+					    begin, end, y_min, y_max, error);
+		RETURN_IF(!ok, false);
 
-	for (int di=1; di<lay->count; di++) {
-		ok = blot_layer_get_x_y(lay, di, &x, &y, error);
-		RETURN_IF(!ok, lim);
+	} else for (size_t i=0; i<lay->count; i++) {
+		double x, y;
+		bool ok = blot_layer_get_x_y(lay, i, &x, &y, error);
+		RETURN_IF(!ok, false);
 
-		lim->x_min = min_t(double, lim->x_min, x);
-		lim->x_max = max_t(double, lim->x_max, x);
+		if (x < x_min || x > x_max || isnan(y))
+			continue;
 
-		lim->y_min = min_t(double, lim->y_min, y);
-		lim->y_max = max_t(double, lim->y_max, y);
+		*y_min = min_t(double, *y_min, y);
+		*y_max = max_t(double, *y_max, y);
 	}
 
+	*found = *y_min <= *y_max;
 	return true;
 }
 
@@ -134,200 +469,637 @@ static void blot_layer_summary_update(struct blot_layer_summary *sum, double x,
 	}
 }
 
-/* render */
-
-static bool blot_layer_scatter(blot_layer *lay, const blot_xy_limits *lim,
-			 blot_canvas *can, GError **);
-static bool blot_layer_scatter_int64(blot_layer *lay, const blot_xy_limits *lim,
-			       blot_canvas *can, GError **);
-static bool blot_layer_line(blot_layer *lay, const blot_xy_limits *lim,
-		      blot_canvas *can, GError **);
-static bool blot_layer_bar(blot_layer *lay, const blot_xy_limits *lim,
-		      blot_canvas *can, GError **);
+static void blot_layer_summary_merge(struct blot_layer_summary *sum,
+				     const struct blot_layer_summary *add)
+{
+	if (likely (!sum->enabled) || !add->count)
+		return;
 
-typedef bool (*layer_to_canvas_fn)(blot_layer *lay, const blot_xy_limits *lim,
-				   blot_canvas *can, GError **);
-static layer_to_canvas_fn blot_layer_to_canvas_type_fns[BLOT_PLOT_TYPE_MAX][BLOT_DATA_TYPE_MAX] = {
-	[BLOT_SCATTER] = {
-		[BLOT_DATA_INT64] = blot_layer_scatter_int64,
+	if (likely (sum->count)) {
+		if (sum->xmax < add->xmax) sum->xmax = add->xmax;
+		if (sum->xmin > add->xmin) sum->xmin = add->xmin;
+		sum->xttl += add->xttl;
+		if (sum->ymax < add->ymax) sum->ymax = add->ymax;
+		if (sum->ymin > add->ymin) sum->ymin = add->ymin;
+		sum->yttl += add->yttl;
+		sum->count += add->count;
+	} else {
+		*sum = *add;
 	}
-};
-static layer_to_canvas_fn blot_layer_to_canvas_fns[BLOT_PLOT_TYPE_MAX] = {
-	[BLOT_SCATTER]   = blot_layer_scatter,
-	[BLOT_LINE]      = blot_layer_line,
-	[BLOT_BAR]       = blot_layer_bar,
-};
+}
 
-struct blot_canvas * blot_layer_render(blot_layer *lay,
-				       const blot_xy_limits *lim,
-				       const blot_dimensions *dim,
-				       blot_render_flags flags,
-				       GError **error)
-{
-	RETURN_EFAULT_IF(lay==NULL, NULL, error);
-	RETURN_EINVAL_IF(lay->plot_type>BLOT_PLOT_TYPE_MAX, NULL, error);
-	RETURN_EINVAL_IF(lay->data_type>BLOT_DATA_TYPE_MAX, NULL, error);
+/* render
+ *
+ * Each plot type is split into begin/point/end steps.  The generic handlers
+ * read every point through blot_layer_get_x_y(), while the typed kernels
+ * generated further down walk the raw X/Y arrays in a tight loop; for a ring
+ * layer that is done once for each of the two segments the data wraps into.
+ *
+ * Every handler draws the points [begin,end) of the layer, so that a large
+ * layer can be split up and drawn by several threads at once; the line plot
+ * also gets the point before begin, through its lead step, so that the
+ * segment joining two ranges is drawn. */
+
+/* line decimation
+ *
+ * Consecutive points that round to the same canvas column can only draw
+ * vertical segments in that column, and together those cover the range
+ * between the lowest and the highest of them.  So for each such run we keep
+ * the first point, the extremes, and the last point, and drop everything
+ * else.  The pixels are identical to drawing every segment, but the number
+ * of segments drawn scales with the canvas width rather than the point count. */
+
+typedef struct blot_line_point {
+	double x, y;
+	unsigned idx;
+} blot_line_point;
 
-	blot_canvas *can = blot_canvas_new(dim->cols, dim->rows, flags, lay->color, error);
-	RETURN_IF(!can, NULL);
+typedef struct blot_line_decimator {
+	blot_canvas *can;
+	bool decimate;
 
-	blot_layer_summary_init(&lay->summary, flags);
+	/* last point that was emitted to the canvas */
+	bool visible;
+	double px, py;
 
-	layer_to_canvas_fn fn;
-	/* try to find function specialized for this type */
-	fn = blot_layer_to_canvas_type_fns[lay->plot_type][lay->data_type];
-	if (!fn)
-		/* otherwise use the generic function, that will be a bit slower */
-		fn = blot_layer_to_canvas_fns[lay->plot_type];
+	/* current run of points in the same column */
+	unsigned run;
+	blot_line_point first, lo, hi, last;
+} blot_line_decimator;
 
-	RETURN_ERRORx(!fn, NULL, error, EINVAL,
-		      "no handler for plot_type=%u", lay->plot_type);
+static inline void blot_line_decimator_init(blot_line_decimator *dec,
+					    blot_canvas *can, bool decimate)
+{
+	memset(dec, 0, sizeof(*dec));
+	dec->can = can;
+	dec->decimate = decimate;
+}
 
-	bool plot_ok = fn(lay, lim, can, error);
-	if (!plot_ok) {
-		blot_canvas_delete(can);
-		return NULL;
-	}
+static inline void blot_line_emit(blot_line_decimator *dec, double x, double y)
+{
+	if (likely (dec->visible))
+		blot_canvas_draw_line(dec->can, dec->px, dec->py, x, y);
 
-	return can;
+	// remember current point for next line
+	dec->px = x;
+	dec->py = y;
+	dec->visible = true;
 }
 
-/* scatter */
-
-static bool blot_layer_scatter(blot_layer *lay, const blot_xy_limits *lim,
-			 blot_canvas *can, GError **error)
+static void blot_line_flush(blot_line_decimator *dec)
 {
-	double x_range = lim->x_max - lim->x_min + 1;
-	double y_range = lim->y_max - lim->y_min + 1;
-
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
+	if (!dec->run)
+		return;
 
-	for (int di=0; di<lay->count; di++) {
-		// read the location
-		double rx, ry;
+	blot_line_emit(dec, dec->first.x, dec->first.y);
 
-		gboolean ok = blot_layer_get_x_y(lay, di, &rx, &ry, error);
-		if (unlikely (!ok))
-			return false;
+	if (dec->run > 1) {
+		/* interior points are emitted in the order they were seen */
+		blot_line_point mid[2] = { dec->lo, dec->hi };
 
-		blot_layer_summary_update(&lay->summary, rx, ry);
+		if (mid[0].idx > mid[1].idx)
+			swap_t(blot_line_point, mid[0], mid[1]);
 
-		// compute location
-		double dx = (double)(rx - lim->x_min) * can->dim.cols / x_range;
-		double dy = (double)(ry - lim->y_min) * can->dim.rows / y_range;
+		unsigned done = dec->first.idx;
+		for (int mi=0; mi<2; mi++) {
+			if (mid[mi].idx <= done)
+				continue;
+			blot_line_emit(dec, mid[mi].x, mid[mi].y);
+			done = mid[mi].idx;
+		}
 
-		// plot it
-		blot_canvas_draw_point(can, round(dx), round(dy));
+		blot_line_emit(dec, dec->last.x, dec->last.y);
 	}
-	return true;
+
+	dec->run = 0;
 }
 
-static bool blot_layer_scatter_int64(blot_layer *lay, const blot_xy_limits *lim,
-			       blot_canvas *can, GError **error)
+static inline void blot_line_push(blot_line_decimator *dec,
+				  double x, double y, unsigned idx)
 {
-	/* this function should never be called with any other data type */
-	g_assert(lay->data_type == BLOT_DATA_INT64);
+	if (!dec->decimate) {
+		blot_line_emit(dec, x, y);
+		return;
+	}
+
+	blot_line_point pt = { x, y, idx };
+
+	if (likely (dec->run) && dec->first.x == x) {
+		/* same column, the previous last point is now interior */
+		if (dec->last.y < dec->lo.y) dec->lo = dec->last;
+		if (dec->last.y > dec->hi.y) dec->hi = dec->last;
+		dec->last = pt;
+		dec->run ++;
+		return;
+	}
+
+	blot_line_flush(dec);
+
+	dec->first = dec->lo = dec->hi = dec->last = pt;
+	dec->run = 1;
+}
+
+typedef struct blot_layer_raster {
+	blot_layer *lay;
+	blot_canvas *can;
+	const blot_xy_limits *lim;
+	blot_layer_summary *sum;        // where the points drawn are summarized
 
-	const gint64 *xs = lay->xs;
-	const gint64 *ys = lay->ys;
+	double x_scale, y_scale;        // data units to canvas pixels
+	double bar_width;               // only for bar plots
 
+	blot_line_decimator dec;        // only for line plots
+} blot_layer_raster;
+
+static inline bool blot_layer_raster_init(blot_layer_raster *r, blot_layer *lay,
+					  const blot_xy_limits *lim, blot_canvas *can,
+					  blot_layer_summary *sum,
+					  double x_range, double y_range, GError **error)
+{
 	RETURN_ERRORx(!lay->ys, false, error, ENOENT, "Y-data is NULL");
+	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
+	RETURN_ERRORx(y_range <= 0, false, error, ERANGE, "invalid row limits %f..%f", lim->y_min, lim->y_max);
 
+	r->lay = lay;
+	r->can = can;
+	r->lim = lim;
+	r->sum = sum;
+	return true;
+}
+
+/* scatter */
+
+static inline bool blot_layer_scatter_begin(blot_layer_raster *r, blot_layer *lay,
+					    const blot_xy_limits *lim, blot_canvas *can,
+					    blot_layer_summary *sum, GError **error)
+{
 	double x_range = lim->x_max - lim->x_min + 1;
 	double y_range = lim->y_max - lim->y_min + 1;
 
-	for (int di=0; di<lay->count; di++) {
-		// read the location
-		double rx, ry;
+	bool ok = blot_layer_raster_init(r, lay, lim, can, sum, x_range, y_range, error);
+	RETURN_IF(!ok, false);
 
-		rx = xs ? xs[di] : di;
-		ry = ys[di];
+	r->x_scale = can->dim.cols / x_range;
+	r->y_scale = can->dim.rows / y_range;
+	return true;
+}
+
+static inline void blot_layer_scatter_point(blot_layer_raster *r, double rx, double ry,
+					    unsigned di)
+{
+	blot_layer_summary_update(r->sum, rx, ry);
+
+	// compute location
+	double dx = (double)(rx - r->lim->x_min) * r->x_scale;
+	double dy = (double)(ry - r->lim->y_min) * r->y_scale;
 
-		blot_layer_summary_update(&lay->summary, rx, ry);
+	// plot it
+	blot_canvas_draw_point(r->can, round(dx), round(dy));
+}
 
-		// compute location
-		double dx = (double)(rx - lim->x_min) * can->dim.cols / x_range;
-		double dy = (double)(ry - lim->y_min) * can->dim.rows / y_range;
+static inline void blot_layer_scatter_lead(blot_layer_raster *r, double rx, double ry,
+					   unsigned di)
+{
+}
 
-		// plot it
-		blot_canvas_draw_point(can, round(dx), round(dy));
+static inline void blot_layer_scatter_end(blot_layer_raster *r)
+{
+}
+
+/* the typed scatter kernels transform the points in batches, and points
+ * that land outside of the canvas are dropped by the visibility mask before
+ * they get to the canvas; this matters when zoomed in on a small part of
+ * the data */
+static bool blot_layer_scatter_batched(blot_layer_raster *r, const blot_layer_segment *seg,
+				       GError **error)
+{
+	blot_layer *lay = r->lay;
+	blot_transform tr = {
+		.x_min = r->lim->x_min, .x_scale = r->x_scale,
+		.y_min = r->lim->y_min, .y_scale = r->y_scale,
+		.cols = r->can->dim.cols, .rows = r->can->dim.rows,
+	};
+
+	gint32 cols[BLOT_TRANSFORM_BATCH], rows[BLOT_TRANSFORM_BATCH];
+	guint64 visible[BLOT_TRANSFORM_MASK_WORDS(BLOT_TRANSFORM_BATCH)];
+
+	for (size_t first=seg->begin; first<seg->end; first+=BLOT_TRANSFORM_BATCH) {
+		unsigned count = min_t(size_t, BLOT_TRANSFORM_BATCH, seg->end - first);
+		size_t nvisible;
+
+		bool ok = blot_transform_points(&tr, lay->data_type, lay->xs, lay->ys,
+						first, count, cols, rows, visible,
+						&nvisible, error);
+		RETURN_IF(!ok, false);
+
+		if (!nvisible)
+			continue;
+
+		for (unsigned wi=0; wi<BLOT_TRANSFORM_MASK_WORDS(count); wi++) {
+			for (guint64 bits=visible[wi]; bits; bits &= bits-1) {
+				unsigned i = wi*64 + __builtin_ctzll(bits);
+				blot_canvas_draw_point(r->can, cols[i], rows[i]);
+			}
+		}
 	}
+
 	return true;
 }
 
-static bool blot_layer_line(blot_layer *lay, const blot_xy_limits *lim,
-		      blot_canvas *can, GError **error)
+/* line */
+
+static inline bool blot_layer_line_begin(blot_layer_raster *r, blot_layer *lay,
+					 const blot_xy_limits *lim, blot_canvas *can,
+					 blot_layer_summary *sum, GError **error)
 {
 	double x_range = lim->x_max - lim->x_min;
 	double y_range = lim->y_max - lim->y_min;
 
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
+	bool ok = blot_layer_raster_init(r, lay, lim, can, sum, x_range, y_range, error);
+	RETURN_IF(!ok, false);
+
+	r->x_scale = (double)(can->dim.cols-1) / x_range;
+	r->y_scale = (double)(can->dim.rows-1) / y_range;
 
-	double per_col = (double)(can->dim.cols-1) / x_range;
-	double per_row = (double)(can->dim.rows-1) / y_range;
+	/* only worth it if there are more points than columns */
+	bool decimate = !(can->flags & BLOT_RENDER_NO_DECIMATION)
+		&& lay->count > can->dim.cols;
 
-	bool visible = false;
-	double px=0, py=0;
+	blot_line_decimator_init(&r->dec, can, decimate);
+	return true;
+}
 
-	for (int di=0; di<lay->count; di++) {
-		// read the location
-		double rx, ry;
+static inline void blot_layer_line_point(blot_layer_raster *r, double rx, double ry,
+					 unsigned di)
+{
+	blot_layer_summary_update(r->sum, rx, ry);
 
-		gboolean ok = blot_layer_get_x_y(lay, di, &rx, &ry, error);
-		if (unlikely (!ok))
-			return false;
+	// compute location
+	double dx = (double)(rx - r->lim->x_min) * r->x_scale;
+	double dy = (double)(ry - r->lim->y_min) * r->y_scale;
 
-		blot_layer_summary_update(&lay->summary, rx, ry);
+	// plot it
+	blot_line_push(&r->dec, round(dx), round(dy), di);
+}
 
-		// compute location
-		double dx = (double)(rx - lim->x_min) * per_col;
-		double dy = (double)(ry - lim->y_min) * per_row;
+/* the point before the range, it starts the first segment, but it
+ * belongs to (and is summarized by) the range before this one */
+static inline void blot_layer_line_lead(blot_layer_raster *r, double rx, double ry,
+					unsigned di)
+{
+	double dx = (double)(rx - r->lim->x_min) * r->x_scale;
+	double dy = (double)(ry - r->lim->y_min) * r->y_scale;
 
-		// plot it
-		if (likely (visible)) {
-			blot_canvas_draw_line(can, round(px), round(py), round(dx), round(dy));
-		}
+	blot_line_push(&r->dec, round(dx), round(dy), di);
+}
 
-		// remember current point for next line
-		px = dx;
-		py = dy;
-		visible = true;
-	}
-	return true;
+static inline void blot_layer_line_end(blot_layer_raster *r)
+{
+	blot_line_flush(&r->dec);
 }
 
-static bool blot_layer_bar(blot_layer *lay, const blot_xy_limits *lim,
-		      blot_canvas *can, GError **error)
+/* bar */
+
+static inline bool blot_layer_bar_begin(blot_layer_raster *r, blot_layer *lay,
+					const blot_xy_limits *lim, blot_canvas *can,
+					blot_layer_summary *sum, GError **error)
 {
 	double x_range = lim->x_max - lim->x_min + 1;
 	double y_range = lim->y_max - lim->y_min + 1;
 
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
-	RETURN_ERRORx(x_range <= 0, false, error, ERANGE, "invalid column limits %f..%f", lim->x_min, lim->x_max);
+	bool ok = blot_layer_raster_init(r, lay, lim, can, sum, x_range, y_range, error);
+	RETURN_IF(!ok, false);
+
+	r->x_scale = can->dim.cols / x_range;
+	r->y_scale = can->dim.rows / y_range;
 
 	/* bar graphs are plotted as rectangles of this width */
+	r->bar_width = (double)(0.5) * r->x_scale;
+	return true;
+}
 
-	double wx = (double)(0.5) * can->dim.cols / x_range;
+static inline void blot_layer_bar_point(blot_layer_raster *r, double rx, double ry,
+					unsigned di)
+{
+	blot_layer_summary_update(r->sum, rx, ry);
 
-	for (int di=0; di<lay->count; di++) {
-		// read the location
-		double rx, ry;
+	// compute location
+	double dx = (double)(rx - r->lim->x_min) * r->x_scale;
+	double dy = (double)(ry - r->lim->y_min) * r->y_scale;
 
-		gboolean ok = blot_layer_get_x_y(lay, di, &rx, &ry, error);
-		if (unlikely (!ok))
-			return false;
+	// plot it
+	blot_canvas_fill_rect(r->can, round(dx), 0, round(dx + r->bar_width), round(dy));
+}
 
-		blot_layer_summary_update(&lay->summary, rx, ry);
+static inline void blot_layer_bar_lead(blot_layer_raster *r, double rx, double ry,
+				       unsigned di)
+{
+}
+
+static inline void blot_layer_bar_end(blot_layer_raster *r)
+{
+}
+
+/* the same X scale as the begin steps above use */
+double blot_layer_x_scale(const blot_layer *lay, const blot_xy_limits *lim, unsigned cols)
+{
+	if (lay->plot_type == BLOT_LINE)
+		return (double)(cols-1) / (lim->x_max - lim->x_min);
+
+	return cols / (lim->x_max - lim->x_min + 1);
+}
+
+/* generic handlers, these work for any data type */
+
+#define BLOT_LAYER_GENERIC(PLOT) \
+static bool blot_layer_##PLOT(blot_layer *lay, const blot_xy_limits *lim, \
+			      blot_canvas *can, blot_layer_summary *sum, \
+			      size_t begin, size_t end, GError **error) \
+{ \
+	blot_layer_raster r; \
+	bool ok = blot_layer_##PLOT##_begin(&r, lay, lim, can, sum, error); \
+	RETURN_IF(!ok, false); \
+	if (begin) { \
+		double rx, ry; \
+		ok = blot_layer_get_x_y(lay, begin-1, &rx, &ry, error); \
+		RETURN_IF(!ok, false); \
+		blot_layer_##PLOT##_lead(&r, rx, ry, begin-1); \
+	} \
+	for (unsigned di=begin; di<end; di++) { \
+		double rx, ry; \
+		ok = blot_layer_get_x_y(lay, di, &rx, &ry, error); \
+		RETURN_IF(!ok, false); \
+		blot_layer_##PLOT##_point(&r, rx, ry, di); \
+	} \
+	blot_layer_##PLOT##_end(&r); \
+	return true; \
+}
+
+BLOT_LAYER_GENERIC(scatter)
+BLOT_LAYER_GENERIC(line)
+BLOT_LAYER_GENERIC(bar)
+
+/* typed kernels, one per plot type and X/Y data type pair */
+
+#define BLOT_LAYER_Y_TYPES(_, XN, XT) \
+	_(XN, XT, INT16,  gint16) \
+	_(XN, XT, INT32,  gint32) \
+	_(XN, XT, INT64,  gint64) \
+	_(XN, XT, FLOAT,  float) \
+	_(XN, XT, DOUBLE, double)
+
+#define BLOT_LAYER_X_Y_TYPES(_) \
+	BLOT_LAYER_Y_TYPES(_, INT16,  gint16) \
+	BLOT_LAYER_Y_TYPES(_, INT32,  gint32) \
+	BLOT_LAYER_Y_TYPES(_, INT64,  gint64) \
+	BLOT_LAYER_Y_TYPES(_, FLOAT,  float) \
+	BLOT_LAYER_Y_TYPES(_, DOUBLE, double)
+
+#define BLOT_LAYER_KERNEL(PLOT, XN, XT, YN, YT) \
+static bool blot_layer_##PLOT##_##XN##_##YN(blot_layer *lay, const blot_xy_limits *lim, \
+					    blot_canvas *can, blot_layer_summary *sum, \
+					    size_t begin, size_t end, GError **error) \
+{ \
+	blot_layer_raster r; \
+	bool ok = blot_layer_##PLOT##_begin(&r, lay, lim, can, sum, error); \
+	RETURN_IF(!ok, false); \
+	const XT *xs = lay->xs; \
+	const YT *ys = lay->ys; \
+	if (begin) { \
+		size_t pi = blot_layer_pos(lay, begin-1); \
+		blot_layer_##PLOT##_lead(&r, xs ? xs[pi] : begin-1, ys[pi], begin-1); \
+	} \
+	blot_layer_segment segs[2]; \
+	unsigned nsegs = blot_layer_segments(lay, begin, end, segs); \
+	for (unsigned si=0; si<nsegs; si++) { \
+		size_t pi = segs[si].begin, pe = segs[si].end; \
+		unsigned di = segs[si].index; \
+		if (xs) { \
+			for (; pi<pe; pi++, di++) \
+				blot_layer_##PLOT##_point(&r, xs[pi], ys[pi], di); \
+		} else { \
+			/* X data can be NULL, that means we are plotting the index as X */ \
+			for (; pi<pe; pi++, di++) \
+				blot_layer_##PLOT##_point(&r, di, ys[pi], di); \
+		} \
+	} \
+	blot_layer_##PLOT##_end(&r); \
+	return true; \
+}
+
+#define BLOT_LAYER_SCATTER_KERNEL(XN, XT, YN, YT) \
+static bool blot_layer_scatter_##XN##_##YN(blot_layer *lay, const blot_xy_limits *lim, \
+					   blot_canvas *can, blot_layer_summary *sum, \
+					   size_t begin, size_t end, GError **error) \
+{ \
+	blot_layer_raster r; \
+	bool ok = blot_layer_scatter_begin(&r, lay, lim, can, sum, error); \
+	RETURN_IF(!ok, false); \
+	blot_layer_segment segs[2]; \
+	unsigned nsegs = blot_layer_segments(lay, begin, end, segs); \
+	for (unsigned si=0; si<nsegs; si++) { \
+		if (unlikely (sum->enabled)) { \
+			/* the summary includes points that are not visible */ \
+			const XT *xs = lay->xs; \
+			const YT *ys = lay->ys; \
+			unsigned di = segs[si].index; \
+			for (size_t pi=segs[si].begin; pi<segs[si].end; pi++, di++) \
+				blot_layer_summary_update(sum, xs ? xs[pi] : di, ys[pi]); \
+		} \
+		ok = blot_layer_scatter_batched(&r, &segs[si], error); \
+		RETURN_IF(!ok, false); \
+	} \
+	return true; \
+}
+
+#define BLOT_LAYER_KERNELS(XN, XT, YN, YT) \
+	BLOT_LAYER_SCATTER_KERNEL(XN, XT, YN, YT) \
+	BLOT_LAYER_KERNEL(line,    XN, XT, YN, YT) \
+	BLOT_LAYER_KERNEL(bar,     XN, XT, YN, YT)
+
+BLOT_LAYER_X_Y_TYPES(BLOT_LAYER_KERNELS)
+
+#define BLOT_LAYER_SCATTER_FN(XN, XT, YN, YT) [BLOT_DATA_(XN,YN)] = blot_layer_scatter_##XN##_##YN,
+#define BLOT_LAYER_LINE_FN(XN, XT, YN, YT)    [BLOT_DATA_(XN,YN)] = blot_layer_line_##XN##_##YN,
+#define BLOT_LAYER_BAR_FN(XN, XT, YN, YT)     [BLOT_DATA_(XN,YN)] = blot_layer_bar_##XN##_##YN,
+
+typedef bool (*layer_to_canvas_fn)(blot_layer *lay, const blot_xy_limits *lim,
+				   blot_canvas *can, blot_layer_summary *sum,
+				   size_t begin, size_t end, GError **);
+static layer_to_canvas_fn blot_layer_to_canvas_type_fns[BLOT_PLOT_TYPE_MAX][BLOT_DATA_TYPE_MAX] = {
+	[BLOT_SCATTER] = { BLOT_LAYER_X_Y_TYPES(BLOT_LAYER_SCATTER_FN) },
+	[BLOT_LINE]    = { BLOT_LAYER_X_Y_TYPES(BLOT_LAYER_LINE_FN) },
+	[BLOT_BAR]     = { BLOT_LAYER_X_Y_TYPES(BLOT_LAYER_BAR_FN) },
+};
+static layer_to_canvas_fn blot_layer_to_canvas_fns[BLOT_PLOT_TYPE_MAX] = {
+	[BLOT_SCATTER]   = blot_layer_scatter,
+	[BLOT_LINE]      = blot_layer_line,
+	[BLOT_BAR]       = blot_layer_bar,
+};
 
-		// compute location
-		double dx = (double)(rx - lim->x_min) * can->dim.cols / x_range;
-		double dy = (double)(ry - lim->y_min) * can->dim.rows / y_range;
+/* multi-threaded
+ *
+ * Every chunk of the layer is drawn into its own canvas, except for the first
+ * one that draws into the canvas being returned, and the others are OR-ed into
+ * it once they are all done.  Since every handler draws exactly the pixels of
+ * its own range (and the segment leading into it), the result is the same as
+ * drawing the whole layer on one thread. */
 
-		// plot it
-		blot_canvas_fill_rect(can, round(dx), 0, round(dx+wx), round(dy));
+typedef struct blot_layer_job {
+	layer_to_canvas_fn fn;
+	blot_layer *lay;
+	const blot_xy_limits *lim;
+	const blot_dimensions *dim;
+	size_t begin;                   // of the first chunk
+	blot_canvas **cans;             // one per chunk, [0] is the result
+	blot_layer_summary *sums;       // one per chunk
+	GError **errors;                // one per chunk
+} blot_layer_job;
+
+static void blot_layer_chunk(void *data, unsigned chunk, size_t begin, size_t end)
+{
+	blot_layer_job *job = data;
+	blot_canvas *can = job->cans[0];
+
+	if (chunk) {
+		/* these are merged into an indexed canvas as drawn by this layer */
+		blot_render_flags flags = can->flags & ~BLOT_RENDER_INDEXED;
+		can = blot_canvas_new(job->dim->cols, job->dim->rows, flags, can->color,
+				      &job->errors[chunk]);
+		if (!can)
+			return;
+		job->cans[chunk] = can;
 	}
 
+	job->fn(job->lay, job->lim, can, &job->sums[chunk], job->begin + begin, job->begin + end,
+		&job->errors[chunk]);
+}
+
+static bool blot_layer_render_parallel(blot_layer *lay, const blot_xy_limits *lim,
+				       const blot_dimensions *dim, blot_canvas *can,
+				       layer_to_canvas_fn fn, size_t begin, GError **error)
+{
+	/* one chunk per thread, so one private canvas per thread */
+	size_t count = lay->count - begin;
+	size_t grain = max_t(size_t, BLOT_LAYER_PARALLEL_GRAIN,
+			     (count + blot_parallel_threads() - 1) / blot_parallel_threads());
+	unsigned chunks = blot_parallel_chunks(count, grain);
+
+	blot_autofree blot_canvas **cans = blot_new0(blot_canvas*, chunks);
+	blot_autofree blot_layer_summary *sums = blot_new(blot_layer_summary, chunks);
+	blot_autofree GError **errors = blot_new0(GError*, chunks);
+	RETURN_ERROR(!cans || !sums || !errors, false, error, "new blot_layer_job x %u", chunks);
+
+	/* the summary of each chunk starts out empty, and is added to the layer's */
+	cans[0] = can;
+	for (unsigned ci=0; ci<chunks; ci++)
+		blot_layer_summary_init(&sums[ci], can->flags);
+
+	blot_layer_job job = {
+		.fn = fn, .lay = lay, .lim = lim, .dim = dim, .begin = begin,
+		.cans = cans, .sums = sums, .errors = errors,
+	};
+
+	bool ok = blot_parallel_for(count, grain, blot_layer_chunk, &job, error);
+
+	/* merge in chunk order, and report the error of the lowest failing chunk */
+	for (unsigned ci=0; ci<chunks; ci++) {
+		if (ok && errors[ci]) {
+			g_propagate_error(error, g_steal_pointer(&errors[ci]));
+			ok = false;
+		}
+		if (ok && ci)
+			ok = blot_canvas_merge(can, cans[ci], error);
+		if (ok)
+			blot_layer_summary_merge(&lay->summary, &sums[ci]);
+
+		g_clear_error(&errors[ci]);
+		if (ci)
+			blot_canvas_delete(cans[ci]);
+	}
+
+	return ok;
+}
+
+/* draws the points [begin,count) into can, and adds them to lay->summary */
+static bool blot_layer_render_range(blot_layer *lay,
+				    const blot_xy_limits *lim,
+				    const blot_dimensions *dim,
+				    blot_canvas *can,
+				    size_t begin,
+				    GError **error)
+{
+	layer_to_canvas_fn fn;
+	/* try to find function specialized for this type */
+	fn = blot_layer_to_canvas_type_fns[lay->plot_type][lay->data_type];
+	if (!fn)
+		/* otherwise use the generic function, that will be a bit slower */
+		fn = blot_layer_to_canvas_fns[lay->plot_type];
+
+	RETURN_ERRORx(!fn, false, error, EINVAL,
+		      "no handler for plot_type=%u", lay->plot_type);
+
+	bool ok;
+	if (lay->count - begin < BLOT_LAYER_PARALLEL_MIN || blot_parallel_threads() < 2)
+		ok = fn(lay, lim, can, &lay->summary, begin, lay->count, error);
+	else
+		ok = blot_layer_render_parallel(lay, lim, dim, can, fn, begin, error);
+	RETURN_IF(!ok, false);
+
+	RETURN_ERROR(!blot_canvas_complete(can), false, error, "new blot_canvas tile");
 	return true;
 }
+
+bool blot_layer_render_into(blot_layer *lay,
+			    const blot_xy_limits *lim,
+			    const blot_dimensions *dim,
+			    blot_canvas *can,
+			    GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+	RETURN_EFAULT_IF(can==NULL, false, error);
+	RETURN_EINVAL_IF(lay->plot_type>=BLOT_PLOT_TYPE_MAX, false, error);
+	RETURN_EINVAL_IF(lay->data_type>=BLOT_DATA_TYPE_MAX, false, error);
+
+	blot_layer_summary_init(&lay->summary, can->flags);
+
+	return blot_layer_render_range(lay, lim, dim, can, 0, error);
+}
+
+bool blot_layer_render_append(blot_layer *lay,
+			      const blot_xy_limits *lim,
+			      const blot_dimensions *dim,
+			      blot_canvas *can,
+			      size_t begin,
+			      GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, false, error);
+	RETURN_EFAULT_IF(can==NULL, false, error);
+	RETURN_EINVAL_IF(lay->plot_type>=BLOT_PLOT_TYPE_MAX, false, error);
+	RETURN_EINVAL_IF(lay->data_type>=BLOT_DATA_TYPE_MAX, false, error);
+	RETURN_ERRORx(begin > lay->count, false, error, ERANGE,
+		      "begin %zu is past the last point %zu", begin, lay->count);
+
+	return blot_layer_render_range(lay, lim, dim, can, begin, error);
+}
+
+struct blot_canvas * blot_layer_render(blot_layer *lay,
+				       const blot_xy_limits *lim,
+				       const blot_dimensions *dim,
+				       blot_render_flags flags,
+				       GError **error)
+{
+	RETURN_EFAULT_IF(lay==NULL, NULL, error);
+	RETURN_EINVAL_IF(lay->plot_type>=BLOT_PLOT_TYPE_MAX, NULL, error);
+	RETURN_EINVAL_IF(lay->data_type>=BLOT_DATA_TYPE_MAX, NULL, error);
+
+	blot_canvas *can = blot_canvas_new(dim->cols, dim->rows, flags, lay->color, error);
+	RETURN_IF(!can, NULL);
+
+	if (!blot_layer_render_into(lay, lim, dim, can, error)) {
+		blot_canvas_delete(can);
+		return NULL;
+	}
+
+	return can;
+}
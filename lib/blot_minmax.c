@@ -0,0 +1,318 @@
+/* blot: vectorized min/max reduction over typed data arrays */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <math.h>
+#include "blot_minmax.h"
+#include "blot_alloc.h"
+#include "blot_parallel.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOT_MINMAX_X86 1
+#endif
+
+/* every kernel folds data[0..count) into the running minimum and maximum,
+ * which start out at the largest/smallest value of the type */
+typedef void (*blot_minmax_fn)(const void *data, size_t count, void *pmin, void *pmax);
+
+/* scalar */
+
+#define BLOT_MINMAX_SCALAR(NAME, T) \
+static void blot_minmax_scalar_##NAME(const void *data, size_t count, void *pmin, void *pmax) \
+{ \
+	const T *p = data; \
+	T mn = *(T*)pmin, mx = *(T*)pmax; \
+	for (size_t i=0; i<count; i++) { \
+		/* written so that NaN never replaces a value */ \
+		if (p[i] < mn) mn = p[i]; \
+		if (p[i] > mx) mx = p[i]; \
+	} \
+	*(T*)pmin = mn; \
+	*(T*)pmax = mx; \
+}
+
+BLOT_MINMAX_SCALAR(int16,  gint16)
+BLOT_MINMAX_SCALAR(int32,  gint32)
+BLOT_MINMAX_SCALAR(int64,  gint64)
+BLOT_MINMAX_SCALAR(float,  float)
+BLOT_MINMAX_SCALAR(double, double)
+
+#ifdef BLOT_MINMAX_X86
+
+/* Each vector kernel keeps two min/max accumulator pairs to hide latency,
+ * reduces them horizontally through memory at the end, and hands the tail
+ * to the scalar kernel.  The vector min/max instructions return their second
+ * operand if either one is NaN, so the accumulator always goes second. */
+
+#define BLOT_MINMAX_VECTOR(ISA, TARGET, NAME, T, VT, LANES, LOAD, SET1, VMIN, VMAX, STORE) \
+__attribute__((target(TARGET))) \
+static void blot_minmax_##ISA##_##NAME(const void *data, size_t count, void *pmin, void *pmax) \
+{ \
+	const T *p = data; \
+	size_t i = 0; \
+	if (count >= 2*LANES) { \
+		VT mn0 = SET1(*(T*)pmin), mn1 = mn0; \
+		VT mx0 = SET1(*(T*)pmax), mx1 = mx0; \
+		for (; i + 2*LANES <= count; i += 2*LANES) { \
+			VT v0 = LOAD((const void*)(p + i)); \
+			VT v1 = LOAD((const void*)(p + i + LANES)); \
+			mn0 = VMIN(v0, mn0); mx0 = VMAX(v0, mx0); \
+			mn1 = VMIN(v1, mn1); mx1 = VMAX(v1, mx1); \
+		} \
+		T lanes[2][LANES] __aligned64; \
+		STORE((void*)lanes[0], VMIN(mn0, mn1)); \
+		STORE((void*)lanes[1], VMAX(mx0, mx1)); \
+		blot_minmax_scalar_##NAME(lanes[0], LANES, pmin, pmax); \
+		blot_minmax_scalar_##NAME(lanes[1], LANES, pmin, pmax); \
+	} \
+	blot_minmax_scalar_##NAME(p + i, count - i, pmin, pmax); \
+}
+
+/* SSE2 has no 32-bit or 64-bit integer min/max */
+
+__attribute__((target("sse2")))
+static inline __m128i blot_sse2_min_epi32(__m128i a, __m128i b)
+{
+	__m128i gt = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i blot_sse2_max_epi32(__m128i a, __m128i b)
+{
+	__m128i gt = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+#define BLOT_SSE2_LOADU(p)   _mm_loadu_si128((const __m128i*)(p))
+#define BLOT_SSE2_STORE(p,v) _mm_store_si128((__m128i*)(p), v)
+
+BLOT_MINMAX_VECTOR(sse2, "sse2", int16,  gint16, __m128i, 8, BLOT_SSE2_LOADU, _mm_set1_epi16,
+		   _mm_min_epi16, _mm_max_epi16, BLOT_SSE2_STORE)
+BLOT_MINMAX_VECTOR(sse2, "sse2", int32,  gint32, __m128i, 4, BLOT_SSE2_LOADU, _mm_set1_epi32,
+		   blot_sse2_min_epi32, blot_sse2_max_epi32, BLOT_SSE2_STORE)
+BLOT_MINMAX_VECTOR(sse2, "sse2", float,  float,  __m128,  4, _mm_loadu_ps, _mm_set1_ps,
+		   _mm_min_ps, _mm_max_ps, _mm_store_ps)
+BLOT_MINMAX_VECTOR(sse2, "sse2", double, double, __m128d, 2, _mm_loadu_pd, _mm_set1_pd,
+		   _mm_min_pd, _mm_max_pd, _mm_store_pd)
+
+/* AVX2 has no 64-bit integer min/max, but it can compare and blend */
+
+__attribute__((target("avx2")))
+static inline __m256i blot_avx2_min_epi64(__m256i a, __m256i b)
+{
+	return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blot_avx2_max_epi64(__m256i a, __m256i b)
+{
+	return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+#define BLOT_AVX2_LOADU(p)   _mm256_loadu_si256((const __m256i*)(p))
+#define BLOT_AVX2_STORE(p,v) _mm256_store_si256((__m256i*)(p), v)
+
+BLOT_MINMAX_VECTOR(avx2, "avx2", int16,  gint16, __m256i, 16, BLOT_AVX2_LOADU, _mm256_set1_epi16,
+		   _mm256_min_epi16, _mm256_max_epi16, BLOT_AVX2_STORE)
+BLOT_MINMAX_VECTOR(avx2, "avx2", int32,  gint32, __m256i, 8, BLOT_AVX2_LOADU, _mm256_set1_epi32,
+		   _mm256_min_epi32, _mm256_max_epi32, BLOT_AVX2_STORE)
+BLOT_MINMAX_VECTOR(avx2, "avx2", int64,  gint64, __m256i, 4, BLOT_AVX2_LOADU, _mm256_set1_epi64x,
+		   blot_avx2_min_epi64, blot_avx2_max_epi64, BLOT_AVX2_STORE)
+BLOT_MINMAX_VECTOR(avx2, "avx2", float,  float,  __m256,  8, _mm256_loadu_ps, _mm256_set1_ps,
+		   _mm256_min_ps, _mm256_max_ps, _mm256_store_ps)
+BLOT_MINMAX_VECTOR(avx2, "avx2", double, double, __m256d, 4, _mm256_loadu_pd, _mm256_set1_pd,
+		   _mm256_min_pd, _mm256_max_pd, _mm256_store_pd)
+
+/* AVX-512 */
+
+#define BLOT_AVX512_LOADU(p)   _mm512_loadu_si512(p)
+#define BLOT_AVX512_STORE(p,v) _mm512_store_si512(p, v)
+
+BLOT_MINMAX_VECTOR(avx512, "avx512f,avx512bw", int16,  gint16, __m512i, 32, BLOT_AVX512_LOADU, _mm512_set1_epi16,
+		   _mm512_min_epi16, _mm512_max_epi16, BLOT_AVX512_STORE)
+BLOT_MINMAX_VECTOR(avx512, "avx512f,avx512bw", int32,  gint32, __m512i, 16, BLOT_AVX512_LOADU, _mm512_set1_epi32,
+		   _mm512_min_epi32, _mm512_max_epi32, BLOT_AVX512_STORE)
+BLOT_MINMAX_VECTOR(avx512, "avx512f,avx512bw", int64,  gint64, __m512i, 8, BLOT_AVX512_LOADU, _mm512_set1_epi64,
+		   _mm512_min_epi64, _mm512_max_epi64, BLOT_AVX512_STORE)
+BLOT_MINMAX_VECTOR(avx512, "avx512f,avx512bw", float,  float,  __m512,  16, _mm512_loadu_ps, _mm512_set1_ps,
+		   _mm512_min_ps, _mm512_max_ps, _mm512_store_ps)
+BLOT_MINMAX_VECTOR(avx512, "avx512f,avx512bw", double, double, __m512d, 8, _mm512_loadu_pd, _mm512_set1_pd,
+		   _mm512_min_pd, _mm512_max_pd, _mm512_store_pd)
+
+#endif // BLOT_MINMAX_X86
+
+/* dispatch */
+
+#define BLOT_MINMAX_TYPE_MAX (BLOT_DATA_X_DOUBLE+1)
+
+static const blot_minmax_fn blot_minmax_fns[BLOT_SIMD_LEVEL_MAX][BLOT_MINMAX_TYPE_MAX] = {
+	[BLOT_SIMD_NONE] = {
+		[BLOT_DATA_X_INT16]  = blot_minmax_scalar_int16,
+		[BLOT_DATA_X_INT32]  = blot_minmax_scalar_int32,
+		[BLOT_DATA_X_INT64]  = blot_minmax_scalar_int64,
+		[BLOT_DATA_X_FLOAT]  = blot_minmax_scalar_float,
+		[BLOT_DATA_X_DOUBLE] = blot_minmax_scalar_double,
+	},
+#ifdef BLOT_MINMAX_X86
+	[BLOT_SIMD_SSE2] = {
+		[BLOT_DATA_X_INT16]  = blot_minmax_sse2_int16,
+		[BLOT_DATA_X_INT32]  = blot_minmax_sse2_int32,
+		[BLOT_DATA_X_INT64]  = blot_minmax_scalar_int64,
+		[BLOT_DATA_X_FLOAT]  = blot_minmax_sse2_float,
+		[BLOT_DATA_X_DOUBLE] = blot_minmax_sse2_double,
+	},
+	[BLOT_SIMD_AVX2] = {
+		[BLOT_DATA_X_INT16]  = blot_minmax_avx2_int16,
+		[BLOT_DATA_X_INT32]  = blot_minmax_avx2_int32,
+		[BLOT_DATA_X_INT64]  = blot_minmax_avx2_int64,
+		[BLOT_DATA_X_FLOAT]  = blot_minmax_avx2_float,
+		[BLOT_DATA_X_DOUBLE] = blot_minmax_avx2_double,
+	},
+	[BLOT_SIMD_AVX512] = {
+		[BLOT_DATA_X_INT16]  = blot_minmax_avx512_int16,
+		[BLOT_DATA_X_INT32]  = blot_minmax_avx512_int32,
+		[BLOT_DATA_X_INT64]  = blot_minmax_avx512_int64,
+		[BLOT_DATA_X_FLOAT]  = blot_minmax_avx512_float,
+		[BLOT_DATA_X_DOUBLE] = blot_minmax_avx512_double,
+	},
+#endif
+};
+
+/* running min/max, large enough for any of the element types */
+typedef union blot_minmax_val {
+	gint16 i16;
+	gint32 i32;
+	gint64 i64;
+	float flt;
+	double dbl;
+} blot_minmax_val;
+
+typedef struct blot_minmax_acc {
+	blot_minmax_val min, max;
+} blot_minmax_acc;
+
+static void blot_minmax_acc_init(blot_minmax_acc *acc, blot_data_type elem_type)
+{
+	switch (elem_type) {
+	case BLOT_DATA_X_INT16:
+		acc->min.i16 = G_MAXINT16; acc->max.i16 = G_MININT16;
+		break;
+	case BLOT_DATA_X_INT32:
+		acc->min.i32 = G_MAXINT32; acc->max.i32 = G_MININT32;
+		break;
+	case BLOT_DATA_X_INT64:
+		acc->min.i64 = G_MAXINT64; acc->max.i64 = G_MININT64;
+		break;
+	case BLOT_DATA_X_FLOAT:
+		acc->min.flt = INFINITY; acc->max.flt = -INFINITY;
+		break;
+	default:
+		acc->min.dbl = INFINITY; acc->max.dbl = -INFINITY;
+		break;
+	}
+}
+
+static double blot_minmax_val_to_double(const blot_minmax_val *val, blot_data_type elem_type)
+{
+	switch (elem_type) {
+	case BLOT_DATA_X_INT16: return val->i16;
+	case BLOT_DATA_X_INT32: return val->i32;
+	case BLOT_DATA_X_INT64: return val->i64;
+	case BLOT_DATA_X_FLOAT: return val->flt;
+	default:                return val->dbl;
+	}
+}
+
+static bool blot_minmax_finish(const blot_minmax_acc *acc, blot_data_type elem_type,
+			       double *min, double *max)
+{
+	*min = blot_minmax_val_to_double(&acc->min, elem_type);
+	*max = blot_minmax_val_to_double(&acc->max, elem_type);
+	return true;
+}
+
+bool blot_minmax_simd(blot_simd_level level, blot_data_type elem_type,
+		      const void *data, size_t count,
+		      double *min, double *max, GError **error)
+{
+	RETURN_EFAULT_IF(data==NULL, false, error);
+	RETURN_EINVAL_IF(level>=BLOT_SIMD_LEVEL_MAX, false, error);
+	RETURN_ERRORx(elem_type>=BLOT_MINMAX_TYPE_MAX, false, error, EINVAL,
+		      "unexpected element type %02x", elem_type);
+
+	/* never use instructions the CPU does not have */
+	level = min_t(unsigned, level, blot_cpu_simd_level());
+
+	/* fall back to the best thing we have */
+	while (level && !blot_minmax_fns[level][elem_type])
+		level --;
+
+	blot_minmax_acc acc;
+	blot_minmax_acc_init(&acc, elem_type);
+	blot_minmax_fns[level][elem_type](data, count, &acc.min, &acc.max);
+
+	return blot_minmax_finish(&acc, elem_type, min, max);
+}
+
+/* multi-threaded */
+
+typedef struct blot_minmax_job {
+	blot_minmax_fn fn;
+	const guint8 *data;
+	size_t elem_size;
+	blot_minmax_acc *accs;          // one per chunk
+} blot_minmax_job;
+
+static void blot_minmax_chunk(void *data, unsigned chunk, size_t begin, size_t end)
+{
+	blot_minmax_job *job = data;
+	blot_minmax_acc *acc = job->accs + chunk;
+
+	job->fn(job->data + begin * job->elem_size, end - begin, &acc->min, &acc->max);
+}
+
+bool blot_minmax(blot_data_type elem_type, const void *data, size_t count,
+		 double *min, double *max, GError **error)
+{
+	blot_simd_level level = blot_cpu_simd_level();
+
+	if (count < BLOT_MINMAX_PARALLEL_MIN || blot_parallel_threads() < 2)
+		return blot_minmax_simd(level, elem_type, data, count, min, max, error);
+
+	RETURN_EFAULT_IF(data==NULL, false, error);
+	RETURN_ERRORx(elem_type>=BLOT_MINMAX_TYPE_MAX, false, error, EINVAL,
+		      "unexpected element type %02x", elem_type);
+
+	while (level && !blot_minmax_fns[level][elem_type])
+		level --;
+
+	unsigned chunks = blot_parallel_chunks(count, BLOT_MINMAX_PARALLEL_GRAIN);
+	blot_autofree blot_minmax_acc *accs = blot_new(blot_minmax_acc, chunks);
+	RETURN_ERROR(!accs, false, error, "new blot_minmax_acc x %u", chunks);
+
+	for (unsigned ci=0; ci<chunks; ci++)
+		blot_minmax_acc_init(accs + ci, elem_type);
+
+	blot_minmax_job job = {
+		.fn = blot_minmax_fns[level][elem_type],
+		.data = data,
+		.elem_size = blot_data_elem_size(elem_type),
+		.accs = accs,
+	};
+
+	bool ok = blot_parallel_for(count, BLOT_MINMAX_PARALLEL_GRAIN,
+				    blot_minmax_chunk, &job, error);
+	RETURN_IF(!ok, false);
+
+	/* merge the per-chunk results */
+	blot_minmax_acc acc;
+	blot_minmax_acc_init(&acc, elem_type);
+	for (unsigned ci=0; ci<chunks; ci++) {
+		job.fn(&accs[ci].min, 1, &acc.min, &acc.max);
+		job.fn(&accs[ci].max, 1, &acc.min, &acc.max);
+	}
+
+	return blot_minmax_finish(&acc, elem_type, min, max);
+}
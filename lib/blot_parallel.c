@@ -0,0 +1,161 @@
+/* blot: internal worker threads for splitting up work */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include "blot_parallel.h"
+#include "blot_alloc.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+/* a job is shared by the caller and any worker threads that pick it up;
+ * chunks are claimed with an atomic counter, so a worker that starts late
+ * finds nothing left to do and just drops its reference */
+typedef struct blot_parallel_job {
+	blot_parallel_fn fn;
+	void *data;
+	size_t count, grain;
+	guint chunks;
+
+	guint next;                     // next chunk to claim
+	guint done;                     // chunks completed
+	gint refs;
+
+	blot_mem_stats *mem_scope;      // of the caller, workers count allocations there too
+
+	GMutex lock;
+	GCond cond;
+} blot_parallel_job;
+
+static GMutex blot_parallel_pool_lock;
+static GThreadPool *blot_parallel_pool;
+static unsigned blot_parallel_thread_count;
+
+unsigned blot_parallel_threads(void)
+{
+	unsigned count = __atomic_load_n(&blot_parallel_thread_count, __ATOMIC_RELAXED);
+
+	if (unlikely (!count)) {
+		count = blot_env_to_uint("BLOT_THREADS", g_get_num_processors());
+		count = clamp_t(unsigned, count, 1, BLOT_PARALLEL_MAX_THREADS);
+		__atomic_store_n(&blot_parallel_thread_count, count, __ATOMIC_RELAXED);
+	}
+
+	return count;
+}
+
+static void blot_parallel_job_unref(blot_parallel_job *job)
+{
+	if (!g_atomic_int_dec_and_test(&job->refs))
+		return;
+
+	g_mutex_clear(&job->lock);
+	g_cond_clear(&job->cond);
+	blot_free(job);
+}
+
+static void blot_parallel_job_run(blot_parallel_job *job)
+{
+	for (;;) {
+		guint ci = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+		if (ci >= job->chunks)
+			break;
+
+		size_t begin = (size_t)ci * job->grain;
+		size_t end = min_t(size_t, begin + job->grain, job->count);
+
+		job->fn(job->data, ci, begin, end);
+
+		if (__atomic_add_fetch(&job->done, 1, __ATOMIC_ACQ_REL) == job->chunks) {
+			g_mutex_lock(&job->lock);
+			g_cond_broadcast(&job->cond);
+			g_mutex_unlock(&job->lock);
+		}
+	}
+}
+
+static void blot_parallel_worker(gpointer task, gpointer user_data)
+{
+	blot_parallel_job *job = task;
+
+	/* pairs with the reference taken before the push, so the job is seen
+	 * to be published even by tools that cannot look inside the pool */
+	(void)__atomic_load_n(&job->refs, __ATOMIC_ACQUIRE);
+
+	/* the caller's scope may be gone once all the chunks are done, so
+	 * dropping the reference is not counted there */
+	blot_mem_stats *prev = blot_mem_scope_enter(job->mem_scope);
+	blot_parallel_job_run(job);
+	blot_mem_scope_leave(prev);
+
+	blot_parallel_job_unref(job);
+}
+
+static GThreadPool * blot_parallel_get_pool(GError **error)
+{
+	g_mutex_lock(&blot_parallel_pool_lock);
+
+	if (!blot_parallel_pool) {
+		/* the caller is always one of the threads doing the work */
+		unsigned workers = blot_parallel_threads() - 1;
+		blot_parallel_pool = g_thread_pool_new(blot_parallel_worker, NULL,
+						       workers, FALSE, error);
+	}
+
+	g_mutex_unlock(&blot_parallel_pool_lock);
+	return blot_parallel_pool;
+}
+
+bool blot_parallel_for(size_t count, size_t grain,
+		       blot_parallel_fn fn, void *data, GError **error)
+{
+	RETURN_EFAULT_IF(fn==NULL, false, error);
+	RETURN_EINVAL_IF(grain==0, false, error);
+
+	if (unlikely (!count))
+		return true;
+
+	unsigned chunks = blot_parallel_chunks(count, grain);
+	unsigned threads = min_t(unsigned, chunks, blot_parallel_threads());
+
+	if (threads <= 1) {
+		/* nothing to split, just do it here */
+		for (unsigned ci=0; ci<chunks; ci++) {
+			size_t begin = (size_t)ci * grain;
+			fn(data, ci, begin, min_t(size_t, begin + grain, count));
+		}
+		return true;
+	}
+
+	GThreadPool *pool = blot_parallel_get_pool(error);
+	RETURN_IF(!pool, false);
+
+	blot_parallel_job *job = blot_new0(blot_parallel_job, 1);
+	RETURN_ERROR(!job, false, error, "new blot_parallel_job");
+
+	job->fn = fn;
+	job->data = data;
+	job->count = count;
+	job->grain = grain;
+	job->chunks = chunks;
+	job->refs = 1;
+	job->mem_scope = blot_mem_scope_get();
+	g_mutex_init(&job->lock);
+	g_cond_init(&job->cond);
+
+	for (unsigned ti=1; ti<threads; ti++) {
+		g_atomic_int_inc(&job->refs);
+		if (!g_thread_pool_push(pool, job, NULL)) {
+			/* we will do the work ourselves */
+			g_atomic_int_add(&job->refs, -1);
+			break;
+		}
+	}
+
+	blot_parallel_job_run(job);
+
+	g_mutex_lock(&job->lock);
+	while (__atomic_load_n(&job->done, __ATOMIC_ACQUIRE) < job->chunks)
+		g_cond_wait(&job->cond, &job->lock);
+	g_mutex_unlock(&job->lock);
+
+	blot_parallel_job_unref(job);
+	return true;
+}
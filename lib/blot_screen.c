@@ -2,13 +2,58 @@
 /* vim: set noet sw=8 ts=8 tw=120: */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
 #include <wchar.h>
 #include "blot_screen.h"
+#include "blot_alloc.h"
 #include "blot_error.h"
 #include "blot_canvas.h"
 #include "blot_layer.h"
 #include "blot_color.h"
 #include "blot_axis.h"
+#include "blot_braille.h"
+#include "blot_composite.h"
+
+/* a plotted cell is at most a color change followed by a glyph */
+#define BLOT_SCREEN_CELL_MAX (sizeof(((blot_color_seq*)0)->str) + BLOT_UTF8_MAX)
+
+/* the text of a rendered screen, split into cells; see blot_screen_diff() */
+
+#define BLOT_SCREEN_NO_COLOR -1
+
+typedef struct blot_screen_cell {
+	gunichar wch;
+	gint16 color;                   // 0..255 or BLOT_SCREEN_NO_COLOR
+} blot_screen_cell;
+
+typedef struct blot_screen_line {
+	gsize text, text_len;           // range of bytes in the text, without the newline
+	gsize cell, cell_count;         // range in the cells array
+	gint16 color;                   // color in effect at the start of the line
+	bool raw;                       // only compared as text
+} blot_screen_line;
+
+struct blot_screen_grid {
+	bool valid;                     // matches the text of the last render
+	gsize text;                     // first byte of the text, after any screen clear
+	blot_screen_cell *cells;
+	gsize cells_size, cells_used;
+	blot_screen_line *lines;
+	gsize lines_size, lines_used;
+};
+
+static const blot_screen_cell blot_screen_blank = { ' ', BLOT_SCREEN_NO_COLOR };
+
+static void blot_screen_grid_delete(struct blot_screen_grid *grid)
+{
+	if (!grid)
+		return;
+
+	blot_free(grid->cells);
+	blot_free(grid->lines);
+	blot_free(grid);
+}
 
 /* create/delete */
 
@@ -23,30 +68,138 @@ blot_screen * blot_screen_new(const blot_dimensions *dim,
 
 	RETURN_ERRORx(!char_len, NULL, error, EINVAL, "cannot create a zero sized screen");
 
-	// add extra space for screen clear escape code
-	if (flags & BLOT_RENDER_CLEAR)
-		char_len ++;
+	blot_screen *scr = blot_new0(blot_screen, 1);
+	RETURN_ERROR(!scr, NULL, error, "new blot_screen");
+
+	scr->flags     = flags;
+	scr->color     = have_color_support;
+	scr->dim       = *dim;
+	scr->mrg       = *mrg;
+
+	/* enough for a screen full of braille, or unicode, with a few color
+	 * changes per row; the buffer grows if more is needed */
+	scr->utf8.size = char_len * 3 + (gsize)dim->rows * 64 + 64;
+	scr->utf8.str  = blot_malloc(scr->utf8.size);
+	if (!scr->utf8.str)
+		blot_free(scr);
+	RETURN_ERROR(!scr->utf8.str, NULL, error, "new blot_screen [%zu]", scr->utf8.size);
+
+	return scr;
+}
 
-	// assume every character is escaped (overkill)
-	char_len *= 16;
+void blot_screen_delete(blot_screen *scr)
+{
+	if (!scr)
+		return;
+
+	blot_screen_grid_delete(scr->grid);
+	blot_composite_row_cleanup(&scr->row);
+	blot_free(scr->utf8.str);
+	blot_free(scr->diff.str);
+	blot_free(scr->data);
+	blot_free(scr);
+}
 
-	gsize data_bytes = char_len * sizeof(wchar_t);
-	gsize total_size = sizeof(blot_screen) + data_bytes;
-	blot_screen *scr = g_malloc(total_size);
-	RETURN_ERROR(!scr, NULL, error, "new blot_screen [%zu]", char_len);
+bool blot_screen_reset(blot_screen *scr,
+		       const blot_dimensions *dim,
+		       const blot_margins *mrg,
+		       blot_render_flags flags, GError **error)
+{
+	RETURN_EFAULT_IF(scr==NULL, false, error);
+	RETURN_ERRORx(!dim, false, error, EFAULT, "dimensions pointer is NULL");
+	RETURN_ERRORx(!mrg, false, error, EFAULT, "margins pointer is NULL");
+	RETURN_ERRORx(!dim->cols || !dim->rows, false, error, EINVAL,
+		      "cannot create a zero sized screen");
 
 	scr->flags     = flags;
+	scr->color     = have_color_support;
 	scr->dim       = *dim;
 	scr->mrg       = *mrg;
-	scr->data_size = char_len;
+
+	/* the buffers are kept, they grow as needed when this is rendered */
+	scr->utf8.used = 0;
+	scr->diff.used = 0;
 	scr->data_used = 0;
+	if (scr->grid)
+		scr->grid->valid = false;
 
-	return scr;
+	return true;
 }
 
-void blot_screen_delete(blot_screen *scr)
+/* output
+ *
+ * The text is built as UTF-8, with room reserved ahead of time for a whole
+ * row of cells, so that glyphs and color changes can be copied in from the
+ * precomputed tables without checking for space each time. */
+
+static bool blot_screen_reserve(blot_screen_buf *buf, gsize room, GError **error)
 {
-	g_free(scr);
+	gsize need = buf->used + room + 1;
+	if (likely (need <= buf->size))
+		return true;
+
+	gsize size = max_t(gsize, need, buf->size * 2);
+	gchar *str = blot_realloc(buf->str, size);
+	RETURN_ERROR(!str, false, error, "resize blot_screen [%zu]", size);
+
+	buf->str = str;
+	buf->size = size;
+	return true;
+}
+
+/* these must have room reserved already */
+
+static inline void blot_screen_put(blot_screen_buf *buf, const void *src, gsize len)
+{
+	memcpy(buf->str + buf->used, src, len);
+	buf->used += len;
+}
+
+static inline void blot_screen_put_char(blot_screen_buf *buf, char ch)
+{
+	buf->str[buf->used++] = ch;
+}
+
+static inline void blot_screen_put_chars(blot_screen_buf *buf, char ch, gsize count)
+{
+	memset(buf->str + buf->used, ch, count);
+	buf->used += count;
+}
+
+static inline void blot_screen_put_fg(blot_screen *scr, blot_color col)
+{
+	if (!scr->color)
+		return;
+
+	const blot_color_seq *seq = &blot_color_fg_seqs[col & 0xFF];
+	blot_screen_put(&scr->utf8, seq->str, seq->len);
+}
+
+/* and this one reserves what it needs, it returns the number of bytes
+ * written, or a negative number on error */
+__attribute__((format(printf, 3, 4)))
+static int blot_screen_printf(blot_screen_buf *buf, GError **error, const char *fmt, ...)
+{
+	va_list ap;
+	int len = 0;
+
+	for (;;) {
+		bool ok = blot_screen_reserve(buf, len, error);
+		RETURN_IF(!ok, -1);
+
+		gsize room = buf->size - buf->used;
+
+		va_start(ap, fmt);
+		len = vsnprintf(buf->str + buf->used, room, fmt, ap);
+		va_end(ap);
+
+		RETURN_ERROR(len<0, -1, error, "vsnprintf");
+		if (likely ((gsize)len < room))
+			break;
+	}
+
+	buf->used += len;
+	return len;
 }
 
 /* render */
@@ -55,23 +208,24 @@ static bool blot_screen_can_legend(blot_screen *scr, unsigned count,
 				   struct blot_layer *const*lays,
 				   GError **error)
 {
-	wchar_t *p = scr->data + scr->data_used,
-		 *end = scr->data + scr->data_size;
-
 	for (int ci=0; ci<count; ci++) {
 		const struct blot_layer *lay = lays[ci];
-		const char *colstr = fg(lay->color);
+		const blot_color_seq *seq = &blot_color_fg_seqs[lay->color & 0xFF];
+		int collen = scr->color ? seq->len : 0;
 
 		if (!lay->label || !*lay->label)
 			continue;
 
 		//wchar_t star = 0x2605; // does not show up in Terminus font
 		wchar_t symbol = 0x25D8; // inverse bullet ◘
+		char symstr[BLOT_UTF8_MAX+1] = {};
 		int len;
 
+		blot_utf8_encode(symstr, symbol);
+
 		if (!(scr->flags & BLOT_RENDER_LEGEND_DETAILS)) {
-			len = swprintf(p, end-p, L"%s%lc %s %s\n",
-				   colstr, symbol, COL_RESET,
+			len = blot_screen_printf(&scr->utf8, error, "%.*s%s %s %s\n",
+				   collen, seq->str, symstr, COL_RESET,
 				   lay->label);
 		} else if (lay->summary.enabled) {
 			char tavg[32], tmin[32], tmax[32];
@@ -82,42 +236,40 @@ static bool blot_screen_can_legend(blot_screen *scr, unsigned count,
 			int rmax = blot_format_number(tmax, sizeof(tmax),
 				   lay->summary.ymax);
 
-			len = swprintf(p, end-p, L"%s%lc %s %s   \tavg=%s min=%s max=%s count=%u\n",
-				   colstr, symbol, COL_RESET,
+			len = blot_screen_printf(&scr->utf8, error, "%.*s%s %s %s   \tavg=%s min=%s max=%s count=%zu\n",
+				   collen, seq->str, symstr, COL_RESET,
 				   lay->label,
 				   ravg>0 ? tavg : "?",
 				   rmin>0 ? tmin : "?",
 				   rmax>0 ? tmax : "?",
 				   lay->count);
 		} else {
-			len = swprintf(p, end-p, L"%s%lc %s %s   \tcount=%u\n",
-				   colstr, symbol, COL_RESET,
+			len = blot_screen_printf(&scr->utf8, error, "%.*s%s %s %s   \tcount=%zu\n",
+				   collen, seq->str, symstr, COL_RESET,
 				   lay->label,
 				   lay->count);
 		}
-		RETURN_ERROR(len<0, false, error, "swprintf");
-		p += len;
+		RETURN_IF(len<0, false);
 	}
 
-	*p = 0;
-	scr->data_used = p - scr->data;
 	return true;
 }
 
 
-static bool blot_screen_plot_cans(blot_screen *scr,
+static bool blot_screen_plot_rows(blot_screen *scr,
 				  const blot_xy_limits *lim,
 				  const blot_axis * x_axs,
 				  const blot_axis * y_axs,
 				  unsigned count,
+				  struct blot_layer *const*lays,
 				  blot_canvas *const*cans,
+				  blot_composite_row *row,
 				  GError **error)
 {
 	const int PREV_COLOR_UNUSED = -1;
 	int prev_color = PREV_COLOR_UNUSED;
-	wchar_t *p = scr->data + scr->data_used,
-		 *end = scr->data + scr->data_size;
 	int len;
+	bool ok;
 
 	/* determine the bounding box for canvases */
 	unsigned dsp_top = scr->mrg.top;
@@ -131,14 +283,23 @@ static bool blot_screen_plot_cans(blot_screen *scr,
 	bool draw_x_axis = !(scr->flags & BLOT_RENDER_NO_X_AXIS);
 	bool draw_y_axis = !(scr->flags & BLOT_RENDER_NO_Y_AXIS);
 	bool invert_y_axis = !(scr->flags & BLOT_RENDER_DONT_INVERT_Y_AXIS);
+	bool braille = !!(scr->flags & BLOT_RENDER_BRAILLE);
+
+	/* an indexed canvas holds the cells of all count layers */
+	bool indexed = count && cans[0] && cans[0]->layers;
+	unsigned can_count = indexed ? 1 : count;
+
+	/* the most a row of cells can take, with a color reset and a newline */
+	gsize row_max = (gsize)scr->dim.cols * BLOT_SCREEN_CELL_MAX
+		+ sizeof(COL_RESET) + 1;
 
 	/* now draw */
 
-	for (unsigned s_y=0; s_y<dsp_top; s_y++) {
-		/* lines above the display area are just skipped */
-		*(p++) = L'\n';
-		g_assert_cmpuint((uintptr_t)p, <, (uintptr_t)end);
-	}
+	ok = blot_screen_reserve(&scr->utf8, dsp_top, error);
+	RETURN_IF(!ok, false);
+
+	/* lines above the display area are just skipped */
+	blot_screen_put_chars(&scr->utf8, '\n', dsp_top);
 
 	for (unsigned s_y=dsp_top; s_y<dsp_bot; s_y++) {
 		/* this is where the canvases are merged */
@@ -154,6 +315,9 @@ static bool blot_screen_plot_cans(blot_screen *scr,
 			c_y = s_y - dsp_top;
 		}
 
+		ok = blot_screen_reserve(&scr->utf8, row_max, error);
+		RETURN_IF(!ok, false);
+
 		unsigned s_x=0;
 		if (!draw_y_axis)
 			/* no Y-axis, just plot */
@@ -162,10 +326,7 @@ static bool blot_screen_plot_cans(blot_screen *scr,
 		/* apply Y-axis color */
 
 		if (!(scr->flags & BLOT_RENDER_NO_COLOR) && prev_color != y_axs->color) {
-			const char *colstr = fg(y_axs->color);
-			len = swprintf(p, end-p, L"%s", colstr);
-			RETURN_ERROR(len<0, false, error, "swprintf");
-			p += len;
+			blot_screen_put_fg(scr, y_axs->color);
 			prev_color = y_axs->color;
 		}
 
@@ -176,76 +337,82 @@ static bool blot_screen_plot_cans(blot_screen *scr,
 
 		const char *ytick_label = ytick ? ytick->label : "";
 		char axis_char = ytick ? '*' : '|';
-		len = swprintf(p, end-p, L"%*s %c",
-			       dsp_lft-2, ytick_label, axis_char);
-
-		RETURN_ERROR(len<0, false, error, "swprintf");
+		len = blot_screen_printf(&scr->utf8, error, "%*s %c",
+					 dsp_lft-2, ytick_label, axis_char);
+		RETURN_IF(len<0, false);
 		g_assert_cmpuint(len, ==, dsp_lft);
-		p += len;
+
+		ok = blot_screen_reserve(&scr->utf8, row_max, error);
+		RETURN_IF(!ok, false);
 
 		s_x += dsp_lft;
 
 plot_cells:
-		for (; s_x<scr->dim.cols; s_x++) {
-
-			wchar_t wch = L' ';
+		/* anything left of the display area is blank */
+		if (s_x < dsp_lft) {
+			blot_screen_put_chars(&scr->utf8, ' ', dsp_lft - s_x);
+			s_x = dsp_lft;
+		}
 
-			if (s_x < dsp_lft || s_x >= dsp_rgt)
-				goto skip_cell;
+		ok = blot_composite_row_merge(row, can_count, cans, c_y, error);
+		RETURN_IF(!ok, false);
 
-			unsigned c_x = s_x - dsp_lft;
+		for (unsigned c_x=0; c_x<dsp_wdh; c_x++) {
 
-			wchar_t top_cell = 0;
-			blot_color top_col = 0;
+			if (!(c_x % 64) && !blot_composite_block_used(row, c_x)) {
+				/* nothing is plotted in the next 64 cells */
+				unsigned n = min_t(unsigned, 64, dsp_wdh - c_x);
+				blot_screen_put_chars(&scr->utf8, ' ', n);
+				c_x += n - 1;
+				continue;
+			}
 
-			for (int ci=0; ci<count; ci++) {
-				const struct blot_canvas *can = cans[ci];
+			guint8 layer = row->layers[c_x];
+			if (!layer) {
+				blot_screen_put_char(&scr->utf8, ' ');
+				continue;
+			}
 
-				wchar_t cell = blot_canvas_get_cell(can, c_x, c_y);
-				if (!cell)
-					continue;
+			const struct blot_canvas *can = indexed ? cans[0] : cans[layer-1];
+			blot_color color = indexed ? lays[layer-1]->color : can->color;
 
-				top_cell = cell;
-				top_col = can->color;
+			if (!(scr->flags & BLOT_RENDER_NO_COLOR) && prev_color != color) {
+				blot_screen_put_fg(scr, color);
+				prev_color = color;
 			}
 
-			if (top_cell) {
-				if (!(scr->flags & BLOT_RENDER_NO_COLOR) && prev_color != top_col) {
-					const char *colstr = fg(top_col);
-					len = swprintf(p, end-p, L"%s", colstr);
-					RETURN_ERROR(len<0, false, error, "swprintf");
-					p += len;
-					prev_color = top_col;
-				}
-				wch = top_cell;
+			if (braille) {
+				blot_screen_put(&scr->utf8, braille_utf8[row->glyphs[c_x]],
+						BRAILLE_GLYPH_UTF8_LEN);
+			} else {
+				char *p = scr->utf8.str + scr->utf8.used;
+				scr->utf8.used += blot_utf8_encode(p, can->no_braille.plot_char);
 			}
-
-skip_cell:
-			*(p++) = wch;
-			g_assert_cmpuint((uintptr_t)p, <, (uintptr_t)end);
 		}
+		s_x += dsp_wdh;
+
+		/* and so is anything right of it */
+		if (s_x < scr->dim.cols)
+			blot_screen_put_chars(&scr->utf8, ' ', scr->dim.cols - s_x);
 
 		if (prev_color != PREV_COLOR_UNUSED) {
-			len = swprintf(p, end-p, L"%s", COL_RESET);
-			RETURN_ERROR(len<0, false, error, "swprintf");
-			p += len;
+			blot_screen_put(&scr->utf8, COL_RESET, sizeof(COL_RESET)-1);
 			prev_color = PREV_COLOR_UNUSED;
 		}
 
-		*(p++) = L'\n';
-		g_assert_cmpuint((uintptr_t)p, <, (uintptr_t)end);
+		blot_screen_put_char(&scr->utf8, '\n');
 	}
 
 	for (unsigned s_y=dsp_bot; s_y<scr->dim.rows; s_y++) {
+		ok = blot_screen_reserve(&scr->utf8, row_max, error);
+		RETURN_IF(!ok, false);
+
 		/* the bottom lines may contain the X-axis */
 		if (!draw_x_axis)
 			goto done_bot_line;
 
 		if (!(scr->flags & BLOT_RENDER_NO_COLOR) && prev_color != x_axs->color) {
-			const char *colstr = fg(x_axs->color);
-			len = swprintf(p, end-p, L"%s", colstr);
-			RETURN_ERROR(len<0, false, error, "swprintf");
-			p += len;
+			blot_screen_put_fg(scr, x_axs->color);
 			prev_color = x_axs->color;
 		}
 
@@ -253,17 +420,17 @@ skip_cell:
 			/* this line is the X-axis line */
 			for (unsigned s_x=0; s_x<scr->dim.cols; s_x++) {
 				if (s_x == (dsp_lft-1)) {
-					*(p++) = L'+';
+					blot_screen_put_char(&scr->utf8, '+');
 				} else if (s_x < dsp_lft) {
-					*(p++) = L' ';
+					blot_screen_put_char(&scr->utf8, ' ');
 				} else if (s_x < dsp_rgt) {
 					unsigned c_x = s_x - dsp_lft;
 					const blot_axis_tick *xtick;
 					xtick = blot_axis_get_tick_at(x_axs, c_x, error);
 					if (xtick)
-						*(p++) = L'*';
+						blot_screen_put_char(&scr->utf8, '*');
 					else
-						*(p++) = L'-';
+						blot_screen_put_char(&scr->utf8, '-');
 				}
 			}
 			goto done_bot_line;
@@ -275,36 +442,103 @@ skip_cell:
 
 		/* this is the X-axis label line */
 
-		len = swprintf(p, end-p, L"%*s",
-				   dsp_lft, "");
-		RETURN_ERROR(len<0, false, error, "swprintf");
-		p += len;
+		blot_screen_put_chars(&scr->utf8, ' ', dsp_lft);
 
 		for (unsigned c_x=0; c_x<dsp_wdh; c_x++) {
 			const blot_axis_tick *xtick;
 			xtick = blot_axis_get_tick_at(x_axs, c_x, error);
 			if (!xtick) {
-				*(p++) = L' ';
+				ok = blot_screen_reserve(&scr->utf8, 1, error);
+				RETURN_IF(!ok, false);
+				blot_screen_put_char(&scr->utf8, ' ');
 				continue;
 			}
 
-			len = swprintf(p, end-p, L"%s ", xtick->label);
-			RETURN_ERROR(len<0, false, error, "swprintf");
-			p += len;
+			len = blot_screen_printf(&scr->utf8, error, "%s ", xtick->label);
+			RETURN_IF(len<0, false);
+
+			/* labels take one cell per character */
+			len = blot_utf8_count(scr->utf8.str + scr->utf8.used - len, len);
 
 			c_x += len-1;
 		}
 
+		ok = blot_screen_reserve(&scr->utf8, row_max, error);
+		RETURN_IF(!ok, false);
+
 done_bot_line:
 		if (prev_color != PREV_COLOR_UNUSED) {
-			len = swprintf(p, end-p, L"%s", COL_RESET);
-			RETURN_ERROR(len<0, false, error, "swprintf");
-			p += len;
+			blot_screen_put(&scr->utf8, COL_RESET, sizeof(COL_RESET)-1);
 			prev_color = PREV_COLOR_UNUSED;
 		}
 
-		*(p++) = L'\n';
-		g_assert_cmpuint((uintptr_t)p, <, (uintptr_t)end);
+		blot_screen_put_char(&scr->utf8, '\n');
+	}
+
+	return true;
+}
+
+static bool blot_screen_plot_cans(blot_screen *scr,
+				  const blot_xy_limits *lim,
+				  const blot_axis * x_axs,
+				  const blot_axis * y_axs,
+				  unsigned count,
+				  struct blot_layer *const*lays,
+				  blot_canvas *const*cans,
+				  GError **error)
+{
+	unsigned dsp_wdh = scr->dim.cols - scr->mrg.left - scr->mrg.right;
+	unsigned cols = max_t(unsigned, dsp_wdh, 1);
+
+	/* the row is kept for as long as the width does not change */
+	if (scr->row.cols != cols) {
+		blot_composite_row_cleanup(&scr->row);
+
+		bool ok = blot_composite_row_init(&scr->row, cols, error);
+		RETURN_IF(!ok, false);
+	}
+
+	return blot_screen_plot_rows(scr, lim, x_axs, y_axs, count, lays, cans, &scr->row, error);
+}
+
+/* decode the UTF-8 text into wide characters, for blot_screen_get_text() */
+static bool blot_screen_decode(blot_screen *scr, GError **error)
+{
+	const guint8 *s = (const guint8*)scr->utf8.str;
+	gsize len = scr->utf8.used;
+	gsize count = blot_utf8_count(scr->utf8.str, len);
+
+	if (count + 1 > scr->data_size) {
+		wchar_t *data = blot_renew(wchar_t, scr->data, count + 1);
+		RETURN_ERROR(!data, false, error, "resize blot_screen [%zu]", count + 1);
+		scr->data = data;
+		scr->data_size = count + 1;
+	}
+
+	wchar_t *p = scr->data;
+	for (gsize i=0; i<len; ) {
+		guint8 c = s[i++];
+		gunichar wch;
+		unsigned more;
+
+		if (likely (c < 0x80)) {
+			*(p++) = c;
+			continue;
+		} else if (c >= 0xF0) {
+			wch = c & 0x07;
+			more = 3;
+		} else if (c >= 0xE0) {
+			wch = c & 0x0F;
+			more = 2;
+		} else {
+			wch = c & 0x1F;
+			more = 1;
+		}
+
+		for (; more && i<len && (s[i] & 0xC0) == 0x80; more--)
+			wch = (wch << 6) | (s[i++] & 0x3F);
+
+		*(p++) = wch;
 	}
 
 	*p = 0;
@@ -323,11 +557,13 @@ bool blot_screen_render(blot_screen *scr,
 {
 	RETURN_EFAULT_IF(scr==NULL, NULL, error);
 
+	scr->utf8.used = 0;
 	scr->data_used = 0;
+	if (scr->grid)
+		scr->grid->valid = false;
 	if (scr->flags & BLOT_RENDER_CLEAR) {
-		int len = swprintf(scr->data, scr->data_size, L"%s", CLR_SCR);
-		RETURN_ERROR(len<0, false, error, "swprintf");
-		scr->data_used = len;
+		int len = blot_screen_printf(&scr->utf8, error, "%s", CLR_SCR);
+		RETURN_IF(len<0, false);
 	}
 
 	gboolean ok;
@@ -337,7 +573,7 @@ bool blot_screen_render(blot_screen *scr,
 		RETURN_IF(!ok, false);
 	}
 
-	ok = blot_screen_plot_cans(scr, lim, x_axs, y_axs, count, cans, error);
+	ok = blot_screen_plot_cans(scr, lim, x_axs, y_axs, count, lays, cans, error);
 	RETURN_IF(!ok, false);
 
 	if (scr->flags & BLOT_RENDER_LEGEND_BELOW) {
@@ -345,6 +581,14 @@ bool blot_screen_render(blot_screen *scr,
 		RETURN_IF(!ok, false);
 	}
 
+	/* there is always room for the terminator */
+	scr->utf8.str[scr->utf8.used] = 0;
+
+	if (!(scr->flags & BLOT_RENDER_UTF8)) {
+		ok = blot_screen_decode(scr, error);
+		RETURN_IF(!ok, false);
+	}
+
 	return true;
 }
 
@@ -352,7 +596,322 @@ const wchar_t * blot_screen_get_text(const blot_screen *scr,
 				  gsize *txt_size, GError **error)
 {
 	RETURN_EFAULT_IF(scr==NULL, NULL, error);
+	RETURN_ERRORx(scr->flags & BLOT_RENDER_UTF8, NULL, error, EINVAL,
+		      "screen was rendered with BLOT_RENDER_UTF8, use blot_screen_get_utf8()");
 
 	*txt_size = scr->data_used;
 	return scr->data;
 }
+
+const char * blot_screen_get_utf8(const blot_screen *scr,
+				  gsize *txt_size, GError **error)
+{
+	RETURN_EFAULT_IF(scr==NULL, NULL, error);
+
+	*txt_size = scr->utf8.used;
+	return scr->utf8.str;
+}
+
+/* diff
+ *
+ * To compare two frames, their text is split into lines of cells, each one
+ * being a character and the color it is drawn in.  Lines that have tabs, or
+ * escapes other than colors, cannot be split into cells reliably; those are
+ * compared as text and rewritten whole. */
+
+/* unchanged cells between two changes are written over again, rather than
+ * moving the cursor, when there are at most this many of them */
+#define BLOT_SCREEN_DIFF_GAP 8
+
+/* parse an escape sequence at p, which starts with ESC, and return its length;
+ * color is updated if it is a color change, otherwise raw is set */
+static gsize blot_screen_parse_escape(const char *p, const char *end, gint16 *color, bool *raw)
+{
+	const char *q = p + 1;
+
+	if (q == end || *q != '[') {
+		*raw = true;
+		return q - p;
+	}
+
+	const char *params = ++q;
+	while (q < end && (*q < 0x40 || *q > 0x7E))
+		q++;
+	if (q == end) {
+		*raw = true;
+		return q - p;
+	}
+
+	gsize params_len = q - params;
+	static const char fg_prefix[] = "38;5;";
+
+	if (*q != 'm') {
+		*raw = true;
+
+	} else if (!params_len || (params_len == 1 && *params == '0')) {
+		*color = BLOT_SCREEN_NO_COLOR;
+
+	} else if (params_len > sizeof(fg_prefix)-1
+		   && !memcmp(params, fg_prefix, sizeof(fg_prefix)-1)) {
+		unsigned col = 0;
+		for (const char *d = params + sizeof(fg_prefix)-1; d < q; d++) {
+			if (*d < '0' || *d > '9')
+				*raw = true;
+			col = col * 10 + (*d - '0');
+		}
+		*color = col & 0xFF;
+
+	} else {
+		*raw = true;
+	}
+
+	return q + 1 - p;
+}
+
+static bool blot_screen_grid_parse(blot_screen *scr, GError **error)
+{
+	struct blot_screen_grid *grid = scr->grid;
+
+	if (!grid) {
+		grid = scr->grid = blot_new0(struct blot_screen_grid, 1);
+		RETURN_ERROR(!grid, false, error, "new blot_screen_grid");
+	}
+
+	if (grid->valid)
+		return true;
+
+	const char *text = scr->utf8.str, *end = text + scr->utf8.used;
+	const char *p = text;
+
+	/* the screen clear is replaced by cursor movements */
+	if (scr->utf8.used >= sizeof(CLR_SCR)-1 && !memcmp(p, CLR_SCR, sizeof(CLR_SCR)-1))
+		p += sizeof(CLR_SCR)-1;
+
+	/* every byte is at most one cell, and every line is at least one byte */
+	gsize max_cells = end - p, max_lines = end - p + 1;
+
+	if (max_cells > grid->cells_size) {
+		blot_screen_cell *cells = blot_renew(blot_screen_cell, grid->cells, max_cells);
+		RETURN_ERROR(!cells, false, error, "resize blot_screen_grid [%zu]", max_cells);
+		grid->cells = cells;
+		grid->cells_size = max_cells;
+	}
+	if (max_lines > grid->lines_size) {
+		blot_screen_line *lines = blot_renew(blot_screen_line, grid->lines, max_lines);
+		RETURN_ERROR(!lines, false, error, "resize blot_screen_grid [%zu]", max_lines);
+		grid->lines = lines;
+		grid->lines_size = max_lines;
+	}
+
+	grid->text = p - text;
+	grid->cells_used = 0;
+	grid->lines_used = 0;
+
+	gint16 color = BLOT_SCREEN_NO_COLOR;
+
+	while (p < end) {
+		blot_screen_line *line = &grid->lines[grid->lines_used++];
+
+		line->text = p - text;
+		line->cell = grid->cells_used;
+		line->color = color;
+		line->raw = false;
+
+		while (p < end && *p != '\n') {
+			guint8 c = *p;
+
+			if (c == '\033') {
+				p += blot_screen_parse_escape(p, end, &color, &line->raw);
+				continue;
+			}
+
+			if (c == '\t')
+				line->raw = true;
+
+			gunichar wch;
+			if (likely (c < 0x80)) {
+				wch = c;
+				p++;
+			} else {
+				unsigned more = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+				wch = c & (0x3F >> more);
+				for (p++; more && p < end && (*p & 0xC0) == 0x80; more--)
+					wch = (wch << 6) | (*(p++) & 0x3F);
+			}
+
+			grid->cells[grid->cells_used++] = (blot_screen_cell){ wch, color };
+		}
+
+		line->text_len = p - text - line->text;
+		line->cell_count = grid->cells_used - line->cell;
+
+		/* skip the newline */
+		if (p < end)
+			p++;
+	}
+
+	grid->valid = true;
+	return true;
+}
+
+static inline bool blot_screen_cell_equal(const blot_screen_cell *a, const blot_screen_cell *b)
+{
+	return a->wch == b->wch && a->color == b->color;
+}
+
+static inline const blot_screen_cell * blot_screen_cell_at(const struct blot_screen_grid *grid,
+							   const blot_screen_line *line, gsize col)
+{
+	if (!line || col >= line->cell_count)
+		return &blot_screen_blank;
+	return &grid->cells[line->cell + col];
+}
+
+static bool blot_screen_set_color(blot_screen_buf *buf, gint16 *cur, gint16 color, GError **error)
+{
+	if (*cur == color)
+		return true;
+
+	bool ok = blot_screen_reserve(buf, BLOT_SCREEN_CELL_MAX, error);
+	RETURN_IF(!ok, false);
+
+	if (color == BLOT_SCREEN_NO_COLOR)
+		blot_screen_put(buf, COL_RESET, sizeof(COL_RESET)-1);
+	else
+		blot_screen_put(buf, blot_color_fg_seqs[color].str, blot_color_fg_seqs[color].len);
+
+	*cur = color;
+	return true;
+}
+
+static bool blot_screen_diff_lines(blot_screen *scr, blot_screen *prev, GError **error)
+{
+	const struct blot_screen_grid *ngrid = scr->grid, *ogrid = prev->grid;
+	blot_screen_buf *out = &scr->diff;
+	gint16 cur = BLOT_SCREEN_NO_COLOR;
+	bool ok;
+	int len;
+
+	gsize lines = max_t(gsize, ngrid->lines_used, ogrid->lines_used);
+
+	for (gsize ln=0; ln<lines; ln++) {
+		const blot_screen_line *nl = ln < ngrid->lines_used ? &ngrid->lines[ln] : NULL;
+		const blot_screen_line *ol = ln < ogrid->lines_used ? &ogrid->lines[ln] : NULL;
+
+		if ((nl && nl->raw) || (ol && ol->raw)) {
+			const char *ntext = nl ? scr->utf8.str + nl->text : "";
+			const char *otext = ol ? prev->utf8.str + ol->text : "";
+			gsize nlen = nl ? nl->text_len : 0;
+			gsize olen = ol ? ol->text_len : 0;
+			gint16 ncolor = nl ? nl->color : BLOT_SCREEN_NO_COLOR;
+			gint16 ocolor = ol ? ol->color : BLOT_SCREEN_NO_COLOR;
+
+			if (nlen == olen && ncolor == ocolor && !memcmp(ntext, otext, nlen))
+				continue;
+
+			/* move to the line, clear it, and write it out whole */
+			len = blot_screen_printf(out, error, ESC "%zu;1H" ESC "K", ln+1);
+			RETURN_IF(len<0, false);
+
+			ok = blot_screen_set_color(out, &cur, ncolor, error);
+			RETURN_IF(!ok, false);
+
+			ok = blot_screen_reserve(out, nlen + sizeof(COL_RESET), error);
+			RETURN_IF(!ok, false);
+
+			blot_screen_put(out, ntext, nlen);
+
+			/* the colors the line ends with are not tracked */
+			blot_screen_put(out, COL_RESET, sizeof(COL_RESET)-1);
+			cur = BLOT_SCREEN_NO_COLOR;
+			continue;
+		}
+
+		gsize cols = max_t(gsize, nl ? nl->cell_count : 0, ol ? ol->cell_count : 0);
+
+		for (gsize col=0; col<cols; col++) {
+			if (blot_screen_cell_equal(blot_screen_cell_at(ngrid, nl, col),
+						   blot_screen_cell_at(ogrid, ol, col)))
+				continue;
+
+			/* extend the run while the gaps between changes are short */
+			gsize first = col, last = col;
+			for (col++; col<cols && col-last <= BLOT_SCREEN_DIFF_GAP; col++) {
+				if (!blot_screen_cell_equal(blot_screen_cell_at(ngrid, nl, col),
+							    blot_screen_cell_at(ogrid, ol, col)))
+					last = col;
+			}
+			col = last;
+
+			len = blot_screen_printf(out, error, ESC "%zu;%zuH", ln+1, first+1);
+			RETURN_IF(len<0, false);
+
+			for (gsize c=first; c<=last; c++) {
+				const blot_screen_cell *cell = blot_screen_cell_at(ngrid, nl, c);
+
+				ok = blot_screen_set_color(out, &cur, cell->color, error);
+				RETURN_IF(!ok, false);
+
+				ok = blot_screen_reserve(out, BLOT_UTF8_MAX, error);
+				RETURN_IF(!ok, false);
+
+				out->used += blot_utf8_encode(out->str + out->used, cell->wch);
+			}
+		}
+	}
+
+	ok = blot_screen_set_color(out, &cur, BLOT_SCREEN_NO_COLOR, error);
+	RETURN_IF(!ok, false);
+
+	/* leave the cursor where a full redraw would */
+	len = blot_screen_printf(out, error, ESC "%zu;1H", ngrid->lines_used+1);
+	RETURN_IF(len<0, false);
+
+	return true;
+}
+
+const char * blot_screen_diff(blot_screen *scr, blot_screen *prev,
+			      gsize *txt_size, GError **error)
+{
+	RETURN_EFAULT_IF(scr==NULL, NULL, error);
+	RETURN_EFAULT_IF(txt_size==NULL, NULL, error);
+
+	bool ok = blot_screen_grid_parse(scr, error);
+	RETURN_IF(!ok, NULL);
+
+	const struct blot_screen_grid *grid = scr->grid;
+	const char *text = scr->utf8.str + grid->text;
+	gsize text_len = scr->utf8.used - grid->text;
+
+	scr->diff.used = 0;
+
+	bool full = !prev
+		|| prev->dim.cols != scr->dim.cols
+		|| prev->dim.rows != scr->dim.rows;
+
+	if (!full) {
+		ok = blot_screen_grid_parse(prev, error);
+		RETURN_IF(!ok, NULL);
+
+		ok = blot_screen_diff_lines(scr, prev, error);
+		RETURN_IF(!ok, NULL);
+
+		/* it may be cheaper to just draw it all again */
+		full = scr->diff.used >= text_len + sizeof(CLR_SCR)-1;
+	}
+
+	if (full) {
+		scr->diff.used = 0;
+
+		ok = blot_screen_reserve(&scr->diff, sizeof(CLR_SCR)-1 + text_len, error);
+		RETURN_IF(!ok, NULL);
+
+		blot_screen_put(&scr->diff, CLR_SCR, sizeof(CLR_SCR)-1);
+		blot_screen_put(&scr->diff, text, text_len);
+	}
+
+	scr->diff.str[scr->diff.used] = 0;
+
+	*txt_size = scr->diff.used;
+	return scr->diff.str;
+}
@@ -9,7 +9,7 @@
 
 static blot_dimensions blot_fixed_dims = {};
 
-bool blot_terminal_set_size(blot_dimensions dims, GError **error)
+bool blot_terminal_check_size(blot_dimensions dims, GError **error)
 {
 	RETURN_ERRORx(dims.cols>BLOT_MAX_COLS || dims.cols<BLOT_MIN_COLS,
 	       false, error, ERANGE,
@@ -19,6 +19,14 @@ bool blot_terminal_set_size(blot_dimensions dims, GError **error)
 	       false, error, ERANGE,
 	       "invalid rows=%d specified", dims.rows);
 
+	return true;
+}
+
+bool blot_terminal_set_size(blot_dimensions dims, GError **error)
+{
+	bool ok = blot_terminal_check_size(dims, error);
+	RETURN_IF(!ok, false);
+
 	blot_fixed_dims = dims;
 	return true;
 }
@@ -34,13 +42,19 @@ bool blot_terminal_get_size(blot_dimensions *dims, GError **error)
 		return true;
 	}
 
+	return blot_terminal_query_size(dims, error);
+}
+
+/* nothing is cached here, so that this can be called from any thread */
+bool blot_terminal_query_size(blot_dimensions *dims, GError **error)
+{
+	RETURN_ERROR_IF(!dims, false, error, EFAULT);
+
 	dims->cols = blot_env_to_uint("COLUMNS", 0);
 	dims->rows = blot_env_to_uint("LINES", 0);
 
-	if (dims->cols && dims->rows) {
-		blot_fixed_dims = *dims;
+	if (dims->cols && dims->rows)
 		return true;
-	}
 
 	struct winsize w = {};
 	int rc = ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
@@ -0,0 +1,257 @@
+/* blot: batched data to canvas coordinate transform */
+/* vim: set noet sw=8 ts=8 tw=120: */
+#include <math.h>
+#include <string.h>
+#include "blot_transform.h"
+#include "blot_minmax.h"
+#include "blot_error.h"
+#include "blot_utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOT_TRANSFORM_X86 1
+#endif
+
+/* Transforming a batch happens in two steps.  First the X and Y values are
+ * widened to double, the same conversion that the one-point-at-a-time math
+ * does, so the pixels always match it; then a kernel maps a block of doubles
+ * onto the canvas.  (A float32 kernel for float data would be faster still,
+ * but it would land on a different pixel near the rounding boundaries.)
+ *
+ * The vector kernels cannot use round() directly, since the rounding modes
+ * of the vector instructions round half to even.  Adding the largest double
+ * below 0.5 (with the sign of the value) and truncating gives the same result
+ * as round() for every input.  This file is built with -ffp-contract=off, so
+ * that multiply and add are never fused, which would change the rounding. */
+
+#define BLOT_TRANSFORM_HALF 0.49999999999999994
+
+/* every kernel transforms x/y[0..count), writing the coordinates, and
+ * setting bits in the pre-cleared visible mask; returns visible count */
+typedef unsigned (*blot_transform_fn)(const blot_transform *tr, const double *x, const double *y,
+				      unsigned count, gint32 *cols, gint32 *rows, guint64 *visible);
+
+/* scalar */
+
+static unsigned blot_transform_scalar_from(const blot_transform *tr, const double *x, const double *y,
+					   unsigned start, unsigned count,
+					   gint32 *cols, gint32 *rows, guint64 *visible)
+{
+	unsigned n = 0;
+
+	for (unsigned i=start; i<count; i++) {
+		double dc = round((x[i] - tr->x_min) * tr->x_scale);
+		double dr = round((y[i] - tr->y_min) * tr->y_scale);
+
+		/* written so that NaN is never visible */
+		if (!(dc >= 0 && dc < tr->cols && dr >= 0 && dr < tr->rows))
+			continue;
+
+		cols[i] = dc;
+		rows[i] = dr;
+		visible[i/64] |= 1ull << (i%64);
+		n ++;
+	}
+
+	return n;
+}
+
+static unsigned blot_transform_scalar(const blot_transform *tr, const double *x, const double *y,
+				      unsigned count, gint32 *cols, gint32 *rows, guint64 *visible)
+{
+	return blot_transform_scalar_from(tr, x, y, 0, count, cols, rows, visible);
+}
+
+#ifdef BLOT_TRANSFORM_X86
+
+/* Each vector kernel rounds LANES values of X and Y to int32, which turns
+ * anything out of the int32 range (and NaN) into INT32_MIN, then does the
+ * visibility test as signed integer compares.  The blocks are a power of two
+ * in size, so the mask bits of one block never straddle two words. */
+
+#define BLOT_TRANSFORM_VECTOR(ISA, TARGET, LANES, VD, VI, LOADD, SET1D, SUBD, MULD, ADDD, ANDD, ORD, \
+			      CVTI, SET1I, CMPGTI, ANDI, STOREI, MOVEMASK) \
+__attribute__((target(TARGET))) \
+static unsigned blot_transform_##ISA(const blot_transform *tr, const double *x, const double *y, \
+				     unsigned count, gint32 *cols, gint32 *rows, guint64 *visible) \
+{ \
+	const VD x_min = SET1D(tr->x_min), x_scale = SET1D(tr->x_scale); \
+	const VD y_min = SET1D(tr->y_min), y_scale = SET1D(tr->y_scale); \
+	const VD half = SET1D(BLOT_TRANSFORM_HALF), sign = SET1D(-0.0); \
+	const VI ncols = SET1I(tr->cols), nrows = SET1I(tr->rows), neg = SET1I(-1); \
+	unsigned i, n = 0; \
+	for (i=0; i + LANES <= count; i += LANES) { \
+		VD dc = MULD(SUBD(LOADD(x + i), x_min), x_scale); \
+		VD dr = MULD(SUBD(LOADD(y + i), y_min), y_scale); \
+		VI c = CVTI(ADDD(dc, ORD(half, ANDD(dc, sign)))); \
+		VI r = CVTI(ADDD(dr, ORD(half, ANDD(dr, sign)))); \
+		VI vis = ANDI(ANDI(CMPGTI(c, neg), CMPGTI(ncols, c)), \
+			      ANDI(CMPGTI(r, neg), CMPGTI(nrows, r))); \
+		STOREI(cols + i, c); \
+		STOREI(rows + i, r); \
+		unsigned bits = MOVEMASK(vis); \
+		visible[i/64] |= (guint64)bits << (i%64); \
+		n += __builtin_popcount(bits); \
+	} \
+	return n + blot_transform_scalar_from(tr, x, y, i, count, cols, rows, visible); \
+}
+
+/* SSE2 converts two doubles into the low half of a 32-bit integer vector */
+
+#define BLOT_SSE2_STOREL(p,v)   _mm_storel_epi64((__m128i*)(p), v)
+#define BLOT_SSE2_MOVEMASK2(v)  (_mm_movemask_ps(_mm_castsi128_ps(v)) & 3)
+
+BLOT_TRANSFORM_VECTOR(sse2, "sse2", 2, __m128d, __m128i,
+		      _mm_loadu_pd, _mm_set1_pd, _mm_sub_pd, _mm_mul_pd, _mm_add_pd, _mm_and_pd, _mm_or_pd,
+		      _mm_cvttpd_epi32, _mm_set1_epi32, _mm_cmpgt_epi32, _mm_and_si128,
+		      BLOT_SSE2_STOREL, BLOT_SSE2_MOVEMASK2)
+
+/* AVX2 converts four doubles into a 128-bit integer vector */
+
+#define BLOT_SSE_STOREU(p,v)    _mm_storeu_si128((__m128i*)(p), v)
+#define BLOT_SSE_MOVEMASK4(v)   _mm_movemask_ps(_mm_castsi128_ps(v))
+
+BLOT_TRANSFORM_VECTOR(avx2, "avx2", 4, __m256d, __m128i,
+		      _mm256_loadu_pd, _mm256_set1_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_add_pd,
+		      _mm256_and_pd, _mm256_or_pd,
+		      _mm256_cvttpd_epi32, _mm_set1_epi32, _mm_cmpgt_epi32, _mm_and_si128,
+		      BLOT_SSE_STOREU, BLOT_SSE_MOVEMASK4)
+
+/* AVX-512 converts eight doubles into a 256-bit integer vector, and
+ * only has bitwise operations on doubles with the DQ extension */
+
+__attribute__((target("avx512f")))
+static inline __m512d blot_avx512_and_pd(__m512d a, __m512d b)
+{
+	return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d blot_avx512_or_pd(__m512d a, __m512d b)
+{
+	return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+}
+
+#define BLOT_AVX_STOREU(p,v)    _mm256_storeu_si256((__m256i*)(p), v)
+#define BLOT_AVX_MOVEMASK8(v)   _mm256_movemask_ps(_mm256_castsi256_ps(v))
+
+BLOT_TRANSFORM_VECTOR(avx512, "avx512f,avx512bw", 8, __m512d, __m256i,
+		      _mm512_loadu_pd, _mm512_set1_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_add_pd,
+		      blot_avx512_and_pd, blot_avx512_or_pd,
+		      _mm512_cvttpd_epi32, _mm256_set1_epi32, _mm256_cmpgt_epi32, _mm256_and_si256,
+		      BLOT_AVX_STOREU, BLOT_AVX_MOVEMASK8)
+
+#endif // BLOT_TRANSFORM_X86
+
+/* dispatch */
+
+static const blot_transform_fn blot_transform_fns[BLOT_SIMD_LEVEL_MAX] = {
+	[BLOT_SIMD_NONE]   = blot_transform_scalar,
+#ifdef BLOT_TRANSFORM_X86
+	[BLOT_SIMD_SSE2]   = blot_transform_sse2,
+	[BLOT_SIMD_AVX2]   = blot_transform_avx2,
+	[BLOT_SIMD_AVX512] = blot_transform_avx512,
+#endif
+};
+
+/* widening, returns a pointer to the doubles, which is the data itself
+ * when it already is an array of doubles */
+
+typedef const double * (*blot_transform_load_fn)(const void *data, size_t first,
+						 unsigned count, double *buf);
+
+#define BLOT_TRANSFORM_LOAD(NAME, T) \
+static const double * blot_transform_load_##NAME(const void *data, size_t first, \
+						 unsigned count, double *buf) \
+{ \
+	const T *p = (const T*)data + first; \
+	for (unsigned i=0; i<count; i++) \
+		buf[i] = p[i]; \
+	return buf; \
+}
+
+BLOT_TRANSFORM_LOAD(int16, gint16)
+BLOT_TRANSFORM_LOAD(int32, gint32)
+BLOT_TRANSFORM_LOAD(int64, gint64)
+BLOT_TRANSFORM_LOAD(float, float)
+
+static const double * blot_transform_load_double(const void *data, size_t first,
+						 unsigned count, double *buf)
+{
+	return (const double*)data + first;
+}
+
+static const double * blot_transform_load_index(size_t first, unsigned count, double *buf)
+{
+	/* X data can be NULL, that means we are plotting the index as X */
+	for (unsigned i=0; i<count; i++)
+		buf[i] = first + i;
+	return buf;
+}
+
+#define BLOT_TRANSFORM_TYPE_MAX (BLOT_DATA_X_DOUBLE+1)
+
+static const blot_transform_load_fn blot_transform_load_fns[BLOT_TRANSFORM_TYPE_MAX] = {
+	[BLOT_DATA_X_INT16]  = blot_transform_load_int16,
+	[BLOT_DATA_X_INT32]  = blot_transform_load_int32,
+	[BLOT_DATA_X_INT64]  = blot_transform_load_int64,
+	[BLOT_DATA_X_FLOAT]  = blot_transform_load_float,
+	[BLOT_DATA_X_DOUBLE] = blot_transform_load_double,
+};
+
+bool blot_transform_points_simd(blot_simd_level level, const blot_transform *tr,
+				blot_data_type data_type,
+				const void *xs, const void *ys, size_t first, size_t count,
+				gint32 *out_cols, gint32 *out_rows, guint64 *visible,
+				size_t *nvisible, GError **error)
+{
+	RETURN_EFAULT_IF(tr==NULL, false, error);
+	RETURN_EFAULT_IF(ys==NULL, false, error);
+	RETURN_EFAULT_IF(out_cols==NULL || out_rows==NULL || visible==NULL, false, error);
+	RETURN_EINVAL_IF(level>=BLOT_SIMD_LEVEL_MAX, false, error);
+
+	blot_data_type x_elem = BLOT_DATA_X_ELEM(data_type);
+	blot_data_type y_elem = BLOT_DATA_Y_ELEM(data_type);
+	RETURN_ERRORx(x_elem>=BLOT_TRANSFORM_TYPE_MAX || y_elem>=BLOT_TRANSFORM_TYPE_MAX,
+		      false, error, EINVAL, "unexpected data type %02x", data_type);
+
+	/* never use instructions the CPU does not have */
+	level = min_t(unsigned, level, blot_cpu_simd_level());
+
+	/* fall back to the best thing we have */
+	while (level && !blot_transform_fns[level])
+		level --;
+
+	blot_transform_fn fn = blot_transform_fns[level];
+	memset(visible, 0, BLOT_TRANSFORM_MASK_WORDS(count) * sizeof(*visible));
+
+	double xbuf[BLOT_TRANSFORM_BATCH] __aligned64;
+	double ybuf[BLOT_TRANSFORM_BATCH] __aligned64;
+	size_t n = 0;
+
+	for (size_t bi=0; bi<count; bi+=BLOT_TRANSFORM_BATCH) {
+		unsigned bn = min_t(size_t, BLOT_TRANSFORM_BATCH, count - bi);
+
+		const double *x = xs
+			? blot_transform_load_fns[x_elem](xs, first + bi, bn, xbuf)
+			: blot_transform_load_index(first + bi, bn, xbuf);
+		const double *y = blot_transform_load_fns[y_elem](ys, first + bi, bn, ybuf);
+
+		n += fn(tr, x, y, bn, out_cols + bi, out_rows + bi, visible + bi/64);
+	}
+
+	if (nvisible)
+		*nvisible = n;
+
+	return true;
+}
+
+bool blot_transform_points(const blot_transform *tr, blot_data_type data_type,
+			   const void *xs, const void *ys, size_t first, size_t count,
+			   gint32 *out_cols, gint32 *out_rows, guint64 *visible,
+			   size_t *nvisible, GError **error)
+{
+	return blot_transform_points_simd(blot_cpu_simd_level(), tr, data_type,
+					  xs, ys, first, count,
+					  out_cols, out_rows, visible, nvisible, error);
+}
@@ -3,6 +3,8 @@
 
 #include "blot_utils.h"
 #include <stdio.h>
+#include <math.h>
+#include <stdbool.h>
 
 unsigned blot_env_to_uint(const char *name, unsigned dflt)
 {
@@ -17,14 +19,223 @@ unsigned blot_env_to_uint(const char *name, unsigned dflt)
 	return num;
 }
 
+/* number formatting
+ *
+ * A number is printed as the first of "%.3f", "%.2f", "%.1f", "%g", "%.3g"
+ * and "%3.g" that fits in room, exactly as snprintf() would print it in the
+ * C locale.  Rather than printing each one to find out, every format is
+ * rounded to a scaled integer, which gives its length up front, and only
+ * the one that fits is written out, without looking at the locale.  A value
+ * that is too large for that, or that is too close to a rounding tie for a
+ * double to tell which way it goes, is printed with snprintf() instead. */
+
+typedef struct blot_number {
+	bool exact;             // false if only len is known, and it is a lower bound
+	bool neg;
+	bool sci;               // has an exponent
+	guint64 ipart, fpart;   // digits before and after the point
+	unsigned fdigits;       // digits in fpart, there is no point if 0
+	int exp;
+	unsigned len;           // characters, not counting the padding
+} blot_number;
+
+static const double blot_pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const guint64 blot_pow10_u64[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+	10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+};
+
+static inline unsigned blot_count_digits(guint64 v)
+{
+	unsigned n = 1;
+	while (v >= 10) {
+		v /= 10;
+		n ++;
+	}
+	return n;
+}
+
+/* round a * 10^scale to an integer, with ties to even like printf() does;
+ * false if that cannot be done exactly with one multiplication */
+static bool blot_round_scaled(double a, int scale, guint64 *out)
+{
+	if (scale < -22 || scale > 22)
+		return false;
+
+	/* one rounding, so s is within half an ulp of the true value */
+	double s = scale >= 0 ? a * blot_pow10[scale] : a / blot_pow10[-scale];
+	if (!(s < 0x1p52))
+		return false;
+
+	double r = floor(s);
+	double frac = s - r;
+	if (fabs(frac - 0.5) <= s * 0x1p-51)
+		return false;
+
+	*out = (guint64)r + (frac > 0.5);
+	return true;
+}
+
+static inline void blot_number_strip_zeros(blot_number *num)
+{
+	while (num->fdigits && !(num->fpart % 10)) {
+		num->fpart /= 10;
+		num->fdigits --;
+	}
+}
+
+static inline void blot_number_measure(blot_number *num)
+{
+	num->len = num->neg + blot_count_digits(num->ipart)
+		+ (num->fdigits ? 1 + num->fdigits : 0);
+
+	if (num->sci)
+		num->len += 2 + max_t(unsigned, 2, blot_count_digits(abs_t(int, num->exp)));
+
+	num->exact = true;
+}
+
+/* as "%.{prec}f" */
+static void blot_number_fixed(blot_number *num, double a, unsigned prec)
+{
+	guint64 r;
+	if (!blot_round_scaled(a, prec, &r)) {
+		/* too large, but a lower bound on the length can be enough */
+		if (a >= 1e12)
+			num->len = num->neg + 13 + 1 + prec;
+		return;
+	}
+
+	num->ipart = r / blot_pow10_u64[prec];
+	num->fpart = r % blot_pow10_u64[prec];
+	num->fdigits = prec;
+	blot_number_measure(num);
+}
+
+/* as "%.{prec}g" */
+static void blot_number_general(blot_number *num, double a, unsigned prec)
+{
+	if (a == 0) {
+		blot_number_measure(num);
+		return;
+	}
+
+	/* find the exponent of the first digit, log10() can be off by one */
+	int x = floor(log10(a));
+	guint64 r = 0;
+	for (int tries=0; ; tries++) {
+		if (tries == 2 || !blot_round_scaled(a, prec - 1 - x, &r))
+			return;
+
+		if (r < blot_pow10_u64[prec-1])
+			x --;
+		else if (r > blot_pow10_u64[prec])
+			x ++;
+		else
+			break;
+	}
+
+	/* rounded up to the next power of ten */
+	if (r == blot_pow10_u64[prec]) {
+		r = blot_pow10_u64[prec-1];
+		x ++;
+	}
+
+	if (x < -4 || x >= (int)prec) {
+		num->sci = true;
+		num->exp = x;
+		num->fdigits = prec - 1;
+	} else {
+		num->fdigits = prec - 1 - x;
+	}
+	num->ipart = r / blot_pow10_u64[num->fdigits];
+	num->fpart = r % blot_pow10_u64[num->fdigits];
+
+	blot_number_strip_zeros(num);
+	blot_number_measure(num);
+}
+
+static void blot_put_digits(char *p, guint64 v, unsigned n)
+{
+	while (n--) {
+		p[n] = '0' + v % 10;
+		v /= 10;
+	}
+}
+
+static void blot_number_write(char *p, const blot_number *num, unsigned width)
+{
+	for (unsigned pad = num->len; pad < width; pad++)
+		*p++ = ' ';
+
+	if (num->neg)
+		*p++ = '-';
+
+	unsigned n = blot_count_digits(num->ipart);
+	blot_put_digits(p, num->ipart, n);
+	p += n;
+
+	if (num->fdigits) {
+		*p++ = '.';
+		blot_put_digits(p, num->fpart, num->fdigits);
+		p += num->fdigits;
+	}
+
+	if (num->sci) {
+		*p++ = 'e';
+		*p++ = num->exp < 0 ? '-' : '+';
+		n = max_t(unsigned, 2, blot_count_digits(abs_t(int, num->exp)));
+		blot_put_digits(p, abs_t(int, num->exp), n);
+		p += n;
+	}
+
+	*p = 0;
+}
+
 int blot_format_number(char *p, unsigned room, double d_val)
 {
-	static const char **ff, *formats[] = {
-		"%.3f", "%.2f", "%.1f", "%g", "%.3g", "%3.g", NULL };
-	for (ff = formats; *ff; ff++) {
-		int rc = snprintf(p, (unsigned)room, *ff, d_val);
-		if (rc>0 && rc < room)
-			return rc;
+	static const struct {
+		const char *format;
+		bool general;
+		unsigned prec, width;
+	} formats[] = {
+		{ "%.3f", false, 3, 0 },
+		{ "%.2f", false, 2, 0 },
+		{ "%.1f", false, 1, 0 },
+		{ "%g",   true,  6, 0 },
+		{ "%.3g", true,  3, 0 },
+		{ "%3.g", true,  1, 3 },
+	};
+
+	double a = fabs(d_val);
+
+	for (unsigned fi=0; fi<ARRAY_SIZE(formats); fi++) {
+		blot_number num = { .neg = signbit(d_val) };
+
+		if (isfinite(d_val)) {
+			if (formats[fi].general)
+				blot_number_general(&num, a, formats[fi].prec);
+			else
+				blot_number_fixed(&num, a, formats[fi].prec);
+		}
+
+		unsigned len = max_t(unsigned, num.len, formats[fi].width);
+		if (len >= room)
+			continue;
+
+		if (!num.exact) {
+			int rc = snprintf(p, room, formats[fi].format, d_val);
+			if (rc>0 && rc < room)
+				return rc;
+			continue;
+		}
+
+		blot_number_write(p, &num, formats[fi].width);
+		return len;
 	}
 	return -1;
 }
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "blot_alloc.h"
+#include "blot_figure.h"
+#include "blot_axis.h"
+#include "blot_screen.h"
+#include "blot_parallel.h"
+#include "blot_error.h"
+
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+struct Counts {
+    size_t mallocs, reallocs, frees;
+};
+
+static gpointer count_malloc(gsize size, gpointer user_data)
+{
+    ((Counts*)user_data)->mallocs++;
+    return malloc(size);
+}
+
+static gpointer count_realloc(gpointer mem, gsize size, gpointer user_data)
+{
+    ((Counts*)user_data)->reallocs++;
+    return realloc(mem, size);
+}
+
+static void count_free(gpointer mem, gpointer user_data)
+{
+    ((Counts*)user_data)->frees++;
+    free(mem);
+}
+
+struct Figure {
+    std::vector<double> xs, ys;
+    blot_figure *fig{};
+
+    explicit Figure(size_t count) : xs(count), ys(count) {
+        GError *error = NULL;
+        for (size_t i = 0; i < count; i++) {
+            xs[i] = i;
+            ys[i] = sin(i / 10.0);
+        }
+        fig = blot_figure_new(&error);
+        EXPECT_TRUE(fig != NULL);
+        EXPECT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+        EXPECT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, count, xs.data(), ys.data(), 9, "sin", &error));
+        EXPECT_TRUE(blot_figure_scatter(fig, BLOT_DATA_DOUBLE, count, xs.data(), ys.data(), 10, "dots", &error));
+    }
+    ~Figure() { blot_figure_delete(fig); }
+};
+
+TEST(Alloc, custom_allocator)
+{
+    GError *error = NULL;
+    Counts counts{};
+    blot_allocator alloc = { count_malloc, count_realloc, count_free, &counts };
+
+    ASSERT_TRUE(blot_set_allocator(&alloc, &error)) << error->message;
+
+    {
+        Figure f(100);
+        // enough layers for the array of layers to grow
+        for (int i = 0; i < 3; i++)
+            ASSERT_TRUE(blot_figure_scatter(f.fig, BLOT_DATA_DOUBLE, f.xs.size(), f.xs.data(), f.ys.data(),
+                                            11 + i, "more", &error));
+        blot_screen *scr = blot_figure_render(f.fig, BLOT_RENDER_BRAILLE, &error);
+        ASSERT_TRUE(scr != NULL);
+        blot_screen_delete(scr);
+    }
+
+    ASSERT_GT(counts.mallocs, 0u);
+    ASSERT_GT(counts.reallocs, 0u);
+    ASSERT_EQ(counts.mallocs, counts.frees);
+
+    ASSERT_TRUE(blot_set_allocator(NULL, &error));
+}
+
+TEST(Alloc, allocator_in_use)
+{
+    GError *error = NULL;
+    Counts counts{};
+    blot_allocator alloc = { count_malloc, count_realloc, count_free, &counts };
+
+    gpointer mem = blot_malloc(10);
+    ASSERT_FALSE(blot_set_allocator(&alloc, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EBUSY);
+    g_clear_error(&error);
+    blot_free(mem);
+
+    blot_allocator missing = { count_malloc, NULL, count_free, &counts };
+    ASSERT_FALSE(blot_set_allocator(&missing, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    ASSERT_EQ(counts.mallocs, 0u);
+}
+
+TEST(Alloc, malloc_realloc_free)
+{
+    blot_mem_stats before, after;
+    blot_get_mem_stats(&before);
+
+    ASSERT_TRUE(blot_malloc(0) == NULL);
+    ASSERT_TRUE(blot_new(double, G_MAXSIZE / 2) == NULL);
+
+    guint8 *p = blot_new0(guint8, 100);
+    ASSERT_TRUE(p != NULL);
+    ASSERT_EQ((uintptr_t)p % 16, 0u);
+    for (int i = 0; i < 100; i++)
+        ASSERT_EQ(p[i], 0);
+
+    p = blot_renew(guint8, p, 1000);
+    ASSERT_TRUE(p != NULL);
+
+    blot_get_mem_stats(&after);
+    ASSERT_EQ(after.allocations - before.allocations, 2u);
+    ASSERT_EQ(after.bytes_allocated - before.bytes_allocated, 1100u);
+    ASSERT_EQ(after.bytes_in_use - before.bytes_in_use, 1000);
+    ASSERT_GE(after.peak_bytes, after.bytes_in_use);
+
+    ASSERT_TRUE(blot_realloc(p, 0) == NULL);
+    blot_get_mem_stats(&after);
+    ASSERT_EQ(after.bytes_in_use, before.bytes_in_use);
+
+    blot_reset_mem_stats();
+    blot_get_mem_stats(&after);
+    ASSERT_EQ(after.allocations, 0u);
+    ASSERT_EQ(after.peak_bytes, after.bytes_in_use);
+}
+
+TEST(Alloc, render_stats)
+{
+    GError *error = NULL;
+    Figure f(1000);
+
+    blot_mem_stats global_before, global_after, stats;
+    blot_get_mem_stats(&global_before);
+
+    blot_screen *scr = blot_figure_render(f.fig, BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW, &error);
+    ASSERT_TRUE(scr != NULL);
+    ASSERT_TRUE(blot_figure_get_render_mem_stats(f.fig, &stats, &error));
+
+    // what is left in use is the screen, which was handed to us, and the
+    // axes that the figure keeps for the next render
+    blot_get_mem_stats(&global_after);
+    ASSERT_GT(stats.allocations, 0u);
+    ASSERT_GT(stats.bytes_in_use, 0);
+    ASSERT_GT(stats.peak_bytes, stats.bytes_in_use);
+    ASSERT_GE(stats.bytes_allocated, (gsize)stats.peak_bytes);
+    ASSERT_EQ(global_after.bytes_in_use - global_before.bytes_in_use, stats.bytes_in_use);
+
+    blot_screen_delete(scr);
+    blot_get_mem_stats(&global_after);
+    ASSERT_EQ(global_after.bytes_in_use - global_before.bytes_in_use,
+              (gssize)(f.fig->x_axs->alloc_size + f.fig->y_axs->alloc_size));
+
+    // once a context has grown to size, rendering into it allocates nothing
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+    for (int i = 0; i < 3; i++)
+        ASSERT_TRUE(blot_figure_render_into(f.fig, &ctx, BLOT_RENDER_BRAILLE, &error));
+    ASSERT_TRUE(blot_figure_get_render_mem_stats(f.fig, &stats, &error));
+    ASSERT_EQ(stats.allocations, 0u);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+    blot_render_ctx_cleanup(&ctx);
+
+    ASSERT_FALSE(blot_figure_get_render_mem_stats(NULL, &stats, &error));
+    g_clear_error(&error);
+}
+
+static void alloc_chunk(void *data, unsigned chunk, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+        blot_free(blot_malloc(100));
+}
+
+TEST(Alloc, scope_follows_parallel_work)
+{
+    GError *error = NULL;
+    blot_mem_stats stats{};
+
+    blot_mem_stats *prev = blot_mem_scope_enter(&stats);
+    ASSERT_TRUE(blot_parallel_for(64, 1, alloc_chunk, NULL, &error));
+    blot_mem_scope_leave(prev);
+
+    // one per item, and one for the job when it is split across threads
+    ASSERT_GE(stats.allocations, 64u);
+    ASSERT_LE(stats.allocations, 65u);
+    ASSERT_GE(stats.peak_bytes, 100);
+
+    // nothing is counted once the scope is left
+    blot_free(blot_malloc(100));
+    ASSERT_LE(stats.allocations, 65u);
+}
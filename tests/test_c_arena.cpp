@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "blot_arena.h"
+#include "blot_canvas.h"
+#include "blot_axis.h"
+#include "blot_error.h"
+
+static bool aligned(const void *p)
+{
+    return ((uintptr_t)p % BLOT_ARENA_ALIGN) == 0;
+}
+
+TEST(Arena, alloc_is_aligned_and_distinct)
+{
+    GError *error = NULL;
+    blot_arena arena;
+    ASSERT_TRUE(blot_arena_init(&arena, &error));
+
+    guint8 *prev = NULL;
+    for (gsize size : {1, 7, 64, 65, 1000, 3}) {
+        guint8 *p = (guint8*)blot_arena_alloc(&arena, size, &error);
+        ASSERT_TRUE(p != NULL);
+        ASSERT_TRUE(aligned(p)) << "size=" << size;
+        memset(p, 0xAA, size);
+
+        if (prev) {
+            ASSERT_GE(p, prev + BLOT_ARENA_ALIGN);
+        }
+        prev = p;
+    }
+
+    ASSERT_EQ(arena.used, 64u + 64 + 64 + 128 + 1024 + 64);
+
+    blot_arena_release(&arena);
+    ASSERT_EQ(arena.used, 0u);
+    ASSERT_TRUE(arena.chunk == NULL);
+}
+
+TEST(Arena, grows_past_a_chunk)
+{
+    GError *error = NULL;
+    blot_arena arena;
+    ASSERT_TRUE(blot_arena_init(&arena, &error));
+
+    // more than fits in the first chunk, in small and oversized pieces
+    const gsize small = 1000;
+    for (unsigned i = 0; i < 3 * BLOT_ARENA_CHUNK_SIZE / small; i++) {
+        guint8 *p = (guint8*)blot_arena_alloc0(&arena, small, &error);
+        ASSERT_TRUE(p != NULL);
+        ASSERT_TRUE(aligned(p));
+        ASSERT_EQ(p[0], 0);
+        ASSERT_EQ(p[small-1], 0);
+        memset(p, 0x55, small);
+    }
+
+    guint8 *big = (guint8*)blot_arena_alloc(&arena, 10 * BLOT_ARENA_CHUNK_SIZE, &error);
+    ASSERT_TRUE(big != NULL);
+    ASSERT_TRUE(aligned(big));
+    memset(big, 0x55, 10 * BLOT_ARENA_CHUNK_SIZE);
+
+    // and it can be used again after a release
+    blot_arena_release(&arena);
+    ASSERT_TRUE(blot_arena_alloc(&arena, small, &error) != NULL);
+    blot_arena_release(&arena);
+}
+
+TEST(Arena, canvas_and_axis)
+{
+    GError *error = NULL;
+    blot_arena arena;
+    ASSERT_TRUE(blot_arena_init(&arena, &error));
+
+    blot_canvas *can = blot_canvas_new_in(&arena, 80, 20, BLOT_RENDER_BRAILLE, 9, &error);
+    ASSERT_TRUE(can != NULL);
+    ASSERT_TRUE(aligned(can->bitmap));
+    ASSERT_TRUE(blot_canvas_fits(can, 80, 20, BLOT_RENDER_BRAILLE));
+    blot_canvas_draw_point(can, 10, 10);
+    ASSERT_TRUE(blot_canvas_get(can, 10, 10));
+
+    blot_axis *axs = blot_axis_renew(NULL, &arena, false, true, 1, 80, -1, 1, NULL, &error);
+    ASSERT_TRUE(axs != NULL);
+    gsize used = arena.used;
+
+    // a smaller axis is built in place, a larger one is carved out anew
+    ASSERT_TRUE(blot_axis_renew(axs, &arena, false, true, 1, 40, -1, 1, NULL, &error) == axs);
+    ASSERT_EQ(arena.used, used);
+    ASSERT_TRUE(blot_axis_renew(axs, &arena, false, true, 1, 160, -1, 1, NULL, &error) != NULL);
+    ASSERT_GT(arena.used, used);
+
+    // on error, nothing is freed, since the arena owns it
+    ASSERT_TRUE(blot_axis_renew(axs, &arena, false, true, 1, 0, -1, 1, NULL, &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_arena_release(&arena);
+}
+
+TEST(Arena, bad_arguments)
+{
+    GError *error = NULL;
+
+    ASSERT_FALSE(blot_arena_init(NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    ASSERT_TRUE(blot_arena_alloc(NULL, 10, &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+}
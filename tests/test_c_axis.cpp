@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "blot_axis.h"
+#include "blot_alloc.h"
 #include "blot_error.h"
 
 TEST(Axis, alloc_new_delete)
@@ -84,3 +85,38 @@ TEST(Axis, new_invalid_data_range)
     ASSERT_TRUE(error != NULL);
     g_clear_error(&error);
 }
+
+TEST(Axis, renew_reuses_matching)
+{
+    GError *error = NULL;
+    blot_axis *axis = blot_axis_renew(NULL, NULL, true, true, 1, 1000, -5, 5, NULL, &error);
+    ASSERT_TRUE(axis != NULL);
+    unsigned at = 0;
+    while (!blot_axis_get_tick_at(axis, at, &error))
+        at++;
+    const blot_axis_tick *tick = blot_axis_get_tick_at(axis, at, &error);
+
+    // same arguments, so nothing is built again
+    blot_mem_stats stats{};
+    blot_mem_stats *prev = blot_mem_scope_enter(&stats);
+    ASSERT_TRUE(blot_axis_renew(axis, NULL, true, true, 1, 1000, -5, 5, NULL, &error) == axis);
+    blot_mem_scope_leave(prev);
+    ASSERT_EQ(stats.allocations, 0u);
+    ASSERT_TRUE(blot_axis_get_tick_at(axis, at, &error) == tick);
+    ASSERT_TRUE(blot_axis_matches(axis, true, true, 1, 1000, -5, 5, NULL));
+
+    // any difference is built from scratch
+    ASSERT_FALSE(blot_axis_matches(axis, true, true, 1, 1000, -5, 6, NULL));
+    axis = blot_axis_renew(axis, NULL, true, true, 1, 1000, -5, 6, NULL, &error);
+    ASSERT_TRUE(axis != NULL);
+    ASSERT_EQ(axis->data_max, 6);
+
+    char *labels[] = { (char*)"a", (char*)"b", (char*)"c" };
+    blot_strv strv_labels = { .count = 3, .strings = labels };
+    ASSERT_FALSE(blot_axis_matches(axis, true, true, 1, 1000, -5, 6, &strv_labels));
+    axis = blot_axis_renew(axis, NULL, true, true, 1, 1000, -5, 6, &strv_labels, &error);
+    ASSERT_TRUE(axis != NULL);
+    ASSERT_TRUE(blot_axis_matches(axis, true, true, 1, 1000, -5, 6, &strv_labels));
+
+    blot_axis_delete(axis);
+}
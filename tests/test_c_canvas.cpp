@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 #include "blot_canvas.h"
+#include "blot_alloc.h"
 #include "blot_error.h"
 
 TEST(Canvas, alloc_new_delete)
@@ -88,6 +94,77 @@ TEST(Canvas, draw_line)
     blot_canvas_delete(canvas);
 }
 
+/* the whole line walked end to end, dropping the pixels that are off canvas */
+static void reference_line(blot_canvas *can, int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+    int64_t dx = std::llabs(x1 - x0), dy = std::llabs(y1 - y0);
+    int sx = x1 < x0 ? -1 : 1, sy = y1 < y0 ? -1 : 1;
+    bool x_major = dx >= dy;
+    int64_t da = x_major ? dx : dy, db = x_major ? dy : dx;
+
+    for (int64_t k = 0; k <= da; k++) {
+        int64_t f = da ? (2*k*db + da) / (2*da) : 0;
+        int64_t x = x0 + sx * (x_major ? k : f);
+        int64_t y = y0 + sy * (x_major ? f : k);
+        if (x >= 0 && y >= 0 && x < can->dim.cols && y < can->dim.rows)
+            blot_canvas_set(can, x, y, 1);
+    }
+}
+
+TEST(Canvas, draw_line_clipped)
+{
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        blot_canvas *fast = blot_canvas_new(20, 10, flags, 1, &error);
+        ASSERT_TRUE(fast != NULL);
+        blot_canvas *slow = blot_canvas_new(20, 10, flags, 1, &error);
+        ASSERT_TRUE(slow != NULL);
+
+        /* end points anywhere around the canvas, so that lines get
+         * clipped on every edge, or are not visible at all */
+        srand(flags + 1);
+        for (int i = 0; i < 5000; i++) {
+            memset(fast->bitmap, 0, fast->bitmap_bytes);
+            memset(slow->bitmap, 0, slow->bitmap_bytes);
+
+            int64_t x0 = (rand() % 160) - 60, y0 = (rand() % 120) - 40;
+            int64_t x1 = (rand() % 160) - 60, y1 = (rand() % 120) - 40;
+
+            blot_canvas_draw_line(fast, x0, y0, x1, y1);
+            reference_line(slow, x0, y0, x1, y1);
+
+            ASSERT_EQ(memcmp(fast->bitmap, slow->bitmap, fast->bitmap_bytes), 0)
+                << "flags=" << flags << " line " << x0 << "," << y0 << " -> " << x1 << "," << y1;
+        }
+
+        blot_canvas_delete(fast);
+        blot_canvas_delete(slow);
+    }
+}
+
+TEST(Canvas, draw_line_far_off_canvas)
+{
+    GError *error = NULL;
+    blot_canvas *canvas = blot_canvas_new(10, 10, BLOT_RENDER_NONE, 1, &error);
+    ASSERT_TRUE(canvas != NULL);
+
+    // a huge horizontal line only draws the row it is on
+    blot_canvas_draw_line(canvas, -1e12, 4, 1e12, 4);
+    for (int x = 0; x < 10; x++)
+        for (int y = 0; y < 10; y++)
+            ASSERT_EQ(blot_canvas_get(canvas, x, y), y == 4) << x << "," << y;
+
+    // lines that never cross the canvas draw nothing
+    memset(canvas->bitmap, 0, canvas->bitmap_bytes);
+    blot_canvas_draw_line(canvas, -1e12, -1e12, -1e12 + 5, 1e12);
+    blot_canvas_draw_line(canvas, 20, -5, 40, 100);
+    blot_canvas_draw_line(canvas, NAN, 0, 5, 5);
+    for (size_t i = 0; i < canvas->bitmap_bytes; i++)
+        ASSERT_EQ(canvas->bitmap[i], 0) << i;
+
+    blot_canvas_delete(canvas);
+}
+
 TEST(Canvas, fill_rect)
 {
     GError *error = NULL;
@@ -109,3 +186,432 @@ TEST(Canvas, fill_rect)
 
     blot_canvas_delete(canvas);
 }
+
+TEST(Canvas, fill_rect_spans)
+{
+    /* odd sizes, so that rows of the 1-bit layout do not start on a byte */
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        blot_canvas *fast = blot_canvas_new(37, 13, flags, 1, &error);
+        ASSERT_TRUE(fast != NULL);
+        blot_canvas *slow = blot_canvas_new(37, 13, flags, 1, &error);
+        ASSERT_TRUE(slow != NULL);
+
+        unsigned cols = fast->dim.cols, rows = fast->dim.rows;
+
+        srand(flags + 7);
+        for (int i = 0; i < 5000; i++) {
+            memset(fast->bitmap, 0, fast->bitmap_bytes);
+            memset(slow->bitmap, 0, slow->bitmap_bytes);
+
+            /* a few go past the edges, or wrap around to huge values */
+            unsigned x0 = rand() % (cols + 8), x1 = rand() % (cols + 8);
+            unsigned y0 = rand() % (rows + 8), y1 = rand() % (rows + 8);
+            if (i % 17 == 0)
+                y1 = -1;
+
+            blot_canvas_fill_rect(fast, x0, y0, x1, y1);
+            for (unsigned y = std::min(y0, y1); y <= std::min(std::max(y0, y1), rows); y++)
+                for (unsigned x = std::min(x0, x1); x <= std::min(std::max(x0, x1), cols); x++)
+                    blot_canvas_set(slow, x, y, 1);
+
+            ASSERT_EQ(memcmp(fast->bitmap, slow->bitmap, fast->bitmap_bytes), 0)
+                << "flags=" << flags << " rect " << x0 << "," << y0 << " -> " << x1 << "," << y1;
+        }
+
+        blot_canvas_delete(fast);
+        blot_canvas_delete(slow);
+    }
+}
+
+TEST(Canvas, draw_line_axis_aligned)
+{
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        blot_canvas *fast = blot_canvas_new(21, 11, flags, 1, &error);
+        ASSERT_TRUE(fast != NULL);
+        blot_canvas *slow = blot_canvas_new(21, 11, flags, 1, &error);
+        ASSERT_TRUE(slow != NULL);
+
+        srand(flags + 3);
+        for (int i = 0; i < 2000; i++) {
+            memset(fast->bitmap, 0, fast->bitmap_bytes);
+            memset(slow->bitmap, 0, slow->bitmap_bytes);
+
+            int64_t a0 = (rand() % 80) - 20, a1 = (rand() % 80) - 20, b = (rand() % 80) - 20;
+            if (i % 2) {
+                blot_canvas_draw_line(fast, a0, b, a1, b);
+                reference_line(slow, a0, b, a1, b);
+            } else {
+                blot_canvas_draw_line(fast, b, a0, b, a1);
+                reference_line(slow, b, a0, b, a1);
+            }
+
+            ASSERT_EQ(memcmp(fast->bitmap, slow->bitmap, fast->bitmap_bytes), 0)
+                << "flags=" << flags << " i=" << i << " " << a0 << ".." << a1 << " @ " << b;
+        }
+
+        blot_canvas_delete(fast);
+        blot_canvas_delete(slow);
+    }
+}
+
+TEST(Canvas, merge)
+{
+    /* odd sizes, so that the vector loops leave a tail */
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+            GError *error = NULL;
+            blot_canvas *dst = blot_canvas_new(101, 37, flags, 1, &error);
+            ASSERT_TRUE(dst != NULL);
+            blot_canvas *src = blot_canvas_new(101, 37, flags, 2, &error);
+            ASSERT_TRUE(src != NULL);
+
+            srand(level + flags);
+            for (gsize i = 0; i < dst->bitmap_bytes; i++) {
+                dst->bitmap[i] = rand();
+                src->bitmap[i] = rand();
+            }
+
+            std::vector<guint8> exp(dst->bitmap_bytes);
+            for (gsize i = 0; i < dst->bitmap_bytes; i++)
+                exp[i] = dst->bitmap[i] | src->bitmap[i];
+
+            ASSERT_TRUE(blot_canvas_merge_simd((blot_simd_level)level, dst, src, &error));
+            ASSERT_TRUE(error == NULL);
+            ASSERT_EQ(memcmp(dst->bitmap, exp.data(), dst->bitmap_bytes), 0)
+                << "flags=" << flags << " level=" << level;
+
+            blot_canvas_delete(dst);
+            blot_canvas_delete(src);
+        }
+    }
+}
+
+TEST(Canvas, merge_mismatch)
+{
+    GError *error = NULL;
+    blot_canvas *a = blot_canvas_new(10, 10, BLOT_RENDER_NONE, 1, &error);
+    blot_canvas *b = blot_canvas_new(10, 11, BLOT_RENDER_NONE, 1, &error);
+    blot_canvas *c = blot_canvas_new(5, 10, BLOT_RENDER_BRAILLE, 1, &error);
+    ASSERT_TRUE(a && b && c);
+
+    ASSERT_FALSE(blot_canvas_merge(a, b, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+
+    /* same number of pixels, but a different layout */
+    ASSERT_FALSE(blot_canvas_merge(a, c, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_canvas_merge(a, NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_canvas_delete(a);
+    blot_canvas_delete(b);
+    blot_canvas_delete(c);
+}
+
+/* every pixel of a sparse canvas is the same as in a dense one that was
+ * drawn the same way */
+static void expect_same_pixels(const blot_canvas *sparse, const blot_canvas *dense, int i)
+{
+    for (unsigned y = 0; y < dense->dim.rows; y++)
+        for (unsigned x = 0; x < dense->dim.cols; x++)
+            ASSERT_EQ(blot_canvas_get(sparse, x, y), blot_canvas_get(dense, x, y))
+                << "flags=" << dense->flags << " i=" << i << " at " << x << "," << y;
+}
+
+TEST(Canvas, sparse_matches_dense)
+{
+    /* odd sizes, so that the last tiles are only partly on the canvas */
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        blot_canvas *dense = blot_canvas_new(101, 37, flags, 1, &error);
+        ASSERT_TRUE(dense != NULL);
+        blot_canvas *sparse = blot_canvas_new(101, 37, flags | BLOT_RENDER_SPARSE, 1, &error);
+        ASSERT_TRUE(sparse != NULL);
+        ASSERT_TRUE(sparse->tiles != NULL);
+        ASSERT_EQ(sparse->bitmap_bytes, 0u);
+
+        int cols = dense->dim.cols, rows = dense->dim.rows;
+
+        srand(flags + 5);
+        for (int i = 0; i < 200; i++) {
+            blot_canvas_clear(dense);
+            blot_canvas_clear(sparse);
+            ASSERT_EQ(sparse->tiles->count, 0u);
+
+            for (int k = 0; k < 3; k++) {
+                int64_t x0 = (rand() % (cols + 40)) - 20, y0 = (rand() % (rows + 40)) - 20;
+                int64_t x1 = (rand() % (cols + 40)) - 20, y1 = (rand() % (rows + 40)) - 20;
+                blot_canvas_draw_line(dense, x0, y0, x1, y1);
+                blot_canvas_draw_line(sparse, x0, y0, x1, y1);
+
+                unsigned rx0 = rand() % (cols + 8), rx1 = rand() % (cols + 8);
+                unsigned ry0 = rand() % (rows + 8), ry1 = rand() % (rows + 8);
+                blot_canvas_fill_rect(dense, rx0, ry0, rx1, ry1);
+                blot_canvas_fill_rect(sparse, rx0, ry0, rx1, ry1);
+
+                unsigned px = rand() % cols, py = rand() % rows;
+                blot_canvas_draw_point(dense, px, py);
+                blot_canvas_draw_point(sparse, px, py);
+                blot_canvas_set(dense, px, (py + 1) % rows, 0);
+                blot_canvas_set(sparse, px, (py + 1) % rows, 0);
+            }
+
+            expect_same_pixels(sparse, dense, i);
+            if (HasFatalFailure())
+                break;
+        }
+
+        blot_canvas_delete(dense);
+        blot_canvas_delete(sparse);
+    }
+}
+
+TEST(Canvas, blocks_match_dense)
+{
+    /* odd sizes, so that the last blocks are only partly on the canvas */
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_DONT_INVERT_Y_AXIS,
+    };
+
+    for (blot_render_flags flags : variants) {
+        GError *error = NULL;
+        blot_canvas *dense = blot_canvas_new(101, 37, flags, 1, &error);
+        ASSERT_TRUE(dense != NULL);
+        blot_canvas *blocked = blot_canvas_new(101, 37, flags | BLOT_RENDER_BLOCKS, 1, &error);
+        ASSERT_TRUE(blocked != NULL);
+        ASSERT_TRUE(blocked->blocks != NULL);
+        ASSERT_EQ(blocked->bitmap_bytes, (gsize)blocked->blocks->cols * blocked->blocks->rows * 8);
+
+        int cols = dense->dim.cols, rows = dense->dim.rows;
+        int cell_cols = cols / (flags & BLOT_RENDER_BRAILLE ? 2 : 1);
+        int cell_rows = rows / (flags & BLOT_RENDER_BRAILLE ? 4 : 1);
+
+        srand(flags + 9);
+        for (int i = 0; i < 200; i++) {
+            blot_canvas_clear(dense);
+            blot_canvas_clear(blocked);
+
+            for (int k = 0; k < 3; k++) {
+                int64_t x0 = (rand() % (cols + 40)) - 20, y0 = (rand() % (rows + 40)) - 20;
+                int64_t x1 = (rand() % (cols + 40)) - 20, y1 = (rand() % (rows + 40)) - 20;
+                blot_canvas_draw_line(dense, x0, y0, x1, y1);
+                blot_canvas_draw_line(blocked, x0, y0, x1, y1);
+
+                // vertical lines and bars
+                blot_canvas_draw_line(dense, x0, y0, x0, y1);
+                blot_canvas_draw_line(blocked, x0, y0, x0, y1);
+
+                unsigned rx0 = rand() % (cols + 8), rx1 = rand() % (cols + 8);
+                unsigned ry0 = rand() % (rows + 8), ry1 = rand() % (rows + 8);
+                blot_canvas_fill_rect(dense, rx0, ry0, rx1, ry1);
+                blot_canvas_fill_rect(blocked, rx0, ry0, rx1, ry1);
+
+                unsigned px = rand() % cols, py = rand() % rows;
+                blot_canvas_draw_point(dense, px, py);
+                blot_canvas_draw_point(blocked, px, py);
+                blot_canvas_set(dense, px, (py + 1) % rows, 0);
+                blot_canvas_set(blocked, px, (py + 1) % rows, 0);
+            }
+
+            expect_same_pixels(blocked, dense, i);
+            for (int y = 0; y < cell_rows; y++)
+                for (int x = 0; x < cell_cols; x++)
+                    ASSERT_EQ(blot_canvas_get_cell(blocked, x, y), blot_canvas_get_cell(dense, x, y))
+                        << "flags=" << flags << " i=" << i << " at " << x << "," << y;
+            if (HasFatalFailure())
+                break;
+        }
+
+        // blocked canvases merge with each other, and nothing else
+        blot_canvas *other = blot_canvas_new(101, 37, flags | BLOT_RENDER_BLOCKS, 1, &error);
+        ASSERT_TRUE(other != NULL);
+        blot_canvas_draw_line(other, 0, 0, cols - 1, rows - 1);
+        blot_canvas_draw_line(dense, 0, 0, cols - 1, rows - 1);
+        ASSERT_TRUE(blot_canvas_merge(blocked, other, &error));
+        expect_same_pixels(blocked, dense, -1);
+
+        ASSERT_FALSE(blot_canvas_merge(dense, other, &error));
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+
+        blot_canvas_delete(other);
+        blot_canvas_delete(dense);
+        blot_canvas_delete(blocked);
+    }
+
+    // there is only one layout per canvas
+    GError *error = NULL;
+    for (blot_render_flags flags : { BLOT_RENDER_SPARSE, BLOT_RENDER_INDEXED }) {
+        blot_canvas *can = blot_canvas_new(10, 10, flags | BLOT_RENDER_BLOCKS, 1, &error);
+        ASSERT_TRUE(can == NULL);
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+    }
+}
+
+TEST(Canvas, sparse_only_allocates_what_is_drawn)
+{
+    GError *error = NULL;
+    blot_canvas *can = blot_canvas_new(1000, 1000, BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE, 1, &error);
+    ASSERT_TRUE(can != NULL);
+
+    blot_mem_stats before, after;
+    blot_get_mem_stats(&before);
+
+    // one short line, which crosses into a second tile
+    blot_canvas_draw_line(can, 60, 10, 70, 12);
+    ASSERT_EQ(can->tiles->count, 2u);
+
+    blot_get_mem_stats(&after);
+    ASSERT_EQ(after.bytes_in_use - before.bytes_in_use, 2 * BLOT_CANVAS_TILE_BYTES);
+
+    // clearing keeps the tiles for the next draw
+    blot_canvas_clear(can);
+    ASSERT_EQ(can->tiles->count, 0u);
+    ASSERT_FALSE(blot_canvas_get(can, 60, 10));
+    blot_canvas_draw_line(can, 600, 10, 700, 12);
+    blot_get_mem_stats(&after);
+    ASSERT_EQ(after.bytes_in_use - before.bytes_in_use, 2 * BLOT_CANVAS_TILE_BYTES);
+
+    blot_canvas_delete(can);
+}
+
+TEST(Canvas, sparse_merge)
+{
+    for (blot_render_flags flags : { BLOT_RENDER_SPARSE, BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE }) {
+        GError *error = NULL;
+        blot_canvas *dst = blot_canvas_new(150, 40, flags, 1, &error);
+        blot_canvas *src = blot_canvas_new(150, 40, flags, 2, &error);
+        blot_canvas *exp = blot_canvas_new(150, 40, (blot_render_flags)(flags & ~BLOT_RENDER_SPARSE), 1, &error);
+        ASSERT_TRUE(dst && src && exp);
+
+        srand(flags);
+        for (int i = 0; i < 50; i++) {
+            unsigned x = rand() % dst->dim.cols, y = rand() % dst->dim.rows;
+            blot_canvas_draw_point(i % 2 ? dst : src, x, y);
+            blot_canvas_draw_point(exp, x, y);
+        }
+
+        ASSERT_TRUE(blot_canvas_merge(dst, src, &error));
+        expect_same_pixels(dst, exp, 0);
+
+        // sparse and dense canvases do not mix
+        ASSERT_FALSE(blot_canvas_merge(exp, src, &error));
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+
+        blot_canvas_delete(dst);
+        blot_canvas_delete(src);
+        blot_canvas_delete(exp);
+    }
+}
+
+TEST(Canvas, indexed_merge)
+{
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        blot_canvas *dst = blot_canvas_new(150, 40, flags | BLOT_RENDER_INDEXED, 1, &error);
+        blot_canvas *src = blot_canvas_new(150, 40, flags, 2, &error);
+        blot_canvas *exp = blot_canvas_new(150, 40, flags, 1, &error);
+        ASSERT_TRUE(dst && src && exp);
+
+        srand(flags + 1);
+        for (int i = 0; i < 50; i++) {
+            unsigned x = rand() % dst->dim.cols, y = rand() % dst->dim.rows;
+            blot_canvas_draw_point(i % 2 ? dst : src, x, y);
+            blot_canvas_draw_point(exp, x, y);
+        }
+
+        // what src drew is drawn by the layer drawing now
+        ASSERT_TRUE(blot_canvas_merge(dst, src, &error));
+        expect_same_pixels(dst, exp, 0);
+        for (gsize cell = 0; cell < dst->bitmap_bytes / 2; cell++)
+            ASSERT_EQ(dst->layers[cell], dst->bitmap[cell] ? 1 : 0) << cell;
+
+        // a later layer takes over the cells it draws in
+        dst->layer = 2;
+        ASSERT_TRUE(blot_canvas_set(dst, 0, 0, 1));
+        ASSERT_EQ(dst->layers[0], 2);
+        ASSERT_TRUE(blot_canvas_get(dst, 0, 0));
+        ASSERT_EQ(blot_canvas_get(dst, 1, 0), false);
+        ASSERT_TRUE(blot_canvas_set(dst, 0, 0, 0));
+        ASSERT_EQ(dst->layers[0], 0);
+
+        // nothing is merged out of an indexed canvas
+        ASSERT_FALSE(blot_canvas_merge(src, dst, &error));
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+
+        blot_canvas_delete(dst);
+        blot_canvas_delete(src);
+        blot_canvas_delete(exp);
+    }
+
+    // a canvas cannot be both indexed and sparse
+    GError *error = NULL;
+    blot_canvas *can = blot_canvas_new(10, 10, BLOT_RENDER_SPARSE | BLOT_RENDER_INDEXED, 1, &error);
+    ASSERT_TRUE(can == NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+}
+
+TEST(Canvas, shift_left)
+{
+    const blot_render_flags layouts[] = {
+        BLOT_RENDER_NONE, BLOT_RENDER_SPARSE, BLOT_RENDER_INDEXED, BLOT_RENDER_BLOCKS,
+    };
+
+    for (blot_render_flags braille : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        for (blot_render_flags layout : layouts) {
+            blot_render_flags flags = braille | layout;
+            GError *error = NULL;
+            blot_canvas *can = blot_canvas_new(101, 37, flags, 1, &error);
+            blot_canvas *exp = blot_canvas_new(101, 37, braille, 1, &error);
+            ASSERT_TRUE(can && exp);
+
+            unsigned cell_cols = braille ? 2 : 1;
+            unsigned cols = can->dim.cols, rows = can->dim.rows;
+
+            for (unsigned cells : { 0u, 1u, 7u, 50u, 100u, 101u, 500u }) {
+                blot_canvas_clear(can);
+                blot_canvas_clear(exp);
+
+                srand(flags + cells);
+                for (int i = 0; i < 20; i++) {
+                    unsigned x0 = rand() % cols, y0 = rand() % rows;
+                    unsigned x1 = rand() % cols, y1 = rand() % rows;
+                    blot_canvas_draw_line(can, x0, y0, x1, y1);
+
+                    // what stays on the canvas moves left, the rest is dropped
+                    unsigned shift = cells * cell_cols;
+                    if (shift >= cols)
+                        continue;
+                    blot_canvas *tmp = blot_canvas_new(101, 37, braille, 1, &error);
+                    blot_canvas_draw_line(tmp, x0, y0, x1, y1);
+                    for (unsigned y = 0; y < rows; y++)
+                        for (unsigned x = shift; x < cols; x++)
+                            if (blot_canvas_get(tmp, x, y))
+                                blot_canvas_set(exp, x - shift, y, 1);
+                    blot_canvas_delete(tmp);
+                }
+
+                blot_canvas_shift_left(can, cells);
+                expect_same_pixels(can, exp, cells);
+                if (HasFatalFailure())
+                    break;
+            }
+
+            blot_canvas_delete(can);
+            blot_canvas_delete(exp);
+        }
+    }
+}
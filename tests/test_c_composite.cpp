@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "blot_composite.h"
+#include "blot_canvas.h"
+#include "blot_braille.h"
+#include "blot_error.h"
+
+/* a few sparse canvases, and one that is mostly full */
+static std::vector<blot_canvas*> random_canvases(unsigned count, unsigned cols, unsigned rows,
+                                                 blot_render_flags flags)
+{
+    std::vector<blot_canvas*> cans;
+    for (unsigned ci = 0; ci < count; ci++) {
+        GError *error = NULL;
+        blot_canvas *can = blot_canvas_new(cols, rows, flags, ci + 1, &error);
+        EXPECT_TRUE(can != NULL);
+
+        unsigned points = ci == 1 ? can->dim.cols * can->dim.rows / 2 : can->dim.cols;
+        for (unsigned i = 0; i < points; i++)
+            blot_canvas_draw_point(can, rand() % can->dim.cols, rand() % can->dim.rows);
+
+        cans.push_back(can);
+    }
+    return cans;
+}
+
+/* the per-cell lookup the screen used to do */
+static void expect_row(const blot_composite_row &row, const std::vector<blot_canvas*> &cans,
+                       unsigned c_y, int level)
+{
+    bool empty = true;
+    for (unsigned c_x = 0; c_x < row.cols; c_x++) {
+        wchar_t top_cell = 0;
+        unsigned top_layer = 0;
+        for (unsigned ci = 0; ci < cans.size(); ci++) {
+            wchar_t cell = blot_canvas_get_cell(cans[ci], c_x, c_y);
+            if (!cell)
+                continue;
+            top_cell = cell;
+            top_layer = ci + 1;
+        }
+
+        ASSERT_EQ(row.layers[c_x], top_layer) << "level=" << level << " " << c_x << "," << c_y;
+        if (top_layer && (cans[0]->flags & BLOT_RENDER_BRAILLE)) {
+            ASSERT_EQ(BRAILLE_GLYPH_BASE + row.glyphs[c_x], (unsigned)top_cell);
+        }
+
+        if (top_layer) {
+            ASSERT_TRUE(blot_composite_block_used(&row, c_x)) << c_x << "," << c_y;
+            empty = false;
+        }
+    }
+    ASSERT_EQ(row.empty, empty);
+}
+
+static void expect_composite(blot_render_flags flags, unsigned count, unsigned cols, unsigned rows)
+{
+    srand(count * 1000 + cols + flags);
+    std::vector<blot_canvas*> cans = random_canvases(count, cols, rows, flags);
+
+    for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+        GError *error = NULL;
+        blot_composite_row row;
+        ASSERT_TRUE(blot_composite_row_init(&row, cols, &error));
+
+        for (unsigned c_y = 0; c_y < rows; c_y++) {
+            ASSERT_TRUE(blot_composite_row_merge_simd((blot_simd_level)level, &row,
+                                                      count, cans.data(), c_y, &error));
+            ASSERT_TRUE(error == NULL);
+            expect_row(row, cans, c_y, level);
+        }
+
+        blot_composite_row_cleanup(&row);
+    }
+
+    for (blot_canvas *can : cans)
+        blot_canvas_delete(can);
+}
+
+TEST(Composite, plain)
+{
+    expect_composite(BLOT_RENDER_NONE, 1, 10, 5);
+    expect_composite(BLOT_RENDER_NONE, 3, 77, 23);
+    expect_composite(BLOT_RENDER_NONE, 5, 300, 9);
+}
+
+TEST(Composite, braille)
+{
+    expect_composite(BLOT_RENDER_BRAILLE, 1, 10, 5);
+    expect_composite(BLOT_RENDER_BRAILLE, 3, 77, 23);
+    expect_composite(BLOT_RENDER_BRAILLE, 5, 300, 9);
+}
+
+TEST(Composite, sparse)
+{
+    /* wide enough for several tiles, and rows that end part way into one */
+    expect_composite(BLOT_RENDER_SPARSE, 3, 77, 23);
+    expect_composite(BLOT_RENDER_SPARSE, 5, 300, 70);
+    expect_composite(BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE, 3, 77, 23);
+    expect_composite(BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE, 5, 300, 40);
+}
+
+TEST(Composite, blocks)
+{
+    /* rows that end part way into a block, and wider than one gather */
+    expect_composite(BLOT_RENDER_BLOCKS, 3, 77, 23);
+    expect_composite(BLOT_RENDER_BLOCKS, 5, 300, 70);
+    expect_composite(BLOT_RENDER_BRAILLE | BLOT_RENDER_BLOCKS, 3, 77, 23);
+    expect_composite(BLOT_RENDER_BRAILLE | BLOT_RENDER_BLOCKS, 5, 300, 40);
+}
+
+TEST(Composite, indexed)
+{
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE }) {
+        GError *error = NULL;
+        const unsigned count = 4, cols = 150, rows = 30;
+
+        /* the same drawing, in a canvas per layer and in one shared canvas */
+        std::vector<blot_canvas*> cans;
+        blot_canvas *idx = blot_canvas_new(cols, rows, flags | BLOT_RENDER_INDEXED, 1, &error);
+        ASSERT_TRUE(idx != NULL);
+        ASSERT_TRUE(idx->layers != NULL);
+
+        srand(flags + 3);
+        for (unsigned ci = 0; ci < count; ci++) {
+            blot_canvas *can = blot_canvas_new(cols, rows, flags, ci + 1, &error);
+            ASSERT_TRUE(can != NULL);
+            cans.push_back(can);
+            idx->layer = ci + 1;
+
+            for (int i = 0; i < 20; i++) {
+                double x0 = rand() % can->dim.cols, y0 = rand() % can->dim.rows;
+                double x1 = rand() % can->dim.cols, y1 = rand() % can->dim.rows;
+                for (blot_canvas *c : { can, idx }) {
+                    blot_canvas_draw_line(c, x0, y0, x1, y1);
+                    blot_canvas_draw_point(c, x1, y0);
+                }
+            }
+            unsigned rx = rand() % (can->dim.cols / 2), ry = rand() % (can->dim.rows / 2);
+            for (blot_canvas *c : { can, idx })
+                blot_canvas_fill_rect(c, rx, ry, rx + 7, ry + 5);
+        }
+
+        blot_composite_row exp, row;
+        ASSERT_TRUE(blot_composite_row_init(&exp, cols, &error));
+        ASSERT_TRUE(blot_composite_row_init(&row, cols, &error));
+
+        for (unsigned c_y = 0; c_y < rows; c_y++) {
+            ASSERT_TRUE(blot_composite_row_merge(&exp, count, cans.data(), c_y, &error));
+            ASSERT_TRUE(blot_composite_row_merge(&row, 1, &idx, c_y, &error));
+            ASSERT_EQ(row.empty, exp.empty) << c_y;
+            ASSERT_EQ(0, memcmp(row.layers, exp.layers, cols)) << c_y;
+            ASSERT_EQ(0, memcmp(row.glyphs, exp.glyphs, cols)) << c_y;
+        }
+
+        // an indexed canvas is never merged with others
+        blot_canvas *both[] = { cans[0], idx };
+        ASSERT_FALSE(blot_composite_row_merge(&row, 2, both, 0, &error));
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+
+        blot_composite_row_cleanup(&exp);
+        blot_composite_row_cleanup(&row);
+        for (blot_canvas *can : cans)
+            blot_canvas_delete(can);
+        blot_canvas_delete(idx);
+    }
+}
+
+TEST(Composite, empty_blocks)
+{
+    /* only one cell is set, far from the start of the row */
+    GError *error = NULL;
+    blot_canvas *can = blot_canvas_new(200, 3, BLOT_RENDER_BRAILLE, 1, &error);
+    ASSERT_TRUE(can != NULL);
+    blot_canvas_draw_point(can, 2*150, 4);
+
+    blot_composite_row row;
+    ASSERT_TRUE(blot_composite_row_init(&row, 200, &error));
+
+    ASSERT_TRUE(blot_composite_row_merge(&row, 1, &can, 0, &error));
+    ASSERT_TRUE(row.empty);
+
+    ASSERT_TRUE(blot_composite_row_merge(&row, 1, &can, 1, &error));
+    ASSERT_FALSE(row.empty);
+    ASSERT_FALSE(blot_composite_block_used(&row, 0));
+    ASSERT_FALSE(blot_composite_block_used(&row, 64));
+    ASSERT_TRUE(blot_composite_block_used(&row, 150));
+    ASSERT_FALSE(blot_composite_block_used(&row, 199));
+    ASSERT_EQ(row.layers[150], 1);
+
+    /* a row past the end of the canvas is empty */
+    ASSERT_TRUE(blot_composite_row_merge(&row, 1, &can, 7, &error));
+    ASSERT_TRUE(row.empty);
+
+    blot_composite_row_cleanup(&row);
+    blot_canvas_delete(can);
+}
+
+TEST(Composite, bad_arguments)
+{
+    GError *error = NULL;
+    blot_composite_row row;
+
+    ASSERT_FALSE(blot_composite_row_init(&row, 0, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+
+    ASSERT_TRUE(blot_composite_row_init(&row, 10, &error));
+
+    std::vector<blot_canvas*> cans(BLOT_COMPOSITE_MAX_LAYERS + 1, NULL);
+    ASSERT_FALSE(blot_composite_row_merge(&row, cans.size(), cans.data(), 0, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_composite_row_merge(&row, 1, cans.data(), 0, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_composite_row_cleanup(&row);
+}
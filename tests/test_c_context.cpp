@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blot_context.h"
+#include "blot_color.h"
+#include "blot_figure.h"
+#include "blot_screen.h"
+#include "blot_terminal.h"
+#include "blot_error.h"
+
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+TEST(Context, init_and_configure)
+{
+    GError *error = NULL;
+    blot_context bctx;
+
+    ASSERT_TRUE(blot_context_init(&bctx, &error));
+    ASSERT_TRUE(bctx.color);
+    ASSERT_EQ(bctx.term.cols, 0u);
+    ASSERT_EQ(bctx.term.rows, 0u);
+
+    ASSERT_TRUE(blot_context_set_color(&bctx, false, &error));
+    ASSERT_FALSE(bctx.color);
+
+    ASSERT_TRUE(blot_context_set_term_size(&bctx, blot_dimensions{100, 30}, &error));
+    blot_dimensions dims{};
+    ASSERT_TRUE(blot_context_get_term_size(&bctx, &dims, &error));
+    ASSERT_EQ(dims.cols, 100u);
+    ASSERT_EQ(dims.rows, 30u);
+
+    // too small for a plot
+    ASSERT_FALSE(blot_context_set_term_size(&bctx, blot_dimensions{100, 2}, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, ERANGE);
+    g_clear_error(&error);
+    ASSERT_EQ(bctx.term.rows, 30u);
+
+    blot_context *dyn = blot_context_new(&error);
+    ASSERT_TRUE(dyn != NULL);
+    ASSERT_TRUE(dyn->color);
+    blot_context_delete(dyn);
+}
+
+TEST(Context, errors)
+{
+    GError *error = NULL;
+    blot_dimensions dims;
+
+    ASSERT_FALSE(blot_context_init(NULL, &error));
+    ASSERT_EQ(error->code, EFAULT);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_context_set_color(NULL, true, &error));
+    ASSERT_EQ(error->code, EFAULT);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_context_get_term_size(NULL, &dims, &error));
+    ASSERT_EQ(error->code, EFAULT);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_figure_set_context(NULL, NULL, &error));
+    ASSERT_EQ(error->code, EFAULT);
+    g_clear_error(&error);
+}
+
+/* one figure, with the data it plots */
+struct Figure {
+    std::vector<double> xs, ys;
+    blot_figure *fig{};
+
+    Figure(const blot_context *bctx, unsigned seed) : xs(300), ys(300) {
+        GError *error = NULL;
+        for (size_t i = 0; i < xs.size(); i++) {
+            xs[i] = i;
+            ys[i] = sin((i + seed) / 17.0) * (1 + seed % 5);
+        }
+        fig = blot_figure_new(&error);
+        EXPECT_TRUE(fig != NULL);
+        EXPECT_TRUE(blot_figure_set_context(fig, bctx, &error));
+        EXPECT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, xs.size(), xs.data(), ys.data(), 9, "sin", &error));
+        EXPECT_TRUE(blot_figure_scatter(fig, BLOT_DATA_DOUBLE, xs.size(), xs.data(), ys.data(), 10, "dots", &error));
+        EXPECT_TRUE(blot_figure_bar(fig, BLOT_DATA_DOUBLE, 30, xs.data(), ys.data(), 11, "bars", &error));
+    }
+    ~Figure() { blot_figure_delete(fig); }
+
+    std::string render(blot_render_flags flags) {
+        GError *error = NULL;
+        std::string text;
+        blot_screen *scr = blot_figure_render(fig, flags, &error);
+        if (!scr) {
+            ADD_FAILURE() << error->message;
+            g_clear_error(&error);
+            return text;
+        }
+        gsize size = 0;
+        const char *txt = blot_screen_get_utf8(scr, &size, &error);
+        if (txt)
+            text.assign(txt, size);
+        blot_screen_delete(scr);
+        return text;
+    }
+};
+
+TEST(Context, color_does_not_follow_global)
+{
+    blot_context color, plain;
+    ASSERT_TRUE(blot_context_init(&color, NULL));
+    ASSERT_TRUE(blot_context_init(&plain, NULL));
+    ASSERT_TRUE(blot_context_set_term_size(&color, blot_dimensions{80, 24}, NULL));
+    plain.term = color.term;
+    plain.color = false;
+
+    const blot_render_flags flags = (blot_render_flags)(BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW);
+    bool saved = have_color_support;
+
+    for (bool global : { true, false }) {
+        have_color_support = global;
+
+        std::string with = Figure(&color, 0).render(flags);
+        std::string without = Figure(&plain, 0).render(flags);
+        std::string escape(COL_FG_PREFIX);
+
+        ASSERT_NE(with.find(escape), std::string::npos);
+        ASSERT_EQ(without.find(escape), std::string::npos);
+    }
+
+    have_color_support = saved;
+}
+
+/* every thread renders its own figures, with a context of its own or one
+ * shared by all; each result has to match what one thread renders alone */
+TEST(Context, parallel_render_stress)
+{
+    (void)force_threads;
+
+    const unsigned thread_count = 8, renders = 250, variants = 4;
+
+    blot_context contexts[variants];
+    for (unsigned v = 0; v < variants; v++) {
+        ASSERT_TRUE(blot_context_init(&contexts[v], NULL));
+        ASSERT_TRUE(blot_context_set_color(&contexts[v], v & 1, NULL));
+        ASSERT_TRUE(blot_context_set_term_size(&contexts[v],
+                                               blot_dimensions{60 + 10 * v, 20 + 2 * v}, NULL));
+    }
+
+    auto flags_for = [](unsigned i) {
+        int flags = BLOT_RENDER_LEGEND_BELOW;
+        if (i & 1)
+            flags |= BLOT_RENDER_BRAILLE;
+        if (i & 2)
+            flags |= BLOT_RENDER_PARALLEL;
+        return (blot_render_flags)flags;
+    };
+
+    std::vector<std::string> expected(variants * 4);
+    for (unsigned v = 0; v < variants; v++)
+        for (unsigned f = 0; f < 4; f++)
+            expected[v * 4 + f] = Figure(&contexts[v], v).render(flags_for(f));
+
+    std::atomic<unsigned> mismatches{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            for (unsigned i = 0; i < renders; i++) {
+                unsigned v = (t + i) % variants, f = i % 4;
+                if (Figure(&contexts[v], v).render(flags_for(f)) != expected[v * 4 + f])
+                    mismatches++;
+            }
+        });
+    }
+    for (auto &th : threads)
+        th.join();
+
+    ASSERT_EQ(mismatches.load(), 0u);
+
+    // the color setting of each context shows in what was rendered
+    for (unsigned v = 0; v < variants; v++) {
+        bool has_fg = expected[v * 4].find(COL_FG_PREFIX) != std::string::npos;
+        ASSERT_EQ(has_fg, contexts[v].color);
+    }
+}
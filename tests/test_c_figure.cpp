@@ -303,3 +303,122 @@ TEST(Figure, add_plot_zero_count)
 
     blot_figure_delete(fig);
 }
+
+/* the limits a render ended up with are on the axes kept by the figure */
+static blot_xy_limits rendered_limits(blot_figure *fig, blot_render_ctx *ctx)
+{
+    GError *error = NULL;
+    blot_screen *scr = blot_figure_render_into(fig, ctx, BLOT_RENDER_NONE, &error);
+    EXPECT_TRUE(scr != NULL);
+    return (blot_xy_limits){ fig->x_axs->data_min, fig->x_axs->data_max,
+                             fig->y_axs->data_min, fig->y_axs->data_max };
+}
+
+TEST(Figure, limits_only_unset_axis)
+{
+    GError *error = NULL;
+    blot_figure *fig = blot_figure_new(&error);
+    ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 20, &error));
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+    const double xs[] = { 0, 10, 20, 30, 40 };
+    const double ys[] = { 0, 100, -100, 50, 1000 };
+    ASSERT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, 5, xs, ys, 1, "line", &error));
+
+    // all from the data, widened by 0.1%
+    blot_xy_limits lim = rendered_limits(fig, &ctx);
+    ASSERT_DOUBLE_EQ(lim.x_min, -0.04);
+    ASSERT_DOUBLE_EQ(lim.x_max, 40.04);
+    ASSERT_DOUBLE_EQ(lim.y_min, -101.1);
+    ASSERT_DOUBLE_EQ(lim.y_max, 1001.1);
+
+    // a fixed X is kept as is, and Y comes from all of the data
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 5, 25, &error));
+    lim = rendered_limits(fig, &ctx);
+    ASSERT_DOUBLE_EQ(lim.x_min, 5);
+    ASSERT_DOUBLE_EQ(lim.x_max, 25);
+    ASSERT_DOUBLE_EQ(lim.y_max, 1001.1);
+
+    // or only from the points that are visible
+    ASSERT_TRUE(blot_figure_set_y_autoscale_in_x(fig, true, &error));
+    lim = rendered_limits(fig, &ctx);
+    ASSERT_DOUBLE_EQ(lim.y_min, -100.2);
+    ASSERT_DOUBLE_EQ(lim.y_max, 100.2);
+
+    // and from all of them, if none are visible
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 100, 200, &error));
+    lim = rendered_limits(fig, &ctx);
+    ASSERT_DOUBLE_EQ(lim.y_max, 1001.1);
+
+    blot_render_ctx_cleanup(&ctx);
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, limits_follow_extended_layer)
+{
+    GError *error = NULL;
+    blot_figure *fig = blot_figure_new(&error);
+    ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 20, &error));
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+    double ys[100];
+    for (int i = 0; i < 100; i++)
+        ys[i] = 100 + i;
+    ASSERT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, 10, NULL, ys, 1, "line", &error));
+
+    blot_layer *lay = blot_figure_get_layer(fig, 0, &error);
+    ASSERT_TRUE(lay != NULL);
+    ASSERT_TRUE(blot_figure_get_layer(fig, 1, &error) == NULL);
+    g_clear_error(&error);
+
+    blot_xy_limits lim = rendered_limits(fig, &ctx);
+    ASSERT_NEAR(lim.y_max, 109, 0.01);
+
+    ASSERT_TRUE(blot_layer_extend(lay, 100, NULL, ys, &error));
+    lim = rendered_limits(fig, &ctx);
+    ASSERT_NEAR(lim.x_max, 99, 0.1);
+    ASSERT_NEAR(lim.y_max, 199, 0.1);
+    ASSERT_EQ(lay->y_lim.count, 100u);
+
+    blot_render_ctx_cleanup(&ctx);
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, axes_kept_while_unchanged)
+{
+    GError *error = NULL;
+    blot_figure *fig = blot_figure_new(&error);
+    ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 20, &error));
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 9, &error));
+    ASSERT_TRUE(blot_figure_set_y_limits(fig, -1, 1, &error));
+
+    double ys[10] = {};
+    ASSERT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, 10, NULL, ys, 1, "line", &error));
+
+    blot_screen *first = blot_figure_render(fig, BLOT_RENDER_NONE, &error);
+    ASSERT_TRUE(first != NULL);
+    blot_axis *x_axs = fig->x_axs, *y_axs = fig->y_axs;
+    blot_mem_stats first_mem = fig->render_mem;
+
+    // the axes of the last render are used again, without any allocation
+    blot_screen *second = blot_figure_render(fig, BLOT_RENDER_NONE, &error);
+    ASSERT_TRUE(second != NULL);
+    ASSERT_TRUE(fig->x_axs == x_axs);
+    ASSERT_TRUE(fig->y_axs == y_axs);
+    ASSERT_EQ(fig->render_mem.allocations + 2, first_mem.allocations);
+    ASSERT_EQ(first->data_used, second->data_used);
+    ASSERT_EQ(memcmp(first->data, second->data, first->data_used * sizeof(wchar_t)), 0);
+
+    // until the limits change
+    ASSERT_TRUE(blot_figure_set_y_limits(fig, -2, 2, &error));
+    blot_screen *third = blot_figure_render(fig, BLOT_RENDER_NONE, &error);
+    ASSERT_TRUE(third != NULL);
+    ASSERT_EQ(fig->y_axs->data_max, 2);
+
+    blot_screen_delete(first);
+    blot_screen_delete(second);
+    blot_screen_delete(third);
+    blot_figure_delete(fig);
+}
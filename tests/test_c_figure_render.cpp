@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "blot_terminal.h"
 #include "blot_figure.h"
 #include "blot_error.h"
@@ -200,3 +204,823 @@ TEST(Figure, render_layer_render_failure)
 
     blot_figure_delete(fig);
 }
+
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+static blot_figure * new_many_layer_figure(std::vector<std::vector<double>> &ys)
+{
+    GError *error = NULL;
+    blot_figure *fig = blot_figure_new(&error);
+    EXPECT_TRUE(fig != NULL);
+
+    blot_figure_set_screen_size(fig, 80, 40, &error);
+    EXPECT_TRUE(error == NULL);
+
+    const blot_plot_type types[] = { BLOT_SCATTER, BLOT_LINE, BLOT_BAR };
+
+    // layers keep a pointer to their label
+    static const char *labels[] = {
+        "layer0", "layer1", "layer2", "layer3", "layer4", "layer5",
+        "layer6", "layer7", "layer8", "layer9", "layer10", "layer11",
+    };
+
+    for (size_t li = 0; li < ys.size(); li++) {
+        const char *label = labels[li % G_N_ELEMENTS(labels)];
+        bool ok = blot_figure_plot(fig, types[li % 3], BLOT_DATA_DOUBLE,
+                                   ys[li].size(), NULL, ys[li].data(),
+                                   1 + (li % 6), label, &error);
+        EXPECT_TRUE(ok);
+        EXPECT_TRUE(error == NULL);
+    }
+
+    return fig;
+}
+
+static std::wstring render_text(blot_figure *fig, blot_render_flags flags)
+{
+    GError *error = NULL;
+    blot_screen *screen = blot_figure_render(fig, flags, &error);
+    EXPECT_TRUE(screen != NULL);
+    EXPECT_TRUE(error == NULL);
+    if (!screen)
+        return L"";
+
+    gsize len = 0;
+    const wchar_t *txt = blot_screen_get_text(screen, &len, &error);
+    std::wstring out(txt, len);
+    blot_screen_delete(screen);
+    return out;
+}
+
+TEST(Figure, render_parallel_matches_serial)
+{
+    (void)force_threads;
+
+    std::vector<std::vector<double>> ys(12);
+    srand(7);
+    for (size_t li = 0; li < ys.size(); li++) {
+        ys[li].resize(5000 + li * 100);
+        for (auto &y : ys[li])
+            y = (rand() % 2000) - 1000 + (double)li * 50;
+    }
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_DETAILS,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_NO_COLOR,
+    };
+
+    for (blot_render_flags flags : variants) {
+        std::wstring serial = render_text(fig, flags);
+        std::wstring parallel = render_text(fig, flags | BLOT_RENDER_PARALLEL);
+        ASSERT_FALSE(serial.empty());
+        ASSERT_TRUE(serial == parallel) << "flags=" << flags;
+    }
+
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, render_sparse_matches_dense)
+{
+    (void)force_threads;
+
+    std::vector<std::vector<double>> ys(12);
+    srand(11);
+    for (size_t li = 0; li < ys.size(); li++) {
+        ys[li].resize(li % 3 ? 50 : 3000);
+        for (auto &y : ys[li])
+            y = (rand() % 2000) - 1000 + (double)li * 50;
+    }
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_PARALLEL,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_DONT_INVERT_Y_AXIS,
+    };
+
+    for (blot_render_flags flags : variants) {
+        std::wstring dense = render_text(fig, flags);
+        std::wstring sparse = render_text(fig, flags | BLOT_RENDER_SPARSE);
+        ASSERT_FALSE(dense.empty());
+        ASSERT_TRUE(dense == sparse) << "flags=" << flags;
+    }
+
+    // a context keeps its tiles, so drawing the same again allocates nothing
+    GError *error = NULL;
+    blot_render_ctx ctx;
+    blot_mem_stats stats;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+    for (int i = 0; i < 3; i++)
+        ASSERT_TRUE(blot_figure_render_into(fig, &ctx, BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE, &error));
+    ASSERT_TRUE(blot_figure_get_render_mem_stats(fig, &stats, &error));
+    ASSERT_EQ(stats.allocations, 0u);
+    blot_render_ctx_cleanup(&ctx);
+
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, render_blocks_matches_dense)
+{
+    (void)force_threads;
+
+    std::vector<std::vector<double>> ys(6);
+    srand(17);
+    for (size_t li = 0; li < ys.size(); li++) {
+        // the first layer is big enough to be drawn in parallel chunks
+        ys[li].resize(li ? 300 + li * 100 : BLOT_LAYER_PARALLEL_MIN + 100);
+        for (auto &y : ys[li])
+            y = (rand() % 2000) - 1000 + (double)li * 50;
+    }
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_PARALLEL,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_DONT_INVERT_Y_AXIS,
+    };
+
+    for (blot_render_flags flags : variants) {
+        std::wstring dense = render_text(fig, flags);
+        std::wstring blocked = render_text(fig, flags | BLOT_RENDER_BLOCKS);
+        ASSERT_FALSE(dense.empty());
+        ASSERT_TRUE(dense == blocked) << "flags=" << flags;
+    }
+
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, render_indexed_matches_dense)
+{
+    (void)force_threads;
+
+    std::vector<std::vector<double>> ys(12);
+    srand(13);
+    for (size_t li = 0; li < ys.size(); li++) {
+        // the first layer is big enough to be drawn in parallel chunks
+        ys[li].resize(li ? 200 + li * 100 : BLOT_LAYER_PARALLEL_MIN + 100);
+        for (auto &y : ys[li])
+            y = (rand() % 2000) - 1000 + (double)li * 50;
+    }
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_PARALLEL,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_DONT_INVERT_Y_AXIS,
+    };
+
+    for (blot_render_flags flags : variants) {
+        std::wstring dense = render_text(fig, flags);
+        std::wstring indexed = render_text(fig, flags | BLOT_RENDER_INDEXED);
+        ASSERT_FALSE(dense.empty());
+        ASSERT_TRUE(dense == indexed) << "flags=" << flags;
+    }
+
+    // however many layers there are, they share one canvas
+    GError *error = NULL;
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+    ASSERT_TRUE(blot_figure_render_into(fig, &ctx, BLOT_RENDER_BRAILLE, &error));
+    ASSERT_EQ(ctx.can_count, ys.size());
+    ASSERT_TRUE(blot_figure_render_into(fig, &ctx, BLOT_RENDER_BRAILLE | BLOT_RENDER_INDEXED, &error));
+    ASSERT_TRUE(ctx.cans[0] != NULL);
+    for (gsize ci = 1; ci < ctx.can_count; ci++)
+        ASSERT_TRUE(ctx.cans[ci] == NULL) << ci;
+    blot_render_ctx_cleanup(&ctx);
+
+    // the canvases cannot be both indexed and sparse
+    blot_screen *screen = blot_figure_render(fig, BLOT_RENDER_INDEXED | BLOT_RENDER_SPARSE, &error);
+    ASSERT_TRUE(screen == NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, render_indexed_layer_limit)
+{
+    std::vector<std::vector<double>> ys(256, std::vector<double>(10, 1.0));
+    blot_figure *fig = new_many_layer_figure(ys);
+    GError *error = NULL;
+
+    blot_screen *screen = blot_figure_render(fig, BLOT_RENDER_INDEXED, &error);
+    ASSERT_TRUE(screen == NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+
+    blot_figure_delete(fig);
+}
+
+static std::wstring render_text_into(blot_figure *fig, blot_render_ctx *ctx, blot_render_flags flags)
+{
+    GError *error = NULL;
+    blot_screen *screen = blot_figure_render_into(fig, ctx, flags, &error);
+    EXPECT_TRUE(screen != NULL);
+    EXPECT_TRUE(error == NULL);
+    if (!screen)
+        return L"";
+
+    gsize len = 0;
+    const wchar_t *txt = blot_screen_get_text(screen, &len, &error);
+    return std::wstring(txt, len);
+}
+
+TEST(Figure, render_reuse)
+{
+    (void)force_threads;
+
+    std::vector<std::vector<double>> ys(3, std::vector<double>(200));
+    for (size_t li = 0; li < ys.size(); li++)
+        for (size_t i = 0; i < ys[li].size(); i++)
+            ys[li][i] = (double)((i * 7 + li * 13) % 100);
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    // fixed limits, so that changing one layer does not move the others
+    GError *error = NULL;
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 300, &error));
+    ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+    ASSERT_TRUE(blot_figure_plot_ring(fig, BLOT_LINE, BLOT_DATA_DOUBLE, 50, 4, "ring", &error));
+    blot_layer *ring = blot_figure_get_layer(fig, 3, &error);
+    ASSERT_TRUE(ring != NULL);
+
+    double rx[] = { 0, 100, 200 }, ry[] = { 10, 90, 10 };
+    ASSERT_TRUE(blot_layer_append(ring, 3, rx, ry, &error));
+
+    for (blot_render_flags base : { BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_DETAILS,
+                                    BLOT_RENDER_PARALLEL | BLOT_RENDER_LEGEND_BELOW,
+                                    BLOT_RENDER_BLOCKS | BLOT_RENDER_BRAILLE }) {
+        blot_render_flags flags = base | BLOT_RENDER_REUSE;
+        blot_render_ctx ctx;
+        ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+        // the first render draws everything, the second nothing
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_hits, 0u);
+        ASSERT_EQ(ctx.reuse_misses, 4u);
+
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_hits, 4u);
+        ASSERT_EQ(ctx.reuse_misses, 4u);
+
+        // data changed in place is only drawn again once it is touched
+        ys[1][10] = 99;
+        blot_layer_touch(blot_figure_get_layer(fig, 1, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_hits, 7u);
+        ASSERT_EQ(ctx.reuse_misses, 5u);
+
+        // appending to a ring draws it again, even once it no longer grows
+        double ax[50], ay[50];
+        for (int i = 0; i < 50; i++) {
+            ax[i] = 200 + i;
+            ay[i] = i;
+        }
+        ASSERT_TRUE(blot_layer_append(ring, 50, ax, ay, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_TRUE(blot_layer_append(ring, 1, ax, ay, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_hits, 13u);
+        ASSERT_EQ(ctx.reuse_misses, 7u);
+
+        // new limits change where everything is drawn
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, -10, 100, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_misses, 11u);
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+
+        // without the flag, nothing is reused or counted
+        gsize hits = ctx.reuse_hits, misses = ctx.reuse_misses;
+        ASSERT_TRUE(render_text_into(fig, &ctx, base) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_hits, hits);
+        ASSERT_EQ(ctx.reuse_misses, misses);
+
+        blot_render_ctx_cleanup(&ctx);
+    }
+
+    blot_figure_delete(fig);
+}
+
+TEST(Figure, render_reuse_new_figure)
+{
+    GError *error = NULL;
+    std::vector<double> xs(200), ys(200);
+    for (size_t i = 0; i < xs.size(); i++)
+        xs[i] = i;
+
+    const blot_render_flags base = BLOT_RENDER_BRAILLE;
+
+    for (blot_render_flags flags : { BLOT_RENDER_REUSE, BLOT_RENDER_SCROLL }) {
+        blot_render_ctx ctx;
+        ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+        // a new figure every frame over the same arrays, as the examples do; the
+        // layers can land where the last ones were, but never share their keys
+        for (int frame = 0; frame < 4; frame++) {
+            for (size_t i = 0; i < ys.size(); i++)
+                ys[i] = (double)((i * 7 + frame * 29) % 100);
+
+            blot_figure *fig = blot_figure_new(&error);
+            ASSERT_TRUE(fig != NULL);
+            ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+            ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 200, &error));
+            ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+            ASSERT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, ys.size(), xs.data(), ys.data(),
+                                         9, "line", &error));
+
+            // drawn once, then reused
+            for (int render = 0; render < 2; render++)
+                ASSERT_TRUE(render_text_into(fig, &ctx, base | flags) == render_text(fig, base))
+                    << flags << " " << frame;
+
+            blot_figure_delete(fig);
+        }
+
+        ASSERT_EQ(ctx.reuse_hits, 4u);
+        ASSERT_EQ(ctx.reuse_appends, 0u);
+        ASSERT_EQ(ctx.reuse_scrolls, 0u);
+        ASSERT_EQ(ctx.reuse_misses, 4u);
+
+        blot_render_ctx_cleanup(&ctx);
+    }
+}
+
+TEST(Figure, render_reuse_append)
+{
+    (void)force_threads;
+
+    GError *error = NULL;
+    std::vector<double> xs(1000), ys(1000);
+    for (size_t i = 0; i < xs.size(); i++) {
+        xs[i] = i;
+        ys[i] = (double)((i * 37) % 100);
+    }
+    std::vector<double> line_ys(ys);
+
+    blot_figure *fig = blot_figure_new(&error);
+    ASSERT_TRUE(fig != NULL);
+    ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 1000, &error));
+    ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+    ASSERT_TRUE(blot_figure_line(fig, BLOT_DATA_DOUBLE, 10, xs.data(), line_ys.data(), 9, "line", &error));
+    ASSERT_TRUE(blot_figure_scatter(fig, BLOT_DATA_(INT32,DOUBLE), 10, NULL, ys.data(), 10, "dots", &error));
+    ASSERT_TRUE(blot_figure_plot_ring(fig, BLOT_LINE, BLOT_DATA_DOUBLE, 100, 11, "ring", &error));
+
+    blot_layer *line = blot_figure_get_layer(fig, 0, &error);
+    blot_layer *dots = blot_figure_get_layer(fig, 1, &error);
+    blot_layer *ring = blot_figure_get_layer(fig, 2, &error);
+    ASSERT_TRUE(blot_layer_append(ring, 10, xs.data(), ys.data(), &error));
+
+    const blot_render_flags base = BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_DETAILS;
+    const blot_render_flags flags = base | BLOT_RENDER_REUSE;
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+    ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+    ASSERT_EQ(ctx.reuse_misses, 3u);
+
+    // points added to the end are drawn on top of the canvas of the last frame
+    for (size_t count = 20; count <= 90; count += 10) {
+        ASSERT_TRUE(blot_layer_extend(line, count, xs.data(), line_ys.data(), &error));
+        ASSERT_TRUE(blot_layer_extend(dots, count, NULL, ys.data(), &error));
+        ASSERT_TRUE(blot_layer_append(ring, 10, xs.data() + count - 10, ys.data() + count - 10, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+    }
+    ASSERT_EQ(ctx.reuse_appends, 3u * 8);
+    ASSERT_EQ(ctx.reuse_misses, 3u);
+
+    // once the ring drops points, it is drawn again
+    ASSERT_TRUE(blot_layer_append(ring, 20, xs.data() + 90, ys.data() + 90, &error));
+    ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+    ASSERT_EQ(ctx.reuse_hits, 2u);
+    ASSERT_EQ(ctx.reuse_misses, 4u);
+
+    // so is data changed in place, and everything once the limits change
+    line_ys[5] = 0;
+    blot_layer_touch(line);
+    ASSERT_TRUE(blot_layer_extend(dots, 100, NULL, ys.data(), &error));
+    ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+    ASSERT_EQ(ctx.reuse_appends, 3u * 8 + 1);
+    ASSERT_EQ(ctx.reuse_misses, 5u);
+
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 500, &error));
+    ASSERT_TRUE(blot_layer_extend(line, 100, xs.data(), line_ys.data(), &error));
+    ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+    ASSERT_EQ(ctx.reuse_appends, 3u * 8 + 1);
+    ASSERT_EQ(ctx.reuse_misses, 8u);
+
+    blot_render_ctx_cleanup(&ctx);
+    blot_figure_delete(fig);
+}
+
+/* a scatter or bar plot moves a braille cell per unit of X when the X
+ * window is half as many units wide as the canvas has pixels, so every
+ * scroll is by whole cells, and has to match drawing everything again */
+static unsigned scroll_window(void)
+{
+    GError *error = NULL;
+    double ys[] = { 0, 100 };
+    blot_figure *fig = blot_figure_new(&error);
+    EXPECT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+    EXPECT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+    EXPECT_TRUE(blot_figure_scatter(fig, BLOT_DATA_(INT32,DOUBLE), 2, NULL, ys, 9, "probe", &error));
+
+    blot_render_ctx ctx;
+    EXPECT_TRUE(blot_render_ctx_init(&ctx, &error));
+    EXPECT_TRUE(blot_figure_render_into(fig, &ctx, BLOT_RENDER_BRAILLE, &error) != NULL);
+    unsigned cols = ctx.cans[0]->dim.cols;
+    blot_render_ctx_cleanup(&ctx);
+    blot_figure_delete(fig);
+    return cols / 2;
+}
+
+TEST(Figure, render_scroll)
+{
+    GError *error = NULL;
+    const unsigned window = scroll_window();
+    std::vector<double> xs(2000), ys(2000);
+    for (size_t i = 0; i < xs.size(); i++) {
+        xs[i] = i;
+        ys[i] = (double)((i * 37) % 100);
+    }
+
+    // data that grows under a window that moves, or a ring that keeps the window
+    for (bool ring : { false, true }) {
+        blot_figure *fig = blot_figure_new(&error);
+        ASSERT_TRUE(fig != NULL);
+        ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+
+        size_t count = window;
+        blot_layer *dots, *bars;
+        if (ring) {
+            ASSERT_TRUE(blot_figure_plot_ring(fig, BLOT_SCATTER, BLOT_DATA_DOUBLE, window, 9, "dots", &error));
+            ASSERT_TRUE(blot_figure_plot_ring(fig, BLOT_BAR, BLOT_DATA_DOUBLE, window, 10, "bars", &error));
+            dots = blot_figure_get_layer(fig, 0, &error);
+            bars = blot_figure_get_layer(fig, 1, &error);
+            ASSERT_TRUE(blot_layer_append(dots, count, xs.data(), ys.data(), &error));
+            ASSERT_TRUE(blot_layer_append(bars, count, xs.data(), ys.data(), &error));
+        } else {
+            ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, window - 1, &error));
+            ASSERT_TRUE(blot_figure_scatter(fig, BLOT_DATA_DOUBLE, count, xs.data(), ys.data(), 9, "dots", &error));
+            ASSERT_TRUE(blot_figure_bar(fig, BLOT_DATA_(INT32,DOUBLE), count, NULL, ys.data(), 10, "bars", &error));
+            dots = blot_figure_get_layer(fig, 0, &error);
+            bars = blot_figure_get_layer(fig, 1, &error);
+        }
+
+        const blot_render_flags base = BLOT_RENDER_BRAILLE;
+        const blot_render_flags flags = base | BLOT_RENDER_SCROLL;
+        blot_render_ctx ctx;
+        ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+
+        for (size_t step : { 1, 2, 3, 10, 1, 7 }) {
+            if (ring) {
+                ASSERT_TRUE(blot_layer_append(dots, step, xs.data() + count, ys.data() + count, &error));
+                ASSERT_TRUE(blot_layer_append(bars, step, xs.data() + count, ys.data() + count, &error));
+                count += step;
+            } else {
+                count += step;
+                ASSERT_TRUE(blot_figure_set_x_limits(fig, count - window, count - 1, &error));
+                ASSERT_TRUE(blot_layer_extend(dots, count, xs.data(), ys.data(), &error));
+                ASSERT_TRUE(blot_layer_extend(bars, count, NULL, ys.data(), &error));
+            }
+
+            ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base)) << ring << " " << count;
+        }
+        ASSERT_EQ(ctx.reuse_scrolls, 2u * 6);
+        ASSERT_EQ(ctx.reuse_misses, 2u);
+
+        // the summary cannot scroll, and other changes draw everything again
+        count ++;
+        if (ring) {
+            ASSERT_TRUE(blot_layer_append(dots, 1, xs.data() + count, ys.data() + count, &error));
+        } else {
+            ASSERT_TRUE(blot_figure_set_x_limits(fig, count - window, count - 1, &error));
+            ASSERT_TRUE(blot_layer_extend(dots, count, xs.data(), ys.data(), &error));
+        }
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags | BLOT_RENDER_LEGEND_DETAILS)
+                    == render_text(fig, base | BLOT_RENDER_LEGEND_DETAILS));
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, -10, 100, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, flags) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_scrolls, 2u * 6);
+        ASSERT_EQ(ctx.reuse_misses, 6u);
+
+        blot_render_ctx_cleanup(&ctx);
+        blot_figure_delete(fig);
+    }
+}
+
+TEST(Figure, render_scroll_partial_cells)
+{
+    GError *error = NULL;
+    std::vector<double> ys(5000);
+    for (size_t i = 0; i < ys.size(); i++)
+        ys[i] = (double)((i * 37) % 100);
+
+    // a window of 1000 points does not move by whole cells, so the canvas
+    // starts up to a cell right of where the axis says, and is redrawn as
+    // soon as anything else changes
+    for (blot_render_flags base : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE, BLOT_RENDER_BRAILLE | BLOT_RENDER_BLOCKS }) {
+        blot_figure *fig = blot_figure_new(&error);
+        ASSERT_TRUE(fig != NULL);
+        ASSERT_TRUE(blot_figure_set_screen_size(fig, 80, 24, &error));
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 100, &error));
+        ASSERT_TRUE(blot_figure_plot_ring(fig, BLOT_LINE, BLOT_DATA_(INT32,DOUBLE), 1000, 9, "line", &error));
+        blot_layer *line = blot_figure_get_layer(fig, 0, &error);
+
+        gint32 x = 0;
+        for (; x < 1000; x++)
+            ASSERT_TRUE(blot_layer_append(line, 1, &x, &ys[x], &error));
+
+        blot_render_ctx ctx;
+        ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, base | BLOT_RENDER_SCROLL) == render_text(fig, base));
+
+        for (int frame = 0; frame < 100; frame++) {
+            for (int i = 0; i < 37; i++, x++)
+                ASSERT_TRUE(blot_layer_append(line, 1, &x, &ys[x], &error));
+            ASSERT_TRUE(render_text_into(fig, &ctx, base | BLOT_RENDER_SCROLL).size() > 0);
+
+            // the canvas starts less than a cell right of the X limit, every
+            // frame, so the rounding does not add up
+            const blot_render_memo *memo = &ctx.memos[0];
+            const blot_canvas *can = ctx.cans[0];
+            blot_xy_limits lim = memo->key.lim;
+            unsigned cell_cols = (base & BLOT_RENDER_BRAILLE) ? BRAILLE_GLYPH_COLS : 1;
+            double cell = cell_cols / blot_layer_x_scale(line, &lim, can->dim.cols);
+            ASSERT_GE(memo->x_origin, lim.x_min - 1e-6) << base << " " << frame;
+            ASSERT_LT(memo->x_origin, lim.x_min + cell) << base << " " << frame;
+
+            // and holds what drawing everything from that origin draws; only
+            // the first cells differ, where segments from the points that
+            // were dropped lead in
+            blot_xy_limits at = lim;
+            at.x_min = memo->x_origin;
+            at.x_max = memo->x_origin + (lim.x_max - lim.x_min);
+            blot_canvas *full = blot_layer_render(line, &at, &memo->key.dim, base, &error);
+            ASSERT_TRUE(full != NULL);
+            unsigned cols = can->dim.cols / cell_cols;
+            unsigned rows = can->dim.rows / ((base & BLOT_RENDER_BRAILLE) ? BRAILLE_GLYPH_ROWS : 1);
+            for (unsigned r = 0; r < rows; r++)
+                for (unsigned c = 2; c < cols; c++)
+                    ASSERT_EQ(blot_canvas_get_cell(can, c, r), blot_canvas_get_cell(full, c, r))
+                        << base << " " << frame << " " << c << "," << r;
+            blot_canvas_delete(full);
+        }
+        ASSERT_EQ(ctx.reuse_scrolls, 100u);
+        ASSERT_EQ(ctx.reuse_misses, 1u);
+
+        ASSERT_TRUE(blot_figure_set_y_limits(fig, -1, 100, &error));
+        ASSERT_TRUE(render_text_into(fig, &ctx, base | BLOT_RENDER_SCROLL) == render_text(fig, base));
+        ASSERT_EQ(ctx.reuse_misses, 2u);
+
+        blot_render_ctx_cleanup(&ctx);
+        blot_figure_delete(fig);
+    }
+}
+
+TEST(Figure, render_parallel_layer_failure)
+{
+    std::vector<std::vector<double>> ys(8, std::vector<double>(100));
+    for (size_t li = 0; li < ys.size(); li++)
+        for (size_t i = 0; i < ys[li].size(); i++)
+            ys[li][i] = i * li;
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    // fixed limits, so that only rendering looks at the layers
+    GError *error = NULL;
+    ASSERT_TRUE(blot_figure_set_x_limits(fig, 0, 100, &error));
+    ASSERT_TRUE(blot_figure_set_y_limits(fig, 0, 1000, &error));
+
+    // break a couple of the layers; the lowest one is the error reported
+    fig->layers[3]->plot_type = BLOT_PLOT_TYPE_MAX;
+    fig->layers[6]->data_type = BLOT_DATA_TYPE_MAX;
+
+    blot_screen *screen = blot_figure_render(fig, BLOT_RENDER_PARALLEL, &error);
+    ASSERT_TRUE(screen == NULL);
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    ASSERT_TRUE(strstr(error->message, "plot_type") != NULL) << error->message;
+    g_clear_error(&error);
+
+    fig->layers[3]->plot_type = BLOT_BAR;
+    fig->layers[6]->data_type = BLOT_DATA_DOUBLE;
+
+    screen = blot_figure_render(fig, BLOT_RENDER_PARALLEL, &error);
+    ASSERT_TRUE(screen != NULL);
+    ASSERT_TRUE(error == NULL);
+    blot_screen_delete(screen);
+
+    blot_figure_delete(fig);
+}
+
+static std::string encode_utf8(const std::wstring &text)
+{
+    std::string out;
+    for (wchar_t wch : text) {
+        char buf[BLOT_UTF8_MAX];
+        out.append(buf, blot_utf8_encode(buf, wch));
+    }
+    return out;
+}
+
+TEST(Figure, render_utf8_matches_text)
+{
+    std::vector<std::vector<double>> ys(12);
+    srand(11);
+    for (size_t li = 0; li < ys.size(); li++) {
+        ys[li].resize(500);
+        for (auto &y : ys[li])
+            y = (rand() % 2000) - 1000;
+    }
+
+    blot_figure *fig = new_many_layer_figure(ys);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_ABOVE | BLOT_RENDER_LEGEND_DETAILS | BLOT_RENDER_CLEAR,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_NO_COLOR,
+    };
+
+    for (blot_render_flags flags : variants) {
+        std::wstring text = render_text(fig, flags);
+
+        GError *error = NULL;
+        blot_screen *screen = blot_figure_render(fig, flags | BLOT_RENDER_UTF8, &error);
+        ASSERT_TRUE(screen != NULL);
+        ASSERT_TRUE(error == NULL);
+
+        gsize len = 0;
+        const char *utf8 = blot_screen_get_utf8(screen, &len, &error);
+        ASSERT_TRUE(utf8 != NULL);
+        ASSERT_EQ(strlen(utf8), len);
+        ASSERT_TRUE(encode_utf8(text) == std::string(utf8, len)) << "flags=" << flags;
+
+        // the wide text is not produced in this mode
+        ASSERT_TRUE(blot_screen_get_text(screen, &len, &error) == NULL);
+        ASSERT_TRUE(error != NULL);
+        ASSERT_EQ(error->code, EINVAL);
+        g_clear_error(&error);
+
+        blot_screen_delete(screen);
+    }
+
+    blot_figure_delete(fig);
+}
+
+/* just enough of a terminal to replay what the screen writes */
+struct Terminal {
+    struct Cell {
+        gunichar wch = ' ';
+        int color = -1;
+        bool operator==(const Cell &o) const { return wch == o.wch && color == o.color; }
+    };
+    std::vector<std::vector<Cell>> cells{std::vector<std::vector<Cell>>(100, std::vector<Cell>(200))};
+    size_t row = 0, col = 0;
+    int color = -1;
+
+    void clear() {
+        for (auto &line : cells)
+            std::fill(line.begin(), line.end(), Cell{});
+    }
+
+    void write(const char *p, size_t len) {
+        const char *end = p + len;
+        while (p < end) {
+            if (*p == '\033') {
+                ASSERT_EQ(p[1], '[');
+                const char *q = p + 2;
+                while (!isalpha(*q))
+                    q++;
+                std::string params(p + 2, q);
+                switch (*q) {
+                case 'J': ASSERT_EQ(params, "2"); clear(); break;
+                case 'K': std::fill(cells[row].begin() + col, cells[row].end(), Cell{}); break;
+                case 'H':
+                    row = col = 0;
+                    if (!params.empty()) {
+                        ASSERT_EQ(sscanf(params.c_str(), "%zu;%zu", &row, &col), 2);
+                    }
+                    row = row ? row - 1 : 0;
+                    col = col ? col - 1 : 0;
+                    break;
+                case 'm':
+                    if (params == "0") {
+                        color = -1;
+                    } else {
+                        ASSERT_EQ(sscanf(params.c_str(), "38;5;%d", &color), 1) << params;
+                    }
+                    break;
+                default:
+                    FAIL() << "unexpected escape " << *q;
+                }
+                p = q + 1;
+            } else if (*p == '\n') {
+                row++, col = 0, p++;
+            } else if (*p == '\t') {
+                col = (col / 8 + 1) * 8, p++;
+            } else {
+                unsigned char c = *p++;
+                unsigned more = c < 0x80 ? 0 : c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+                gunichar wch = more ? c & (0x3F >> more) : c;
+                for (; more; more--)
+                    wch = (wch << 6) | (*p++ & 0x3F);
+                cells[row][col++] = Cell{wch, color};
+            }
+        }
+    }
+};
+
+static blot_screen * render_screen(blot_figure *fig, blot_render_flags flags)
+{
+    GError *error = NULL;
+    blot_screen *screen = blot_figure_render(fig, flags | BLOT_RENDER_UTF8, &error);
+    EXPECT_TRUE(screen != NULL);
+    EXPECT_TRUE(error == NULL);
+    return screen;
+}
+
+TEST(Figure, render_diff)
+{
+    std::vector<std::vector<double>> ys(4, std::vector<double>(200));
+    srand(13);
+    for (auto &layer : ys)
+        for (auto &y : layer)
+            y = rand() % 1000;
+
+    blot_figure *fig1 = new_many_layer_figure(ys);
+    ASSERT_TRUE(blot_figure_set_y_limits(fig1, 0, 1000, NULL));
+
+    // move a few points, and keep the limits so that the axes stay put;
+    // layers do not copy the data, so this needs its own
+    std::vector<std::vector<double>> ys2 = ys;
+    for (size_t i = 50; i < 60; i++)
+        ys2[1][i] = 999 - ys2[1][i];
+    blot_figure *fig2 = new_many_layer_figure(ys2);
+    ASSERT_TRUE(blot_figure_set_y_limits(fig2, 0, 1000, NULL));
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_CLEAR,
+        BLOT_RENDER_CLEAR | BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_ABOVE | BLOT_RENDER_LEGEND_DETAILS,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_NO_COLOR,
+    };
+
+    for (blot_render_flags flags : variants) {
+        GError *error = NULL;
+        blot_screen *scr1 = render_screen(fig1, flags);
+        blot_screen *scr2 = render_screen(fig2, flags);
+        blot_screen *scr3 = render_screen(fig2, flags);
+        gsize len;
+
+        // nothing to diff against, so it is all drawn
+        Terminal full, term;
+        const char *txt = blot_screen_diff(scr2, NULL, &len, &error);
+        ASSERT_TRUE(txt != NULL);
+        full.write(txt, len);
+
+        txt = blot_screen_diff(scr1, NULL, &len, &error);
+        term.write(txt, len);
+
+        // only the changes are drawn, and they bring the terminal up to date
+        gsize full_len = len;
+        txt = blot_screen_diff(scr2, scr1, &len, &error);
+        ASSERT_TRUE(txt != NULL);
+        ASSERT_TRUE(error == NULL);
+        ASSERT_GT(len, 16u) << "flags=" << flags;
+        ASSERT_LT(len, full_len / 2) << "flags=" << flags;
+        ASSERT_EQ(strlen(txt), len);
+        term.write(txt, len);
+        ASSERT_TRUE(term.cells == full.cells) << "flags=" << flags;
+        ASSERT_EQ(term.row, full.row);
+        ASSERT_EQ(term.col, full.col);
+
+        // and when nothing changed, only the cursor moves
+        txt = blot_screen_diff(scr3, scr2, &len, &error);
+        ASSERT_TRUE(txt != NULL);
+        ASSERT_LT(len, 16u) << "flags=" << flags;
+        term.write(txt, len);
+        ASSERT_TRUE(term.cells == full.cells) << "flags=" << flags;
+
+        blot_screen_delete(scr1);
+        blot_screen_delete(scr2);
+        blot_screen_delete(scr3);
+    }
+
+    blot_figure_delete(fig1);
+    blot_figure_delete(fig2);
+}
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "blot_terminal.h"
 #include "blot_layer.h"
 #include "blot_types.h"
@@ -569,6 +573,194 @@ TEST(Layer, get_lim_negative_values)
     g_clear_error(&error);
 }
 
+TEST(Layer, get_lim_extend_and_touch)
+{
+    std::vector<double> xs = { 1, 2, 3, 4 };
+    std::vector<float> ys = { 5, -5, 10, 0 };
+    GError *error = NULL;
+
+    blot_layer *layer = blot_layer_new(BLOT_LINE, BLOT_DATA_(DOUBLE,FLOAT), 2, xs.data(), ys.data(), 1, "label", &error);
+    ASSERT_TRUE(layer != NULL);
+
+    blot_xy_limits limits = {};
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_max, 2);
+    ASSERT_FLOAT_EQ(limits.y_min, -5);
+    ASSERT_FLOAT_EQ(limits.y_max, 5);
+    ASSERT_EQ(layer->x_lim.count, 2u);
+
+    // only the new points are looked at, the old ones come from the cache
+    ys[0] = 100;
+    ASSERT_TRUE(blot_layer_extend(layer, 4, xs.data(), ys.data(), &error));
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_max, 4);
+    ASSERT_FLOAT_EQ(limits.y_max, 10);
+    ASSERT_EQ(layer->y_lim.count, 4u);
+
+    // until the layer is told that the data changed
+    blot_layer_touch(layer);
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.y_max, 100);
+
+    const double other[] = { -1, 1 };
+    ASSERT_TRUE(blot_layer_set_data(layer, 1, other, ys.data(), &error));
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_min, -1);
+    ASSERT_FLOAT_EQ(limits.x_max, -1);
+    ASSERT_FLOAT_EQ(limits.y_max, 100);
+
+    // data cannot shrink, nor can its X switch to the index
+    ASSERT_FALSE(blot_layer_extend(layer, 0, other, ys.data(), &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+    ASSERT_FALSE(blot_layer_extend(layer, 2, NULL, ys.data(), &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_layer_delete(layer);
+}
+
+TEST(Layer, get_y_lim_in_x)
+{
+    // ascending X is searched, otherwise every point is checked
+    const std::vector<std::vector<gint32>> all_xs = {
+        { 0, 1, 2, 3, 4, 5, 6, 7 },
+        { 7, 1, 5, 3, 4, 2, 6, 0 },
+    };
+    GError *error = NULL;
+
+    for (const auto &xs : all_xs) {
+        std::vector<gint16> ys(xs.size());
+        for (size_t i = 0; i < xs.size(); i++)
+            ys[i] = xs[i] * 10 - 30;
+
+        blot_layer *layer = blot_layer_new(BLOT_LINE, BLOT_DATA_(INT32,INT16), xs.size(), xs.data(), ys.data(), 1, "label", &error);
+        ASSERT_TRUE(layer != NULL);
+
+        double y_min, y_max;
+        bool found;
+        ASSERT_TRUE(blot_layer_get_y_lim_in_x(layer, 2, 4.5, &y_min, &y_max, &found, &error));
+        ASSERT_TRUE(found);
+        ASSERT_FLOAT_EQ(y_min, -10);
+        ASSERT_FLOAT_EQ(y_max, 10);
+
+        ASSERT_TRUE(blot_layer_get_y_lim_in_x(layer, 7, 100, &y_min, &y_max, &found, &error));
+        ASSERT_TRUE(found);
+        ASSERT_FLOAT_EQ(y_min, 40);
+        ASSERT_FLOAT_EQ(y_max, 40);
+
+        ASSERT_TRUE(blot_layer_get_y_lim_in_x(layer, 2.1, 2.9, &y_min, &y_max, &found, &error));
+        ASSERT_FALSE(found);
+
+        ASSERT_EQ(layer->x_sorted, &xs == &all_xs[0]);
+        blot_layer_delete(layer);
+    }
+}
+
+TEST(Layer, ring_append_and_wrap)
+{
+    GError *error = NULL;
+
+    blot_layer *layer = blot_layer_new_ring(BLOT_LINE, BLOT_DATA_(INT32,DOUBLE), 5, 1, "ring", &error);
+    ASSERT_TRUE(layer != NULL);
+    ASSERT_EQ(layer->count, 0u);
+
+    const gint32 xs[] = { 0, 1, 2, 3, 4, 5, 6 };
+    const double ys[] = { -9, 3, 4, 2, 8, 1, 5 };
+
+    ASSERT_TRUE(blot_layer_append(layer, 3, xs, ys, &error));
+    blot_xy_limits limits = {};
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.y_min, -9);
+    ASSERT_FLOAT_EQ(limits.y_max, 4);
+
+    // the first two points are dropped, and the data wraps around
+    ASSERT_TRUE(blot_layer_append(layer, 4, xs + 3, ys + 3, &error));
+    ASSERT_EQ(layer->count, 5u);
+    ASSERT_EQ(layer->head, 2u);
+
+    blot_layer_segment segs[2];
+    ASSERT_EQ(blot_layer_segments(layer, 0, layer->count, segs), 2u);
+    ASSERT_EQ(segs[0].begin, 2u);
+    ASSERT_EQ(segs[0].end, 5u);
+    ASSERT_EQ(segs[1].begin, 0u);
+    ASSERT_EQ(segs[1].end, 2u);
+    ASSERT_EQ(segs[1].index, 3u);
+
+    for (unsigned i = 0; i < layer->count; i++) {
+        double x, y;
+        ASSERT_TRUE(blot_layer_get_x_y(layer, i, &x, &y, &error));
+        ASSERT_FLOAT_EQ(x, xs[i + 2]);
+        ASSERT_FLOAT_EQ(y, ys[i + 2]);
+    }
+
+    // -9 was the minimum, so the cached limits could not be kept
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_min, 2);
+    ASSERT_FLOAT_EQ(limits.x_max, 6);
+    ASSERT_FLOAT_EQ(limits.y_min, 1);
+    ASSERT_FLOAT_EQ(limits.y_max, 8);
+
+    // dropping a point that was not an extreme keeps the cache
+    const gint32 x7 = 7;
+    const double y7 = 6;
+    ASSERT_TRUE(blot_layer_append(layer, 1, &x7, &y7, &error));
+    ASSERT_EQ(layer->y_lim.count, 4u);
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_min, 3);
+    ASSERT_FLOAT_EQ(limits.y_min, 1);
+    ASSERT_FLOAT_EQ(limits.y_max, 8);
+
+    bool found;
+    double y_min, y_max;
+    ASSERT_TRUE(blot_layer_get_y_lim_in_x(layer, 5, 7, &y_min, &y_max, &found, &error));
+    ASSERT_TRUE(found);
+    ASSERT_FLOAT_EQ(y_min, 1);
+    ASSERT_FLOAT_EQ(y_max, 6);
+
+    // more than fits replaces everything with the last capacity points
+    ASSERT_TRUE(blot_layer_append(layer, 7, xs, ys, &error));
+    ASSERT_EQ(layer->count, 5u);
+    ASSERT_EQ(layer->head, 0u);
+    ASSERT_TRUE(blot_layer_get_lim(layer, &limits, &error));
+    ASSERT_FLOAT_EQ(limits.x_min, 2);
+    ASSERT_FLOAT_EQ(limits.y_min, 1);
+
+    blot_layer_delete(layer);
+}
+
+TEST(Layer, ring_errors)
+{
+    GError *error = NULL;
+    const double xs[] = { 1, 2 };
+
+    ASSERT_TRUE(blot_layer_new_ring(BLOT_LINE, BLOT_DATA_DOUBLE, 0, 1, "ring", &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_layer *ring = blot_layer_new_ring(BLOT_LINE, BLOT_DATA_DOUBLE, 2, 1, "ring", &error);
+    ASSERT_TRUE(ring != NULL);
+    blot_layer *plain = blot_layer_new(BLOT_LINE, BLOT_DATA_DOUBLE, 2, xs, xs, 1, "plain", &error);
+    ASSERT_TRUE(plain != NULL);
+
+    // a ring owns its data, and only a ring can be appended to
+    ASSERT_FALSE(blot_layer_set_data(ring, 2, xs, xs, &error));
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+    ASSERT_FALSE(blot_layer_extend(ring, 2, xs, xs, &error));
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+    ASSERT_FALSE(blot_layer_append(plain, 1, xs, xs, &error));
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+    ASSERT_FALSE(blot_layer_append(ring, 1, NULL, xs, &error));
+    ASSERT_EQ(error->code, EFAULT);
+    g_clear_error(&error);
+
+    blot_layer_delete(plain);
+    blot_layer_delete(ring);
+}
+
 TEST(Layer, render_scatter_int32)
 {
     GError *error = NULL;
@@ -800,3 +992,470 @@ TEST(Layer, render_error_conditions)
 
     blot_layer_delete(layer);
 }
+
+static void expect_line_decimation_identical(const double *xs, const double *ys,
+                                             size_t count, blot_render_flags flags,
+                                             const blot_xy_limits *fixed_lim = NULL,
+                                             blot_dimensions dim = { 40, 20 })
+{
+    GError *error = NULL;
+
+    blot_layer *layer = blot_layer_new(BLOT_LINE, BLOT_DATA_DOUBLE, count, xs, ys, 1, "label", &error);
+    ASSERT_TRUE(layer != NULL);
+
+    blot_xy_limits lim;
+    if (fixed_lim) {
+        lim = *fixed_lim;
+    } else {
+        ASSERT_TRUE(blot_layer_get_lim(layer, &lim, &error));
+        lim.x_min -= 1; lim.x_max += 1;
+        lim.y_min -= 1; lim.y_max += 1;
+    }
+
+    blot_canvas *fast = blot_layer_render(layer, &lim, &dim, flags, &error);
+    ASSERT_TRUE(fast != NULL);
+
+    blot_canvas *full = blot_layer_render(layer, &lim, &dim,
+                                          combine(flags, BLOT_RENDER_NO_DECIMATION), &error);
+    ASSERT_TRUE(full != NULL);
+
+    ASSERT_EQ(fast->bitmap_bytes, full->bitmap_bytes);
+    EXPECT_EQ(memcmp(fast->bitmap, full->bitmap, fast->bitmap_bytes), 0);
+
+    blot_canvas_delete(full);
+    blot_canvas_delete(fast);
+    blot_layer_delete(layer);
+}
+
+TEST(Layer, render_line_decimation_random_walk)
+{
+    const constexpr size_t data_count = 100000;
+    std::vector<double> xs(data_count), ys(data_count);
+
+    srand(1);
+    double y = 0;
+    for (size_t i = 0; i < data_count; i++) {
+        y += (rand() % 201) - 100;
+        xs[i] = i;
+        ys[i] = y;
+    }
+
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_NONE);
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_BRAILLE);
+}
+
+TEST(Layer, render_line_decimation_unordered_x)
+{
+    const constexpr size_t data_count = 5000;
+    std::vector<double> xs(data_count), ys(data_count);
+
+    srand(2);
+    for (size_t i = 0; i < data_count; i++) {
+        xs[i] = rand() % 100;
+        ys[i] = rand() % 50;
+    }
+
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_NONE);
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_BRAILLE);
+}
+
+TEST(Layer, render_line_decimation_small_steps)
+{
+    /* many points per column that only ever move by one row, this
+     * exercises segments that do not draw their end point */
+    const constexpr size_t data_count = 4000;
+    std::vector<double> xs(data_count), ys(data_count);
+
+    for (size_t i = 0; i < data_count; i++) {
+        xs[i] = i / 100.0;
+        ys[i] = (i % 7) < 3 ? (i % 7) : 6 - (i % 7);
+    }
+
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_NONE);
+    expect_line_decimation_identical(xs.data(), ys.data(), data_count, BLOT_RENDER_BRAILLE);
+}
+
+TEST(Layer, render_line_decimation_last_point)
+{
+    /* the line ends on a new maximum, just one row above the point
+     * before it; the last column must not be collapsed to first..last */
+    std::vector<double> xs, ys;
+    for (int i = 0; i < 18; i++) {
+        xs.push_back(i / 2);
+        ys.push_back(i % 3);
+    }
+    const double tail[] = { 5, 0, 5, 6 };
+    for (double y : tail) {
+        xs.push_back(9);
+        ys.push_back(y);
+    }
+
+    blot_xy_limits lim = { 0, 9, 0, 9 };
+    expect_line_decimation_identical(xs.data(), ys.data(), xs.size(), BLOT_RENDER_NONE,
+                                     &lim, { 10, 10 });
+}
+
+TEST(Layer, render_mixed_types_match_double)
+{
+    GError *error = NULL;
+    const constexpr size_t data_count = 200;
+    std::vector<int64_t> xs_i64(data_count);
+    std::vector<float> ys_flt(data_count);
+    std::vector<double> xs_dbl(data_count), ys_dbl(data_count);
+
+    for (size_t i = 0; i < data_count; i++) {
+        xs_i64[i] = 1000000000LL + i * 1000;
+        ys_flt[i] = (float)((i * 37) % 101) - 50.0f;
+        xs_dbl[i] = xs_i64[i];
+        ys_dbl[i] = ys_flt[i];
+    }
+
+    blot_xy_limits lim = { 1000000000.0, 1000000000.0 + data_count * 1000, -60, 60 };
+    blot_dimensions dim = { 50, 20 };
+
+    const blot_plot_type plot_types[] = { BLOT_SCATTER, BLOT_LINE, BLOT_BAR };
+    for (blot_plot_type plot_type : plot_types) {
+        blot_layer *mixed = blot_layer_new(plot_type, BLOT_DATA_(INT64, FLOAT), data_count,
+                                           xs_i64.data(), ys_flt.data(), 1, "mixed", &error);
+        ASSERT_TRUE(mixed != NULL);
+        blot_layer *dbl = blot_layer_new(plot_type, BLOT_DATA_DOUBLE, data_count,
+                                         xs_dbl.data(), ys_dbl.data(), 1, "double", &error);
+        ASSERT_TRUE(dbl != NULL);
+
+        blot_canvas *a = blot_layer_render(mixed, &lim, &dim, BLOT_RENDER_BRAILLE, &error);
+        ASSERT_TRUE(a != NULL);
+        blot_canvas *b = blot_layer_render(dbl, &lim, &dim, BLOT_RENDER_BRAILLE, &error);
+        ASSERT_TRUE(b != NULL);
+
+        EXPECT_EQ(memcmp(a->bitmap, b->bitmap, a->bitmap_bytes), 0)
+            << "plot_type=" << plot_type;
+
+        blot_canvas_delete(a);
+        blot_canvas_delete(b);
+        blot_layer_delete(mixed);
+        blot_layer_delete(dbl);
+    }
+}
+
+TEST(Layer, render_scatter_zoomed_in)
+{
+    /* most points are outside of the window, the ones inside have
+     * to land on the same pixels as the one-point-at-a-time math */
+    GError *error = NULL;
+    const constexpr size_t data_count = 5000;
+    std::vector<int32_t> xs(data_count), ys(data_count);
+
+    srand(42);
+    for (size_t i = 0; i < data_count; i++) {
+        xs[i] = rand() % 10000;
+        ys[i] = rand() % 10000;
+    }
+
+    blot_xy_limits lim = { 4000, 4500, 2000, 2800 };
+    blot_dimensions dim = { 40, 20 };
+
+    for (blot_render_flags flags : { BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE, BLOT_RENDER_LEGEND_DETAILS }) {
+        blot_layer *layer = blot_layer_new(BLOT_SCATTER, BLOT_DATA_INT32, data_count,
+                                           xs.data(), ys.data(), 1, "zoom", &error);
+        ASSERT_TRUE(layer != NULL);
+
+        blot_canvas *can = blot_layer_render(layer, &lim, &dim, flags, &error);
+        ASSERT_TRUE(can != NULL);
+
+        blot_canvas *exp = blot_canvas_new(dim.cols, dim.rows, flags, 1, &error);
+        ASSERT_TRUE(exp != NULL);
+
+        double x_scale = can->dim.cols / (lim.x_max - lim.x_min + 1);
+        double y_scale = can->dim.rows / (lim.y_max - lim.y_min + 1);
+        for (size_t i = 0; i < data_count; i++) {
+            double dx = round((xs[i] - lim.x_min) * x_scale);
+            double dy = round((ys[i] - lim.y_min) * y_scale);
+            if (dx >= 0 && dy >= 0)
+                blot_canvas_draw_point(exp, dx, dy);
+        }
+
+        EXPECT_EQ(memcmp(can->bitmap, exp->bitmap, can->bitmap_bytes), 0)
+            << "flags=" << flags;
+
+        /* the summary still covers every point */
+        if (flags & BLOT_RENDER_LEGEND_DETAILS) {
+            EXPECT_EQ(layer->summary.count, data_count);
+        }
+
+        blot_canvas_delete(exp);
+        blot_canvas_delete(can);
+        blot_layer_delete(layer);
+    }
+}
+
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+/* the layer is big enough to be split across threads, and every plot type
+ * has to come out the same as drawing one point (or segment) at a time */
+TEST(Layer, render_parallel_matches_serial)
+{
+    (void)force_threads;
+
+    GError *error = NULL;
+    /* with up to 4 threads, the chunks start at multiples of the grain */
+    const size_t data_count = 4 * BLOT_LAYER_PARALLEL_GRAIN;
+    ASSERT_GE(data_count, BLOT_LAYER_PARALLEL_MIN);
+    std::vector<float> xs(data_count), ys(data_count);
+
+    srand(5);
+    double y = 0;
+    for (size_t i = 0; i < data_count; i++) {
+        y += (rand() % 201) - 100;
+        xs[i] = i;
+        ys[i] = y;
+    }
+
+    blot_dimensions dim = { 60, 20 };
+    const blot_plot_type plot_types[] = { BLOT_SCATTER, BLOT_LINE, BLOT_BAR };
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE,
+        combine(BLOT_RENDER_BRAILLE, BLOT_RENDER_LEGEND_DETAILS),
+    };
+
+    for (blot_plot_type plot_type : plot_types) {
+        blot_layer *layer = blot_layer_new(plot_type, BLOT_DATA_FLOAT, data_count,
+                                           xs.data(), ys.data(), 1, "big", &error);
+        ASSERT_TRUE(layer != NULL);
+
+        blot_xy_limits all;
+        ASSERT_TRUE(blot_layer_get_lim(layer, &all, &error));
+
+        /* everything, and zoomed in on the join of the first two chunks */
+        const size_t join = BLOT_LAYER_PARALLEL_GRAIN;
+        blot_xy_limits zoom = { (double)join - 3, (double)join + 2,
+                                std::min(ys[join-1], ys[join]) - 50,
+                                std::max(ys[join-1], ys[join]) + 50 };
+
+        for (const blot_xy_limits &lim : { all, zoom })
+        for (blot_render_flags flags : variants) {
+            blot_canvas *can = blot_layer_render(layer, &lim, &dim, flags, &error);
+            ASSERT_TRUE(can != NULL);
+            ASSERT_TRUE(error == NULL);
+
+            blot_canvas *exp = blot_canvas_new(dim.cols, dim.rows, flags, 1, &error);
+            ASSERT_TRUE(exp != NULL);
+
+            double inc = plot_type == BLOT_LINE ? 0 : 1;
+            double x_scale = (exp->dim.cols - 1 + inc) / (lim.x_max - lim.x_min + inc);
+            double y_scale = (exp->dim.rows - 1 + inc) / (lim.y_max - lim.y_min + inc);
+            double px = 0, py = 0;
+            for (size_t i = 0; i < data_count; i++) {
+                double dx = round((xs[i] - lim.x_min) * x_scale);
+                double dy = round((ys[i] - lim.y_min) * y_scale);
+                if (plot_type == BLOT_SCATTER)
+                    blot_canvas_draw_point(exp, dx, dy);
+                else if (plot_type == BLOT_BAR)
+                    blot_canvas_fill_rect(exp, dx, 0, round((xs[i] - lim.x_min) * x_scale
+                                                            + 0.5 * x_scale), dy);
+                else if (i)
+                    blot_canvas_draw_line(exp, px, py, dx, dy);
+                px = dx;
+                py = dy;
+            }
+
+            EXPECT_EQ(memcmp(can->bitmap, exp->bitmap, can->bitmap_bytes), 0)
+                << "plot_type=" << plot_type << " flags=" << flags;
+
+            if (flags & BLOT_RENDER_LEGEND_DETAILS) {
+                EXPECT_EQ(layer->summary.count, data_count);
+                EXPECT_EQ(layer->summary.xmin, all.x_min);
+                EXPECT_EQ(layer->summary.xmax, all.x_max);
+                EXPECT_EQ(layer->summary.ymin, all.y_min);
+                EXPECT_EQ(layer->summary.ymax, all.y_max);
+            }
+
+            blot_canvas_delete(exp);
+            blot_canvas_delete(can);
+        }
+
+        blot_layer_delete(layer);
+    }
+}
+
+/* a ring that has wrapped around draws the same as its points laid out in
+ * order, with the line joining the two segments, on one thread or several */
+static void expect_ring_matches_contiguous(size_t capacity, const blot_plot_type *plot_types,
+                                           size_t plot_type_count)
+{
+    GError *error = NULL;
+    const size_t total = capacity * 5 / 2;
+    std::vector<double> xs(total);
+    std::vector<float> ys(total);
+
+    srand(7);
+    double y = 0;
+    for (size_t i = 0; i < total; i++) {
+        y += (rand() % 201) - 100;
+        xs[i] = i;
+        ys[i] = y;
+    }
+
+    blot_dimensions dim = { 60, 20 };
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_NONE, BLOT_RENDER_BRAILLE,
+        combine(BLOT_RENDER_BRAILLE, BLOT_RENDER_LEGEND_DETAILS),
+    };
+
+    for (size_t pi = 0; pi < plot_type_count; pi++) {
+        blot_layer *ring = blot_layer_new_ring(plot_types[pi], BLOT_DATA_(DOUBLE,FLOAT), capacity,
+                                               1, "ring", &error);
+        ASSERT_TRUE(ring != NULL);
+
+        // in uneven batches, so that the wrap is somewhere in the middle
+        for (size_t i = 0; i < total; ) {
+            size_t n = std::min(total - i, capacity / 3 + 1);
+            ASSERT_TRUE(blot_layer_append(ring, n, &xs[i], &ys[i], &error));
+            i += n;
+        }
+        ASSERT_EQ(ring->count, capacity);
+        ASSERT_NE(ring->head, 0u);
+
+        const size_t first = total - capacity;
+        blot_layer *plain = blot_layer_new(plot_types[pi], BLOT_DATA_(DOUBLE,FLOAT), capacity,
+                                           &xs[first], &ys[first], 1, "plain", &error);
+        ASSERT_TRUE(plain != NULL);
+
+        blot_xy_limits lim, plain_lim;
+        ASSERT_TRUE(blot_layer_get_lim(ring, &lim, &error));
+        ASSERT_TRUE(blot_layer_get_lim(plain, &plain_lim, &error));
+        ASSERT_EQ(memcmp(&lim, &plain_lim, sizeof(lim)), 0);
+
+        for (blot_render_flags flags : variants) {
+            blot_canvas *can = blot_layer_render(ring, &lim, &dim, flags, &error);
+            ASSERT_TRUE(can != NULL);
+            blot_canvas *exp = blot_layer_render(plain, &lim, &dim, flags, &error);
+            ASSERT_TRUE(exp != NULL);
+
+            EXPECT_EQ(memcmp(can->bitmap, exp->bitmap, can->bitmap_bytes), 0)
+                << "plot_type=" << plot_types[pi] << " flags=" << flags;
+
+            if (flags & BLOT_RENDER_LEGEND_DETAILS) {
+                EXPECT_EQ(ring->summary.count, plain->summary.count);
+                EXPECT_EQ(ring->summary.yttl, plain->summary.yttl);
+            }
+
+            blot_canvas_delete(exp);
+            blot_canvas_delete(can);
+        }
+
+        blot_layer_delete(plain);
+        blot_layer_delete(ring);
+    }
+}
+
+TEST(Layer, render_ring_matches_contiguous)
+{
+    const blot_plot_type plot_types[] = { BLOT_SCATTER, BLOT_LINE, BLOT_BAR };
+    expect_ring_matches_contiguous(1000, plot_types, 3);
+}
+
+TEST(Layer, render_ring_parallel_matches_contiguous)
+{
+    (void)force_threads;
+
+    const blot_plot_type plot_types[] = { BLOT_LINE };
+    expect_ring_matches_contiguous(4 * BLOT_LAYER_PARALLEL_GRAIN, plot_types, 1);
+}
+
+TEST(Layer, render_sparse_parallel_matches_dense)
+{
+    (void)force_threads;
+
+    GError *error = NULL;
+    const size_t count = BLOT_LAYER_PARALLEL_MIN;
+    std::vector<float> ys(count);
+    srand(3);
+    float y = 0;
+    for (auto &v : ys)
+        v = y += (rand() % 21) - 10;
+
+    blot_layer *lay = blot_layer_new(BLOT_LINE, BLOT_DATA_(INT32,FLOAT), count,
+                                     NULL, ys.data(), 1, "line", &error);
+    ASSERT_TRUE(lay != NULL);
+
+    blot_xy_limits lim;
+    ASSERT_TRUE(blot_layer_get_lim(lay, &lim, &error));
+    blot_dimensions dim = { 120, 40 };
+
+    // every chunk draws into a sparse canvas of its own, merged tile by tile
+    blot_canvas *dense = blot_layer_render(lay, &lim, &dim, BLOT_RENDER_BRAILLE, &error);
+    ASSERT_TRUE(dense != NULL);
+    blot_canvas *sparse = blot_layer_render(lay, &lim, &dim,
+                                            BLOT_RENDER_BRAILLE | BLOT_RENDER_SPARSE, &error);
+    ASSERT_TRUE(sparse != NULL);
+
+    for (unsigned r = 0; r < dim.rows; r++)
+        for (unsigned c = 0; c < dim.cols; c++)
+            ASSERT_EQ(blot_canvas_get_cell(sparse, c, r), blot_canvas_get_cell(dense, c, r))
+                << c << "," << r;
+
+    blot_canvas_delete(dense);
+    blot_canvas_delete(sparse);
+    blot_layer_delete(lay);
+}
+
+TEST(Layer, render_append_matches_full)
+{
+    (void)force_threads;
+
+    GError *error = NULL;
+    // the last step appends enough points to be drawn on several threads
+    const size_t steps[] = { 1, 7, 300, 301, 5000, 5000 + BLOT_LAYER_PARALLEL_MIN };
+    const size_t count = steps[G_N_ELEMENTS(steps) - 1];
+    std::vector<double> xs(count), ys(count);
+    srand(5);
+    double y = 0;
+    for (size_t i = 0; i < count; i++) {
+        xs[i] = i % 3000;
+        ys[i] = y += (rand() % 21) - 10;
+    }
+
+    blot_xy_limits lim = { 0, 3000, -3000, 3000 };
+    blot_dimensions dim = { 100, 30 };
+    const blot_render_flags flags = BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_DETAILS;
+
+    for (blot_plot_type plot_type : { BLOT_SCATTER, BLOT_LINE, BLOT_BAR }) {
+        blot_layer *lay = blot_layer_new(plot_type, BLOT_DATA_DOUBLE, steps[0],
+                                         xs.data(), ys.data(), 1, "grows", &error);
+        ASSERT_TRUE(lay != NULL);
+
+        blot_canvas *can = blot_layer_render(lay, &lim, &dim, flags, &error);
+        ASSERT_TRUE(can != NULL);
+
+        for (size_t si = 1; si < G_N_ELEMENTS(steps); si++) {
+            size_t begin = lay->count;
+            ASSERT_TRUE(blot_layer_extend(lay, steps[si], xs.data(), ys.data(), &error));
+            ASSERT_TRUE(blot_layer_render_append(lay, &lim, &dim, can, begin, &error));
+            blot_layer_summary appended = lay->summary;
+
+            blot_canvas *full = blot_layer_render(lay, &lim, &dim, flags, &error);
+            ASSERT_TRUE(full != NULL);
+
+            for (unsigned r = 0; r < dim.rows; r++)
+                for (unsigned c = 0; c < dim.cols; c++)
+                    ASSERT_EQ(blot_canvas_get_cell(can, c, r), blot_canvas_get_cell(full, c, r))
+                        << plot_type << " " << steps[si] << " " << c << "," << r;
+
+            ASSERT_EQ(appended.count, lay->summary.count);
+            ASSERT_EQ(appended.xmin, lay->summary.xmin);
+            ASSERT_EQ(appended.xmax, lay->summary.xmax);
+            ASSERT_EQ(appended.ymin, lay->summary.ymin);
+            ASSERT_EQ(appended.ymax, lay->summary.ymax);
+            ASSERT_DOUBLE_EQ(appended.yttl, lay->summary.yttl);
+
+            blot_canvas_delete(full);
+        }
+
+        ASSERT_FALSE(blot_layer_render_append(lay, &lim, &dim, can, count + 1, &error));
+        ASSERT_EQ(error->code, ERANGE);
+        g_clear_error(&error);
+
+        blot_canvas_delete(can);
+        blot_layer_delete(lay);
+    }
+}
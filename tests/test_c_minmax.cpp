@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "blot_minmax.h"
+#include "blot_error.h"
+
+/* make sure there are worker threads, even on a single CPU machine */
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+template <typename T>
+static void expect_minmax_all_levels(blot_data_type elem_type, size_t count)
+{
+    std::vector<T> data(count);
+
+    srand(count);
+    for (size_t i = 0; i < count; i++)
+        data[i] = (T)((rand() % 20001) - 10000);
+
+    T lo = data[0], hi = data[0];
+    for (T v : data) {
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+
+    for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+        GError *error = NULL;
+        double min, max;
+
+        ASSERT_TRUE(blot_minmax_simd((blot_simd_level)level, elem_type,
+                                     data.data(), count, &min, &max, &error));
+        ASSERT_TRUE(error == NULL);
+        EXPECT_EQ(min, (double)lo) << "level=" << level << " count=" << count;
+        EXPECT_EQ(max, (double)hi) << "level=" << level << " count=" << count;
+    }
+}
+
+template <typename T>
+static void expect_minmax_types(blot_data_type elem_type)
+{
+    /* odd sizes exercise the scalar tail after the vector loop */
+    const size_t counts[] = { 1, 2, 3, 7, 31, 64, 65, 127, 1000, 4099 };
+    for (size_t count : counts)
+        expect_minmax_all_levels<T>(elem_type, count);
+}
+
+TEST(MinMax, int16)  { expect_minmax_types<int16_t>(BLOT_DATA_X_INT16); }
+TEST(MinMax, int32)  { expect_minmax_types<int32_t>(BLOT_DATA_X_INT32); }
+TEST(MinMax, int64)  { expect_minmax_types<int64_t>(BLOT_DATA_X_INT64); }
+TEST(MinMax, float)  { expect_minmax_types<float>(BLOT_DATA_X_FLOAT); }
+TEST(MinMax, double) { expect_minmax_types<double>(BLOT_DATA_X_DOUBLE); }
+
+TEST(MinMax, int64_extremes)
+{
+    std::vector<int64_t> data(100, 0);
+    data[17] = INT64_MIN + 1;
+    data[93] = INT64_MAX - 1;
+
+    for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+        GError *error = NULL;
+        double min, max;
+        ASSERT_TRUE(blot_minmax_simd((blot_simd_level)level, BLOT_DATA_X_INT64,
+                                     data.data(), data.size(), &min, &max, &error));
+        EXPECT_EQ(min, (double)(INT64_MIN + 1));
+        EXPECT_EQ(max, (double)(INT64_MAX - 1));
+    }
+}
+
+TEST(MinMax, nan_is_ignored)
+{
+    std::vector<double> data(50, 1.0);
+    data[0] = NAN;
+    data[10] = -5;
+    data[20] = NAN;
+    data[30] = 7;
+    data[49] = NAN;
+
+    for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+        GError *error = NULL;
+        double min, max;
+        ASSERT_TRUE(blot_minmax_simd((blot_simd_level)level, BLOT_DATA_X_DOUBLE,
+                                     data.data(), data.size(), &min, &max, &error));
+        EXPECT_EQ(min, -5);
+        EXPECT_EQ(max, 7);
+    }
+}
+
+TEST(MinMax, large_is_split_across_threads)
+{
+    const size_t count = BLOT_MINMAX_PARALLEL_MIN * 3 + 12345;
+    std::vector<float> data(count, 0.5f);
+    data[count / 3] = -100.0f;
+    data[count - 1] = 200.0f;
+
+    (void)force_threads;
+    GError *error = NULL;
+    double min, max;
+    ASSERT_TRUE(blot_minmax(BLOT_DATA_X_FLOAT, data.data(), count, &min, &max, &error));
+    EXPECT_EQ(min, -100.0);
+    EXPECT_EQ(max, 200.0);
+}
+
+TEST(MinMax, bad_arguments)
+{
+    GError *error = NULL;
+    double min, max;
+
+    ASSERT_FALSE(blot_minmax(BLOT_DATA_X_INT32, NULL, 10, &min, &max, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    int32_t data[4] = {};
+    ASSERT_FALSE(blot_minmax(BLOT_DATA_X_MASK, data, 4, &min, &max, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+}
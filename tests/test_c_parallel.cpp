@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "blot_parallel.h"
+#include "blot_error.h"
+
+/* make sure there are worker threads, even on a single CPU machine */
+static int force_threads = setenv("BLOT_THREADS", "4", 0);
+
+struct Counter {
+    std::vector<std::atomic<int>> hits;
+    explicit Counter(size_t count) : hits(count) {}
+};
+
+static void count_chunk(void *data, unsigned chunk, size_t begin, size_t end)
+{
+    Counter *counter = (Counter *)data;
+    for (size_t i = begin; i < end; i++)
+        counter->hits[i]++;
+}
+
+TEST(Parallel, every_item_once)
+{
+    const size_t counts[] = { 1, 10, 999, 1000, 1001, 100000 };
+    for (size_t count : counts) {
+        GError *error = NULL;
+        Counter counter(count);
+
+        ASSERT_TRUE(blot_parallel_for(count, 1000, count_chunk, &counter, &error));
+        ASSERT_TRUE(error == NULL);
+
+        for (size_t i = 0; i < count; i++)
+            ASSERT_EQ(counter.hits[i].load(), 1) << "i=" << i << " count=" << count;
+    }
+}
+
+static void nested_chunk(void *data, unsigned chunk, size_t begin, size_t end)
+{
+    Counter *counter = (Counter *)data;
+    /* each outer chunk fans out again, this must not deadlock */
+    for (size_t i = begin; i < end; i++)
+        ASSERT_TRUE(blot_parallel_for(counter->hits.size(), 7, count_chunk, counter, NULL));
+}
+
+TEST(Parallel, nested)
+{
+    GError *error = NULL;
+    Counter counter(100);
+
+    ASSERT_TRUE(blot_parallel_for(64, 1, nested_chunk, &counter, &error));
+    for (size_t i = 0; i < 100; i++)
+        ASSERT_EQ(counter.hits[i].load(), 64) << "i=" << i;
+}
+
+TEST(Parallel, threads)
+{
+    (void)force_threads;
+    ASSERT_EQ(blot_parallel_threads(), 4u);
+}
+
+TEST(Parallel, bad_arguments)
+{
+    GError *error = NULL;
+
+    ASSERT_FALSE(blot_parallel_for(10, 0, count_chunk, NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_parallel_for(10, 1, NULL, NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+}
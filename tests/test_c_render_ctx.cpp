@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "blot_figure.h"
+#include "blot_screen.h"
+#include "blot_canvas.h"
+#include "blot_axis.h"
+#include "blot_types.h"
+
+#include "blot_alloc.h"
+
+/* allocations made by libblot since before, on any thread */
+static gsize allocations_since(const blot_mem_stats &before)
+{
+    blot_mem_stats after;
+    blot_get_mem_stats(&after);
+    return after.allocations - before.allocations;
+}
+
+static std::wstring screen_text(blot_screen *screen)
+{
+    GError *error = NULL;
+    gsize len = 0;
+    const wchar_t *txt = blot_screen_get_text(screen, &len, &error);
+    EXPECT_TRUE(txt != NULL);
+    return std::wstring(txt, len);
+}
+
+struct Frames {
+    std::vector<double> xs, ys1, ys2;
+    blot_figure *fig{};
+
+    explicit Frames(size_t count) : xs(count), ys1(count), ys2(count) {
+        GError *error = NULL;
+        fig = blot_figure_new(&error);
+        EXPECT_TRUE(fig != NULL);
+        EXPECT_TRUE(blot_figure_set_screen_size(fig, 120, 40, &error));
+
+        blot_figure_line(fig, BLOT_DATA_DOUBLE, count, xs.data(), ys1.data(), 9, "sin", &error);
+        blot_figure_scatter(fig, BLOT_DATA_DOUBLE, count, xs.data(), ys2.data(), 10, "cos", &error);
+        EXPECT_TRUE(error == NULL);
+    }
+    ~Frames() { blot_figure_delete(fig); }
+
+    /* data moves every frame, and so do the limits, but the labels stay
+     * the same width, so that the plot area does not change size */
+    void step(unsigned frame) {
+        for (size_t i = 0; i < xs.size(); i++) {
+            xs[i] = frame + i * 0.1;
+            ys1[i] = sin(xs[i]) * (1 + frame % 3);
+            ys2[i] = cos(xs[i]);
+        }
+    }
+};
+
+TEST(RenderCtx, matches_render)
+{
+    Frames frames(500);
+    GError *error = NULL;
+    blot_render_ctx *ctx = blot_render_ctx_new(&error);
+    ASSERT_TRUE(ctx != NULL);
+
+    const blot_render_flags variants[] = {
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW,
+        BLOT_RENDER_NONE,
+        BLOT_RENDER_NO_UNICODE | BLOT_RENDER_NO_X_AXIS,
+        BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_ABOVE | BLOT_RENDER_LEGEND_DETAILS,
+    };
+
+    unsigned frame = 0;
+    for (blot_render_flags flags : variants) {
+        frames.step(frame++);
+
+        blot_screen *expected = blot_figure_render(frames.fig, flags, &error);
+        ASSERT_TRUE(expected != NULL);
+
+        blot_screen *screen = blot_figure_render_into(frames.fig, ctx, flags, &error);
+        ASSERT_TRUE(screen != NULL);
+        ASSERT_TRUE(error == NULL);
+        ASSERT_TRUE(screen == ctx->scr);
+
+        ASSERT_TRUE(screen_text(screen) == screen_text(expected)) << "flags=" << flags;
+        blot_screen_delete(expected);
+    }
+
+    // the canvases are kept across a change in size
+    ASSERT_TRUE(blot_figure_set_screen_size(frames.fig, 60, 20, &error));
+    blot_screen *expected = blot_figure_render(frames.fig, BLOT_RENDER_BRAILLE, &error);
+    blot_screen *screen = blot_figure_render_into(frames.fig, ctx, BLOT_RENDER_BRAILLE, &error);
+    ASSERT_TRUE(screen != NULL);
+    ASSERT_TRUE(screen_text(screen) == screen_text(expected));
+    ASSERT_TRUE(blot_canvas_fits(ctx->cans[0], frames.fig->x_axs->screen_length,
+                                 frames.fig->y_axs->screen_length, BLOT_RENDER_BRAILLE));
+    blot_screen_delete(expected);
+
+    blot_render_ctx_delete(ctx);
+}
+
+TEST(RenderCtx, bad_arguments)
+{
+    GError *error = NULL;
+    blot_render_ctx ctx;
+    ASSERT_TRUE(blot_render_ctx_init(&ctx, &error));
+
+    ASSERT_TRUE(blot_figure_render_into(NULL, &ctx, BLOT_RENDER_NONE, &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_figure *fig = blot_figure_new(&error);
+    ASSERT_TRUE(blot_figure_render_into(fig, NULL, BLOT_RENDER_NONE, &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    // no layers
+    ASSERT_TRUE(blot_figure_render_into(fig, &ctx, BLOT_RENDER_NONE, &error) == NULL);
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    blot_figure_delete(fig);
+    blot_render_ctx_cleanup(&ctx);
+}
+
+TEST(RenderCtx, steady_state_does_not_allocate)
+{
+    Frames frames(2000);
+    GError *error = NULL;
+    blot_render_ctx *ctx = blot_render_ctx_new(&error);
+    ASSERT_TRUE(ctx != NULL);
+
+    const blot_render_flags flags = BLOT_RENDER_BRAILLE | BLOT_RENDER_LEGEND_BELOW
+        | BLOT_RENDER_UTF8;
+
+    // the first frames size up the buffers
+    for (unsigned frame = 0; frame < 3; frame++) {
+        frames.step(frame);
+        ASSERT_TRUE(blot_figure_render_into(frames.fig, ctx, flags, &error));
+    }
+
+    for (unsigned frame = 3; frame < 20; frame++) {
+        frames.step(frame);
+
+        blot_mem_stats before;
+        blot_get_mem_stats(&before);
+        blot_screen *screen = blot_figure_render_into(frames.fig, ctx, flags, &error);
+        gsize allocations = allocations_since(before);
+
+        ASSERT_TRUE(screen != NULL);
+        ASSERT_EQ(allocations, 0u) << "frame=" << frame;
+    }
+
+    // while a new render allocates every time
+    blot_mem_stats before;
+    blot_get_mem_stats(&before);
+    blot_screen *screen = blot_figure_render(frames.fig, flags, &error);
+    ASSERT_TRUE(screen != NULL);
+    ASSERT_GT(allocations_since(before), 4u);
+    blot_screen_delete(screen);
+
+    blot_render_ctx_delete(ctx);
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "blot_transform.h"
+#include "blot_error.h"
+
+struct Expected {
+    std::vector<int32_t> cols, rows;
+    std::vector<bool> visible;
+};
+
+/* the one-point-at-a-time math the layer renderer used to do */
+static Expected reference(const blot_transform &tr, const std::vector<double> &x,
+                          const std::vector<double> &y)
+{
+    Expected exp;
+    for (size_t i = 0; i < y.size(); i++) {
+        double dc = round((x[i] - tr.x_min) * tr.x_scale);
+        double dr = round((y[i] - tr.y_min) * tr.y_scale);
+        bool vis = dc >= 0 && dc < tr.cols && dr >= 0 && dr < tr.rows;
+        exp.cols.push_back(vis ? (int32_t)dc : 0);
+        exp.rows.push_back(vis ? (int32_t)dr : 0);
+        exp.visible.push_back(vis);
+    }
+    return exp;
+}
+
+static void expect_transform(const blot_transform &tr, blot_data_type data_type,
+                             const void *xs, const void *ys, size_t first, size_t count,
+                             const Expected &exp)
+{
+    for (int level = BLOT_SIMD_NONE; level < BLOT_SIMD_LEVEL_MAX; level++) {
+        GError *error = NULL;
+        std::vector<int32_t> cols(count), rows(count);
+        std::vector<uint64_t> visible(BLOT_TRANSFORM_MASK_WORDS(count), ~0ull);
+        size_t nvisible = ~0;
+
+        ASSERT_TRUE(blot_transform_points_simd((blot_simd_level)level, &tr, data_type,
+                                               xs, ys, first, count,
+                                               cols.data(), rows.data(),
+                                               (guint64*)visible.data(),
+                                               &nvisible, &error));
+        ASSERT_TRUE(error == NULL);
+
+        size_t exp_nvisible = 0;
+        for (size_t i = 0; i < count; i++) {
+            bool vis = !!(visible[i/64] & (1ull << (i%64)));
+            ASSERT_EQ(vis, exp.visible[first+i]) << "level=" << level << " i=" << i;
+            if (!vis)
+                continue;
+            ASSERT_EQ(cols[i], exp.cols[first+i]) << "level=" << level << " i=" << i;
+            ASSERT_EQ(rows[i], exp.rows[first+i]) << "level=" << level << " i=" << i;
+            exp_nvisible ++;
+        }
+        ASSERT_EQ(nvisible, exp_nvisible) << "level=" << level;
+    }
+}
+
+template <typename XT, typename YT>
+static void expect_transform_types(blot_data_type data_type)
+{
+    /* a window onto the middle of the data, so that many points fall off
+     * every edge; odd sizes exercise the scalar tail after the vector loop */
+    const blot_transform tr = {
+        .x_min = -20.5, .x_scale = 0.75,
+        .y_min = -10, .y_scale = 1.5,
+        .cols = 40, .rows = 30,
+    };
+    const size_t counts[] = { 1, 3, 9, 64, 67, 255, 256, 257, 1001 };
+
+    for (size_t count : counts) {
+        std::vector<XT> xs(count);
+        std::vector<YT> ys(count);
+        std::vector<double> xd(count), yd(count), id(count);
+
+        srand(count);
+        for (size_t i = 0; i < count; i++) {
+            xs[i] = (XT)((rand() % 2001) - 1000) / (XT)8;
+            ys[i] = (YT)((rand() % 2001) - 1000) / (YT)16;
+            xd[i] = xs[i];
+            yd[i] = ys[i];
+            id[i] = i;
+        }
+
+        expect_transform(tr, data_type, xs.data(), ys.data(), 0, count,
+                         reference(tr, xd, yd));
+
+        /* NULL X is the index, and first offsets both the index and the data */
+        size_t first = count / 3;
+        expect_transform(tr, data_type, NULL, ys.data(), first, count - first,
+                         reference(tr, id, yd));
+    }
+}
+
+TEST(Transform, int16_int16)   { expect_transform_types<int16_t, int16_t>(BLOT_DATA_INT16); }
+TEST(Transform, int32_int32)   { expect_transform_types<int32_t, int32_t>(BLOT_DATA_INT32); }
+TEST(Transform, int64_int64)   { expect_transform_types<int64_t, int64_t>(BLOT_DATA_INT64); }
+TEST(Transform, float_float)   { expect_transform_types<float, float>(BLOT_DATA_FLOAT); }
+TEST(Transform, double_double) { expect_transform_types<double, double>(BLOT_DATA_DOUBLE); }
+TEST(Transform, int16_double)  { expect_transform_types<int16_t, double>(BLOT_DATA_(INT16, DOUBLE)); }
+TEST(Transform, float_int64)   { expect_transform_types<float, int64_t>(BLOT_DATA_(FLOAT, INT64)); }
+
+TEST(Transform, rounding_edges)
+{
+    /* round() goes half away from zero, and -0.4 rounds to column 0 */
+    const blot_transform tr = {
+        .x_min = 0, .x_scale = 1,
+        .y_min = 0, .y_scale = 1,
+        .cols = 10, .rows = 10,
+    };
+    std::vector<double> xs = {
+        -0.6, -0.5, -0.4, -0.0, 0.49999999999999994, 0.5, 1.5, 2.5,
+        8.5, 9.49999999999999, 9.5, NAN, INFINITY, -INFINITY, 1e300, -1e300,
+        4294967296.0, 2147483647.6,
+    };
+    std::vector<double> ys(xs.size(), 3.0);
+
+    expect_transform(tr, BLOT_DATA_DOUBLE, xs.data(), ys.data(), 0, xs.size(),
+                     reference(tr, xs, ys));
+    expect_transform(tr, BLOT_DATA_DOUBLE, ys.data(), xs.data(), 0, xs.size(),
+                     reference(tr, ys, xs));
+}
+
+TEST(Transform, bad_arguments)
+{
+    const blot_transform tr = {};
+    double data[4] = {};
+    int32_t cols[4], rows[4];
+    guint64 visible[1];
+
+    GError *error = NULL;
+    ASSERT_FALSE(blot_transform_points(&tr, BLOT_DATA_DOUBLE, data, NULL, 0, 4,
+                                       cols, rows, visible, NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    g_clear_error(&error);
+
+    ASSERT_FALSE(blot_transform_points(&tr, BLOT_DATA_TYPE_MAX, data, data, 0, 4,
+                                       cols, rows, visible, NULL, &error));
+    ASSERT_TRUE(error != NULL);
+    ASSERT_EQ(error->code, EINVAL);
+    g_clear_error(&error);
+}
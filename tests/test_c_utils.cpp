@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstdio>
+
 #include "blot_utils.h"
 
 TEST(BaseTest, AssertionTrue)
@@ -107,3 +110,51 @@ TEST(Utils, abs_t)
     EXPECT_EQ(abs_t(int,1), 1);
     EXPECT_EQ(abs_t(int,-1), 1);
 }
+
+/* the first format of these that fits, as blot_format_number() used to do */
+static int format_number_printf(char *p, unsigned room, double d_val)
+{
+    static const char *formats[] = { "%.3f", "%.2f", "%.1f", "%g", "%.3g", "%3.g" };
+    for (const char *format : formats) {
+        int rc = snprintf(p, room, format, d_val);
+        if (rc > 0 && rc < (int)room)
+            return rc;
+    }
+    return -1;
+}
+
+static void expect_format_number(double d_val)
+{
+    for (unsigned room = 0; room < 24; room++) {
+        char exp[32], got[32];
+        int exp_rc = format_number_printf(exp, room, d_val);
+        int got_rc = blot_format_number(got, room, d_val);
+
+        ASSERT_EQ(got_rc, exp_rc) << "value=" << d_val << " room=" << room;
+        if (exp_rc > 0) {
+            ASSERT_STREQ(got, exp) << "value=" << d_val << " room=" << room;
+        }
+    }
+}
+
+TEST(Utils, format_number_matches_printf)
+{
+    const double values[] = {
+        0, -0.0, 1, -1, 0.5, 0.125, 0.0625, 2.5, 9.9995, 9.9996, 99.995, 999999.5,
+        999999.4, 1e6, 1e-4, 1e-5, 0.00012345, 123456789, 1e12, 4.5e12, 1e15, 1e22,
+        1e100, -1e-100, 5e-324, 1.7976931348623157e308, 0.1, 0.2, 0.3, 1.0/3,
+        -2.0/3, 12345.6789, INFINITY, -INFINITY, NAN,
+    };
+    for (double v : values)
+        expect_format_number(v);
+
+    // axis ticks, and random values of all magnitudes
+    for (int i = 0; i < 2000; i++)
+        expect_format_number(-100 + i * (200.0 / 2001));
+
+    srand(18);
+    for (int i = 0; i < 20000; i++) {
+        double m = (double)rand() / RAND_MAX - 0.5;
+        expect_format_number(m * pow(10, rand() % 40 - 20));
+    }
+}
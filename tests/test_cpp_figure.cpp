@@ -191,3 +191,41 @@ TEST(Figure, add_plot_zero_count)
     const std::vector<int32_t> ys = {};
     ASSERT_THROW(fig.scatter(xs, ys, 1, "scatter"), Blot::Exception);
 }
+
+TEST(Figure, add_ring_and_append)
+{
+    Blot::Figure fig;
+
+    ASSERT_NO_THROW((fig.ring<double,float>(BLOT_LINE, 3, 1, "ring")));
+    ASSERT_EQ(fig.layer_count, 1);
+
+    for (int i = 0; i < 5; i++)
+        ASSERT_NO_THROW(fig.append(0, (double)i, (float)i * 2));
+    ASSERT_EQ(fig.layers[0]->count, 3u);
+
+    // the types have to match those of the ring
+    ASSERT_THROW(fig.append(0, 1, 2), Blot::Exception);
+    ASSERT_THROW(fig.append(1, 1.0, 2.0f), Blot::Exception);
+
+    fig.set_screen_size(60, 20);
+    Blot::Screen scr = fig.render(BLOT_RENDER_NO_UNICODE);
+    size_t size;
+    ASSERT_TRUE(scr.get_utf8(size) != nullptr);
+}
+
+TEST(Figure, render_with_context)
+{
+    Blot::Context ctx(false);
+    ASSERT_NO_THROW(ctx.set_term_size(60, 20));
+    ASSERT_THROW(ctx.set_term_size(60, 2), Blot::Exception);
+
+    std::vector<double> ys{1, 3, 2, 4};
+    Blot::Figure fig;
+    fig.set_context(ctx);
+    fig.line(ys, 1, "line");
+
+    Blot::Screen scr = fig.render(BLOT_RENDER_BRAILLE);
+    size_t size;
+    std::string txt = scr.get_utf8(size);
+    ASSERT_EQ(txt.find(COL_FG_PREFIX), std::string::npos);
+}